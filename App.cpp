@@ -25,14 +25,76 @@
 #include "Font.h"
 #include "Dialogs.h"
 #include "Event.h"
+#include "Worker.h"
 
 #include <cstdio>
 #include <string>
+#include <sstream>
 #include <sys/stat.h>
 #include <unistd.h>
 #include <SDL/SDL.h>
 
 
+// One level of a -simulate batch and its outcome.
+struct SimulationJob
+{
+  std::string name;
+  std::string level;
+  bool        completed;
+  int         tick;
+  int         steps;
+  int         ms;
+  int         diverged;
+};
+
+struct SimulationBatch
+{
+  Array<SimulationJob*> jobs;
+  Array<Scene*>         scenes; // one per worker, each with its own b2World
+};
+
+// Frame pacing of the main loop, counted per second for the -fps overlay.
+struct FrameStats
+{
+  FrameStats()
+    : start(0), frames(0), ticks(0), dropped(0), worstMs(0),
+      pixels(0), rects(0),
+      fps(0), tps(0), droppedTicks(0), worstFrameMs(0),
+      framePixels(0), frameRects(0) {}
+
+  void repaint( const Region& area )
+  {
+    pixels += area.area();
+    rects += area.size();
+  }
+
+  void frame( int now, int frameMs, int frameTicks, int frameDropped )
+  {
+    frames++;
+    ticks += frameTicks;
+    dropped += frameDropped;
+    if ( frameMs > worstMs ) {
+      worstMs = frameMs;
+    }
+    if ( now - start >= 1000 ) {
+      fps = frames;
+      tps = ticks;
+      droppedTicks = dropped;
+      worstFrameMs = worstMs;
+      framePixels = pixels / frames;
+      frameRects = rects / frames;
+      start = now;
+      frames = ticks = dropped = worstMs = pixels = rects = 0;
+    }
+  }
+
+  // the second in progress
+  int start, frames, ticks, dropped, worstMs, pixels, rects;
+  // the last whole second
+  int fps, tps, droppedTicks, worstFrameMs, framePixels, frameRects;
+};
+
+
 class App : private Container
 {
   int   m_width;
@@ -40,13 +102,18 @@ class App : private Container
   bool  m_rotate;  
   bool  m_thumbnailMode;
   bool  m_videoMode;
+  bool  m_simulateMode;
+  bool  m_loadBenchMode;
+  bool  m_compileMode;
   std::string m_testOp;
   bool  m_quit;
   bool  m_drawFps;
   bool  m_drawDirty;
   int   m_renderRate;
+  FrameStats m_frameStats;
   Array<const char*> m_files;
   Window            *m_window;
+  GameControl       *m_game;
 public:
   App(int argc, char** argv)
     : m_width(SCREEN_WIDTH),
@@ -54,10 +121,14 @@ public:
       m_rotate(false),
       m_thumbnailMode(false),
       m_videoMode(false),
+      m_simulateMode(false),
+      m_loadBenchMode(false),
+      m_compileMode(false),
       m_quit(false),
       m_drawFps(false),
       m_drawDirty(false),
-      m_window(NULL)
+      m_window(NULL),
+      m_game(NULL)
   {
     for ( int i=1; i<argc; i++ ) {
       if ( strcmp(argv[i],"-test")==0 && i < argc-1) {
@@ -66,8 +137,25 @@ public:
 	m_thumbnailMode = true;
       } else if ( strcmp(argv[i],"-video")==0 ) {
 	m_videoMode = true;
+      } else if ( strcmp(argv[i],"-simulate")==0 ) {
+	m_simulateMode = true;
+      } else if ( strcmp(argv[i],"-loadbench")==0 ) {
+	m_loadBenchMode = true;
+      } else if ( strcmp(argv[i],"-compile")==0 ) {
+	m_compileMode = true;
       } else if ( strcmp(argv[i],"-fps")==0 ) {
 	m_drawFps = true;
+	PROFILE_PHYSICS = true;
+      } else if ( strcmp(argv[i],"-threads")==0 && i<argc-1) {
+	SOLVER_THREADS = atoi(argv[++i]);
+      } else if ( strcmp(argv[i],"-levelcache")==0 && i<argc-1) {
+	LEVEL_CACHE_BYTES = atoi(argv[++i]) * 1024;
+      } else if ( strcmp(argv[i],"-deterministic")==0 ) {
+	DETERMINISTIC = true;
+      } else if ( strcmp(argv[i],"-physthread")==0 ) {
+	PHYSICS_THREAD = true;
+      } else if ( strcmp(argv[i],"-simd")==0 ) {
+	SOLVER_SIMD = true;
       } else if ( strcmp(argv[i],"-rotate")==0 ) {
 	m_rotate = true;
       } else if ( strcmp(argv[i],"-geometry")==0 && i<argc-1) {
@@ -104,6 +192,12 @@ public:
       for ( int i=0; i<m_files.size(); i++ ) {
 	renderVideo( m_files[i], m_width, m_height );
       }
+    } else if ( m_simulateMode ) {
+      simulate( m_files );
+    } else if ( m_loadBenchMode ) {
+      benchmarkLoad( m_files );
+    } else if ( m_compileMode ) {
+      compileLevels( m_files );
     } else {      
       m_window = new Window(m_width,m_height,"Numpty Physics","NPhysics");
       sizeTo(Vec2(m_width,m_height));
@@ -115,7 +209,9 @@ private:
 
   void init()
   {
-    if ( m_thumbnailMode || m_videoMode || m_testOp.length() > 0 ) {
+    if ( m_thumbnailMode || m_videoMode || m_simulateMode || m_loadBenchMode
+	 || m_compileMode
+	 || m_testOp.length() > 0 ) {
       putenv((char*)"SDL_VIDEODRIVER=dummy");
     } else {
       putenv((char*)"SDL_VIDEO_X11_WMCLASS=NPhysics");
@@ -168,6 +264,193 @@ private:
     }
   }
 
+  // Replay every level's log without drawing anything, spreading the
+  // levels over a pool of workers. Each worker reuses one Scene, so the
+  // world's memory is recycled from level to level.
+  void simulate( Array<const char*>& files )
+  {
+    Levels levels;
+    for ( int i=0; i<files.size(); i++ ) {
+      levels.addPath( files[i] );
+    }
+
+    SimulationBatch batch;
+    for ( int i=0; i<levels.numLevels(); i++ ) {
+      int size;
+      const unsigned char* buf = levels.load( i, &size );
+      if ( size ) {
+	SimulationJob* job = new SimulationJob;
+	job->name = levels.levelName( i, false );
+	job->level.assign( (const char*)buf, size );
+	job->completed = false;
+	job->tick = job->steps = job->ms = 0;
+	job->diverged = -1;
+	batch.jobs.append( job );
+      }
+    }
+
+    // -threads sizes the batch; the worlds themselves are solved serially
+    int threads = SOLVER_THREADS > 1 ? SOLVER_THREADS
+                                     : (int)sysconf( _SC_NPROCESSORS_ONLN );
+    if ( threads < 1 ) threads = 1;
+    SOLVER_THREADS = 1;
+
+    // the workers share Box2D's contact registers, so fill them in first
+    b2Contact::InitializeRegisters();
+    WorkerPool pool( threads );
+    for ( int i=0; i<pool.GetWorkerCount(); i++ ) {
+      Scene* scene = new Scene( true );
+      scene->setHeadless( true );
+      batch.scenes.append( scene );
+    }
+
+    int start = SDL_GetTicks();
+    pool.Run( simulateJob, &batch, batch.jobs.size() );
+    int ms = SDL_GetTicks() - start;
+
+    int completed = 0, steps = 0;
+    for ( int i=0; i<batch.jobs.size(); i++ ) {
+      SimulationJob* job = batch.jobs[i];
+      if ( job->completed ) {
+	printf("SIMULATE %s: goal at tick %d, %d steps/s\n",
+	       job->name.c_str(), job->tick,
+	       job->steps*1000/(job->ms>0?job->ms:1));
+	completed++;
+      } else {
+	printf("SIMULATE %s: no goal after %d ticks, %d steps/s\n",
+	       job->name.c_str(), job->steps,
+	       job->steps*1000/(job->ms>0?job->ms:1));
+      }
+      if ( job->diverged >= 0 ) {
+	printf("SIMULATE %s: replay diverged at tick %d\n",
+	       job->name.c_str(), job->diverged);
+      }
+      steps += job->steps;
+      delete job;
+    }
+    printf("SIMULATE %d/%d completed, %d steps in %dms on %d workers\n",
+	   completed, batch.jobs.size(), steps, ms, pool.GetWorkerCount());
+
+    for ( int i=0; i<batch.scenes.size(); i++ ) {
+      delete batch.scenes[i];
+    }
+  }
+
+  // Time parsing every level of the files from memory into one headless
+  // scene, LOAD_BENCH_REPEAT times over.
+  void benchmarkLoad( Array<const char*>& files )
+  {
+    Levels levels;
+    for ( int i=0; i<files.size(); i++ ) {
+      levels.addPath( files[i] );
+    }
+
+    Array<std::string*> texts;
+    int bytes = 0;
+    int start = SDL_GetTicks();
+    for ( int i=0; i<levels.numLevels(); i++ ) {
+      int size;
+      const unsigned char* buf = levels.load( i, &size );
+      if ( size ) {
+	texts.append( new std::string( (const char*)buf, size ) );
+	bytes += size;
+      }
+    }
+    int coldMs = SDL_GetTicks() - start;
+
+    // and again, as the selector and a game's resets would
+    start = SDL_GetTicks();
+    for ( int r=0; r<LOAD_BENCH_REPEAT; r++ ) {
+      for ( int i=0; i<levels.numLevels(); i++ ) {
+	int size;
+	levels.load( i, &size );
+      }
+    }
+    int warmMs = SDL_GetTicks() - start;
+    printf("LOADBENCH read in %dms, %d rereads in %dms, cache %d hits %d misses\n",
+	   coldMs, LOAD_BENCH_REPEAT * levels.numLevels(), warmMs,
+	   levels.cacheHits(), levels.cacheMisses());
+
+    Scene scene( true );
+    scene.setHeadless( true );
+    int strokes = 0;
+    start = SDL_GetTicks();
+    for ( int r=0; r<LOAD_BENCH_REPEAT; r++ ) {
+      for ( int i=0; i<texts.size(); i++ ) {
+	scene.load( (const unsigned char*)texts[i]->data(), texts[i]->size() );
+	if ( r==0 ) {
+	  strokes += scene.numStrokes();
+	}
+      }
+    }
+    int ms = SDL_GetTicks() - start;
+    int loads = LOAD_BENCH_REPEAT * texts.size();
+    printf("LOADBENCH %d levels, %d strokes, %d bytes\n",
+	   texts.size(), strokes, bytes);
+    printf("LOADBENCH %d loads in %dms, %d us/level\n",
+	   loads, ms, loads ? ms*1000/loads : 0);
+
+    for ( int i=0; i<texts.size(); i++ ) {
+      delete texts[i];
+    }
+  }
+
+  // Write every level of the files, .nph or collections of them, as a
+  // compiled .npb of the same name in the current directory.
+  void compileLevels( Array<const char*>& files )
+  {
+    Levels levels;
+    for ( int i=0; i<files.size(); i++ ) {
+      levels.addPath( files[i] );
+    }
+
+    for ( int i=0; i<levels.numLevels(); i++ ) {
+      std::string name = levels.levelName( i, false );
+      size_t sep = name.rfind( Os::pathSep );
+      if ( sep != std::string::npos ) {
+	name = name.substr( sep+1 );
+      }
+      size_t dot = name.rfind( '.' );
+      if ( dot != std::string::npos ) {
+	name.resize( dot );
+      }
+      name += ".npb";
+      int size;
+      const unsigned char* buf = levels.load( i, &size );
+      Scene scene( true );
+      scene.setHeadless( true );
+      if ( size && scene.load( buf, size ) && scene.saveCompiled( name ) ) {
+	printf("COMPILE %s\n", name.c_str());
+      } else {
+	fprintf(stderr,"COMPILE %s failed\n", name.c_str());
+      }
+    }
+  }
+
+  static void simulateJob( void* context, int32 index, int32 worker )
+  {
+    SimulationBatch* batch = (SimulationBatch*)context;
+    SimulationJob* job = batch->jobs[index];
+    Scene* scene = batch->scenes[worker];
+
+    int start = SDL_GetTicks();
+    std::istringstream in( job->level );
+    if ( scene->load( in ) ) {
+      scene->start( scene->getLog()->size() > 0 );
+      while ( job->steps < ITERATION_RATE*SIMULATE_MAX_LEN ) {
+	scene->step();
+	job->steps++;
+	if ( scene->isCompleted() ) {
+	  job->completed = true;
+	  job->tick = job->steps;
+	  break;
+	}
+      }
+      job->diverged = scene->replay()->divergedTick();
+    }
+    job->ms = SDL_GetTicks() - start;
+  }
+
   void runGame( Array<const char*>& files, int width, int height )
   {
     Levels* levels = new Levels();
@@ -186,7 +469,9 @@ private:
       levels->addPath( Config::userDataDir().c_str() );
     }
         
-    add( createGameLayer( levels, width, height ), 0, 0 );
+    Widget* game = createGameLayer( levels, width, height );
+    m_game = dynamic_cast<GameControl*>( game );
+    add( game, 0, 0 );
     mainLoop();
   }
 
@@ -194,29 +479,69 @@ private:
   {
     if (isDirty()) {
       
-      Rect area = dirtyArea();
-      //fprintf(stderr,"render %d,%d-%d,%d!\n",area.tl.x,area.tl.y,area.br.x,area.br.y);
+      Region area = dirtyArea();
       m_window->setClip(0,0,SCREEN_WIDTH,SCREEN_HEIGHT);
-      draw(*m_window, area);
+      // each rect is cleared and redrawn on its own, they are disjoint
+      for ( int i=0; i<area.size(); i++ ) {
+	//fprintf(stderr,"render %d,%d-%d,%d!\n",area[i].tl.x,area[i].tl.y,area[i].br.x,area[i].br.y);
+	draw(*m_window, area[i]);
+      }
 
       if ( m_drawDirty ) {
-	Rect b = area; b.br.x--; b.br.y--;
-	m_window->drawRect( b, m_window->makeColour(0x00af00), false );
+	for ( int i=0; i<area.size(); i++ ) {
+	  Rect b = area[i]; b.br.x--; b.br.y--;
+	  m_window->drawRect( b, m_window->makeColour(0x00af00), false );
+	}
       }
 
       if ( m_drawFps ) {
-	m_window->drawRect( Rect(0,0,50,50), m_window->makeColour(0xbfbf8f), true );
-	char buf[32];
-	sprintf(buf,"%d",m_renderRate);
-	Font::headingFont()->drawLeft( m_window, Vec2(20,20), buf, 0 );
-	m_window->update( Rect(0,0,50,50) );
+	drawFps();
       }
 
       m_window->update( area );
+      m_frameStats.repaint( area );
     }
   }
 
 
+  void drawFps()
+  {
+    const b2Profile* p = m_game ? m_game->profile() : NULL;
+    if ( !p ) {
+      m_window->drawRect( Rect(0,0,50,50), m_window->makeColour(0xbfbf8f), true );
+      char buf[32];
+      sprintf(buf,"%d",m_frameStats.fps);
+      Font::headingFont()->drawLeft( m_window, Vec2(20,20), buf, 0 );
+      m_window->update( Rect(0,0,50,50) );
+      return;
+    }
+
+    char lines[9][64];
+    sprintf(lines[0],"%d fps  %d tps  step %.2fms",
+	    m_frameStats.fps,m_frameStats.tps,(float)p->step);
+    sprintf(lines[1],"collide %.2fms  %d contacts",
+	    (float)p->collide,p->contactsUpdated);
+    sprintf(lines[2],"solve %.2fms  %d islands",
+	    (float)p->solve,p->islandsSolved);
+    sprintf(lines[3],"broadphase %.2fms",(float)p->broadphase);
+    sprintf(lines[4],"toi %.2fms  %d events",
+	    (float)p->solveTOI,p->toiEvents);
+    sprintf(lines[5],"pairs +%d -%d",p->pairsAdded,p->pairsRemoved);
+    sprintf(lines[6],"position iterations %d",p->positionIterations);
+    sprintf(lines[7],"frame max %dms  dropped %d  target %d fps",
+	    m_frameStats.worstFrameMs,m_frameStats.droppedTicks,m_renderRate);
+    sprintf(lines[8],"repaint %d px/frame in %d rects",
+	    m_frameStats.framePixels,m_frameStats.frameRects);
+
+    const Font* font = Font::blurbFont();
+    Rect r(0,0,260,10+9*font->height());
+    m_window->drawRect( r, m_window->makeColour(0xbfbf8f), true );
+    for ( int i=0; i<9; i++ ) {
+      font->drawLeft( m_window, Vec2(5,5+i*font->height()), lines[i], 0 );
+    }
+    m_window->update( r );
+  }
+
   void waitActive()
   {
     SDL_Event ev;
@@ -256,6 +581,7 @@ private:
       case SDLK_1:
       case SDLK_f:
 	m_drawFps = !m_drawFps;
+	PROFILE_PHYSICS = m_drawFps;
 	return true;
       case SDLK_2:
       case SDLK_d:
@@ -291,37 +617,57 @@ private:
     render();
 
     m_renderRate = (MIN_RENDER_RATE+MAX_RENDER_RATE)/2;
-    int iterationRate = ITERATION_RATE;
-    int iterateCounter = 0;
+    // wall clock time not simulated yet, in 1/ITERATION_RATE ms so
+    // that one tick is exactly 1000
+    int accumulator = 0;
     int lastTick = SDL_GetTicks();
-    bool isComplete = false;    
+    int lastFrame = lastTick;
 
     while ( !m_quit ) {
       OS->poll();
 
-      //assumes RENDER_RATE <= ITERATION_RATE
-      while ( iterateCounter < iterationRate ) {
+      int now = SDL_GetTicks();
+      accumulator += (now - lastTick) * ITERATION_RATE;
+      lastTick = now;
+
+      // physics runs at ITERATION_RATE whatever the render rate
+      int ticks = 0;
+      int dropped = 0;
+      do {
+	if ( accumulator >= 1000 ) {
+	  if ( ticks == MAX_CATCHUP_TICKS ) {
+	    // too far behind: let simulation time slip
+	    dropped = accumulator / 1000;
+	    accumulator %= 1000;
+	    break;
+	  }
+	  onTick( now );
+	  accumulator -= 1000;
+	  ticks++;
+	}
 
-	onTick( lastTick );
-    
 	SDL_Event ev;
 	while ( SDL_PollEvent(&ev) ) {
 	  processEvent(ev);
 	}
 
 	if ( m_quit ) return;
-	iterateCounter += m_renderRate;
-      }
-      iterateCounter -= iterationRate;
+      } while ( accumulator >= 1000 );
 
+      if ( m_game ) {
+	m_game->interpolate( (float)accumulator / 1000.0f );
+      }
       render();
 
-      int sleepMs = lastTick + 1000/m_renderRate -  SDL_GetTicks();
+      now = SDL_GetTicks();
+      m_frameStats.frame( now, now - lastFrame, ticks, dropped );
+
+      int sleepMs = lastFrame + 1000/m_renderRate - now;
 
       if ( sleepMs > 1 && m_renderRate < MAX_RENDER_RATE ) {
 	m_renderRate++;
 	//printf("increasing render rate to %dfps\n",m_renderRate);
-	sleepMs = lastTick + 1000/m_renderRate -  SDL_GetTicks();
+	sleepMs = lastFrame + 1000/m_renderRate - now;
       }
 
       if ( sleepMs > 0 ) {
@@ -331,11 +677,9 @@ private:
 	if ( m_renderRate > MIN_RENDER_RATE ) {
 	  m_renderRate--;
 	  //printf("decreasing render rate to %dfps\n",m_renderRate);
-	} else if ( iterationRate > 30 ) {
-	  //slow down simulation time to maintain fps??
 	}
       }
-      lastTick = SDL_GetTicks();
+      lastFrame = SDL_GetTicks();
     }
   }
   
@@ -65,6 +65,13 @@ class Array
     m_size = 0;
   }
 
+  // grow or shrink to n elements, new ones are left unset
+  void resize( int n )
+  {
+    ensureCapacity( n );
+    m_size = n;
+  }
+
   T& at( int i )
   {
     ASSERT( i < m_size );
@@ -0,0 +1,98 @@
+/*
+* Copyright (c) 2006-2007 Erin Catto http://www.gphysics.com
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+// Broad-phase scaling: N dynamic 1x1 boxes on a 4m grid fall onto the
+// ground. Reports the time to create the shapes and the mean step time
+// over 60 steps, best of 3 worlds, for each N given on the command line
+// (1k to 50k by default).
+
+#include "Box2D.h"
+#include "../../Source/Common/b2Timer.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+
+static const int32 k_steps = 60;
+static const int32 k_runs = 3;
+
+static void Run(int32 count, float32* createMs, float32* stepMs)
+{
+	int32 side = (int32)ceilf(sqrtf((float32)count));
+	float32 extent = 4.0f * side + 100.0f;
+
+	b2AABB worldAABB;
+	worldAABB.lowerBound.Set(-extent, -extent);
+	worldAABB.upperBound.Set(extent, extent);
+	b2World* world = new b2World(worldAABB, b2Vec2(0.0f, -10.0f), true);
+
+	b2Timer timer;
+	timer.Reset();
+
+	b2BodyDef groundDef;
+	groundDef.position.Set(0.0f, -1.0f);
+	b2Body* ground = world->CreateBody(&groundDef);
+	b2PolygonDef groundShape;
+	groundShape.SetAsBox(4.0f * side, 1.0f);
+	ground->CreateShape(&groundShape);
+
+	b2PolygonDef box;
+	box.SetAsBox(0.5f, 0.5f);
+	box.density = 1.0f;
+	box.friction = 0.3f;
+	for (int32 i = 0; i < count; ++i)
+	{
+		b2BodyDef bd;
+		bd.position.Set(4.0f * (i % side - side / 2), 1.0f + 4.0f * (i / side));
+		b2Body* body = world->CreateBody(&bd);
+		body->CreateShape(&box);
+		body->SetMassFromShapes();
+	}
+	*createMs = timer.GetMilliseconds();
+
+	timer.Reset();
+	for (int32 i = 0; i < k_steps; ++i)
+	{
+		world->Step(1.0f / 60.0f, 10);
+	}
+	*stepMs = timer.GetMilliseconds() / k_steps;
+
+	delete world;
+}
+
+int main(int argc, char** argv)
+{
+	static const int32 defaults[] = {1000, 2000, 5000, 10000, 20000, 50000};
+	int32 sizes = argc > 1 ? argc - 1 : (int32)(sizeof(defaults) / sizeof(defaults[0]));
+
+	printf("broad-phase: %d steps, best of %d\n", k_steps, k_runs);
+	printf("%8s %12s %12s\n", "shapes", "create ms", "ms/step");
+	for (int32 s = 0; s < sizes; ++s)
+	{
+		int32 count = argc > 1 ? atoi(argv[s + 1]) : defaults[s];
+		float32 bestCreate = 0.0f, bestStep = 0.0f;
+		for (int32 r = 0; r < k_runs; ++r)
+		{
+			float32 createMs, stepMs;
+			Run(count, &createMs, &stepMs);
+			if (r == 0 || createMs < bestCreate) bestCreate = createMs;
+			if (r == 0 || stepMs < bestStep) bestStep = stepMs;
+		}
+		printf("%8d %12.1f %12.2f\n", count, bestCreate, bestStep);
+	}
+	return 0;
+}
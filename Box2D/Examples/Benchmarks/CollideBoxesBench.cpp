@@ -0,0 +1,165 @@
+/*
+* Copyright (c) 2006-2007 Erin Catto http://www.gphysics.com
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+// Time per pair of the generic convex collider and the box-vs-box fast
+// path, on random rectangle pairs and on cache resident chain segment
+// pairs. Best of 5 passes over the same inputs.
+
+#include "Box2D.h"
+#include "../../Source/Common/b2Timer.h"
+#include <cstdio>
+#include <cmath>
+#include <vector>
+
+// Compile the colliders into a namespace of our own, so both the file
+// static CollideBoxes and CollideConvex can be called directly.
+namespace collide
+{
+#include "../../Source/Collision/b2CollidePoly.cpp"
+}
+
+static const int32 k_passes = 5;
+
+static uint32 s_seed = 12345;
+
+static float32 Random(float32 lo, float32 hi)
+{
+	s_seed = s_seed * 1664525u + 1013904223u;
+	return lo + (hi - lo) * float32(s_seed >> 8) / float32(1 << 24);
+}
+
+template <typename TA, typename TB>
+struct Pair
+{
+	const TA* a;
+	const TB* b;
+	b2XForm xfA;
+	b2XForm xfB;
+};
+
+template <typename TA, typename TB>
+static void MakePairs(std::vector< Pair<TA, TB> >* pairs, int32 count,
+					  const TA* const* as, int32 aCount, const TB* const* bs, int32 bCount,
+					  float32 spread)
+{
+	pairs->resize(count);
+	for (int32 i = 0; i < count; ++i)
+	{
+		Pair<TA, TB>& p = (*pairs)[i];
+		p.a = as[s_seed % aCount];
+		p.b = bs[(s_seed >> 8) % bCount];
+		p.xfA.R.Set(Random(-b2_pi, b2_pi));
+		p.xfA.position.Set(Random(-10.0f, 10.0f), Random(-10.0f, 10.0f));
+		p.xfB.R.Set(Random(-b2_pi, b2_pi));
+		b2Vec2 offset(Random(-spread, spread), Random(-spread, spread));
+		p.xfB.position = b2Mul(p.xfA, p.a->GetCentroid()) + offset - b2Mul(p.xfB.R, p.b->GetCentroid());
+	}
+}
+
+// Returns ns per pair; touching counts the pairs in contact.
+template <typename TA, typename TB>
+static float32 Time(const std::vector< Pair<TA, TB> >& pairs, bool boxes, int32* touching)
+{
+	float32 best = 0.0f;
+	b2Timer timer;
+	for (int32 pass = 0; pass < k_passes; ++pass)
+	{
+		int32 count = 0;
+		timer.Reset();
+		for (size_t i = 0; i < pairs.size(); ++i)
+		{
+			const Pair<TA, TB>& p = pairs[i];
+			b2Manifold m;
+			if (boxes)
+			{
+				collide::CollideBoxes(&m, p.a, p.xfA, p.b, p.xfB);
+			}
+			else
+			{
+				collide::CollideConvex(&m, p.a, p.xfA, p.b, p.xfB);
+			}
+			count += m.pointCount > 0;
+		}
+		float32 ms = timer.GetMilliseconds();
+		if (pass == 0 || ms < best) best = ms;
+		*touching = count;
+	}
+	return best * 1.0e6f / pairs.size();
+}
+
+template <typename TA, typename TB>
+static void Report(const char* name, const std::vector< Pair<TA, TB> >& pairs)
+{
+	int32 touching;
+	float32 generic = Time(pairs, false, &touching);
+	float32 box = Time(pairs, true, &touching);
+	printf("%-18s %7d pairs %7d touching  generic %6.1f ns  box %6.1f ns\n",
+		   name, (int32)pairs.size(), touching, generic, box);
+}
+
+int main()
+{
+	b2AABB worldAABB;
+	worldAABB.lowerBound.Set(-1000.0f, -1000.0f);
+	worldAABB.upperBound.Set(1000.0f, 1000.0f);
+	b2World world(worldAABB, b2Vec2(0.0f, -10.0f), false);
+
+	b2BodyDef bd;
+	b2Body* body = world.CreateBody(&bd);
+
+	const int32 boxCount = 64;
+	const b2PolygonShape* boxes[boxCount];
+	for (int32 i = 0; i < boxCount; ++i)
+	{
+		b2PolygonDef sd;
+		sd.SetAsBox(Random(0.05f, 2.0f), Random(0.05f, 2.0f));
+		boxes[i] = (const b2PolygonShape*)body->CreateShape(&sd);
+	}
+
+	const int32 vertexCount = 65;
+	b2Vec2 vertices[vertexCount];
+	vertices[0].SetZero();
+	for (int32 i = 1; i < vertexCount; ++i)
+	{
+		float32 angle = Random(-b2_pi, b2_pi);
+		vertices[i] = vertices[i-1] + Random(0.2f, 3.0f) * b2Vec2(cosf(angle), sinf(angle));
+	}
+	b2ChainDef cd;
+	cd.vertices = vertices;
+	cd.vertexCount = vertexCount;
+	const b2ChainShape* chain = (const b2ChainShape*)body->CreateShape(&cd);
+	const b2ChainSegment* segments = chain->GetSegments();
+	int32 segmentCount = chain->GetSegmentCount();
+	const b2ChainSegment* segmentPointers[vertexCount];
+	for (int32 i = 0; i < segmentCount; ++i)
+	{
+		segmentPointers[i] = segments + i;
+	}
+
+	printf("narrow-phase: best of %d passes\n", k_passes);
+
+	std::vector< Pair<b2PolygonShape, b2PolygonShape> > polygonPairs;
+	MakePairs(&polygonPairs, 200000, boxes, boxCount, boxes, boxCount, 4.0f);
+	Report("box vs box", polygonPairs);
+
+	std::vector< Pair<b2ChainSegment, b2ChainSegment> > chainPairs;
+	MakePairs(&chainPairs, 4096, segmentPointers, segmentCount, segmentPointers, segmentCount, 1.0f);
+	Report("segment vs segment", chainPairs);
+
+	return 0;
+}
@@ -0,0 +1,204 @@
+/*
+* Copyright (c) 2006-2007 Erin Catto http://www.gphysics.com
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+// Checks the box-vs-box narrow-phase against the generic convex collider
+// on random rectangle pairs and chain segments: both must give the same
+// point count and feature ids, and normals, points and separations that
+// agree within a tolerance. Exits non-zero on any mismatch.
+
+#include "Box2D.h"
+#include <cstdio>
+#include <cmath>
+
+// Compile the colliders into a namespace of our own, so both the file
+// static CollideBoxes and CollideConvex can be called directly.
+namespace collide
+{
+#include "../../Source/Collision/b2CollidePoly.cpp"
+}
+
+static const float32 k_tolerance = 1.0e-4f;
+
+// A fixed generator, so every run and platform sees the same inputs.
+static uint32 s_seed = 12345;
+
+static float32 Random(float32 lo, float32 hi)
+{
+	s_seed = s_seed * 1664525u + 1013904223u;
+	return lo + (hi - lo) * float32(s_seed >> 8) / float32(1 << 24);
+}
+
+static b2XForm RandomXForm(const b2Vec2& position)
+{
+	b2XForm xf;
+	xf.R.Set(Random(-b2_pi, b2_pi));
+	xf.position = position;
+	return xf;
+}
+
+struct Stats
+{
+	Stats() : pairs(0), touching(0), countMismatches(0), idMismatches(0), maxError(0.0f) {}
+
+	int32 pairs;
+	int32 touching;
+	int32 countMismatches;
+	int32 idMismatches;
+	float32 maxError;
+};
+
+static float32 Error(const b2Vec2& a, const b2Vec2& b)
+{
+	return b2Max(b2Abs(a.x - b.x), b2Abs(a.y - b.y));
+}
+
+template <typename TA, typename TB>
+static void Compare(Stats* stats, const TA* a, const b2XForm& xfA, const TB* b, const b2XForm& xfB)
+{
+	b2Manifold generic, box;
+	collide::CollideConvex(&generic, a, xfA, b, xfB);
+	collide::CollideBoxes(&box, a, xfA, b, xfB);
+
+	++stats->pairs;
+	if (generic.pointCount != box.pointCount)
+	{
+		++stats->countMismatches;
+		return;
+	}
+	if (generic.pointCount == 0)
+	{
+		return;
+	}
+
+	++stats->touching;
+	float32 error = Error(generic.normal, box.normal);
+	for (int32 i = 0; i < generic.pointCount; ++i)
+	{
+		const b2ManifoldPoint& g = generic.points[i];
+		const b2ManifoldPoint& p = box.points[i];
+		if (g.id.key != p.id.key)
+		{
+			++stats->idMismatches;
+		}
+		error = b2Max(error, Error(g.localPoint1, p.localPoint1));
+		error = b2Max(error, Error(g.localPoint2, p.localPoint2));
+		error = b2Max(error, b2Abs(g.separation - p.separation));
+	}
+	stats->maxError = b2Max(stats->maxError, error);
+}
+
+static bool Report(const char* name, const Stats& stats)
+{
+	bool ok = stats.countMismatches == 0 && stats.idMismatches == 0
+		&& stats.maxError <= k_tolerance;
+	printf("%-24s %7d pairs %7d touching  count %d  ids %d  max error %g  %s\n",
+		   name, stats.pairs, stats.touching, stats.countMismatches,
+		   stats.idMismatches, stats.maxError, ok ? "ok" : "FAILED");
+	return ok;
+}
+
+int main()
+{
+	b2AABB worldAABB;
+	worldAABB.lowerBound.Set(-1000.0f, -1000.0f);
+	worldAABB.upperBound.Set(1000.0f, 1000.0f);
+	b2World world(worldAABB, b2Vec2(0.0f, -10.0f), false);
+
+	b2BodyDef bd;
+	b2Body* body = world.CreateBody(&bd);
+
+	// A pool of boxes of assorted sizes, some off centre and rotated.
+	const int32 boxCount = 64;
+	const b2PolygonShape* boxes[boxCount];
+	for (int32 i = 0; i < boxCount; ++i)
+	{
+		b2PolygonDef sd;
+		float32 hx = Random(0.05f, 2.0f);
+		float32 hy = Random(0.05f, 2.0f);
+		if (i % 2)
+		{
+			sd.SetAsBox(hx, hy, b2Vec2(Random(-1.0f, 1.0f), Random(-1.0f, 1.0f)), Random(-b2_pi, b2_pi));
+		}
+		else
+		{
+			sd.SetAsBox(hx, hy);
+		}
+		boxes[i] = (const b2PolygonShape*)body->CreateShape(&sd);
+		b2Assert(boxes[i]->IsBox());
+	}
+
+	// A random walk of thin segments.
+	const int32 vertexCount = 65;
+	b2Vec2 vertices[vertexCount];
+	vertices[0].SetZero();
+	for (int32 i = 1; i < vertexCount; ++i)
+	{
+		float32 angle = Random(-b2_pi, b2_pi);
+		float32 length = Random(0.2f, 3.0f);
+		vertices[i] = vertices[i-1] + length * b2Vec2(cosf(angle), sinf(angle));
+	}
+	b2ChainDef cd;
+	cd.vertices = vertices;
+	cd.vertexCount = vertexCount;
+	const b2ChainShape* chain = (const b2ChainShape*)body->CreateShape(&cd);
+	const b2ChainSegment* segments = chain->GetSegments();
+	int32 segmentCount = chain->GetSegmentCount();
+
+	bool ok = true;
+
+	Stats polygons;
+	for (int32 i = 0; i < 200000; ++i)
+	{
+		const b2PolygonShape* a = boxes[s_seed % boxCount];
+		b2XForm xfA = RandomXForm(b2Vec2(Random(-10.0f, 10.0f), Random(-10.0f, 10.0f)));
+		const b2PolygonShape* b = boxes[(s_seed >> 8) % boxCount];
+		b2Vec2 offset(Random(-4.0f, 4.0f), Random(-4.0f, 4.0f));
+		b2XForm xfB = RandomXForm(b2Mul(xfA, a->GetCentroid()) + offset);
+		xfB.position -= b2Mul(xfB.R, b->GetCentroid());
+		Compare(&polygons, a, xfA, b, xfB);
+	}
+	ok = Report("box vs box", polygons) && ok;
+
+	Stats chainBoxes;
+	for (int32 i = 0; i < 50000; ++i)
+	{
+		const b2ChainSegment* a = segments + s_seed % segmentCount;
+		b2XForm xfA = RandomXForm(b2Vec2(Random(-10.0f, 10.0f), Random(-10.0f, 10.0f)));
+		const b2PolygonShape* b = boxes[(s_seed >> 8) % boxCount];
+		b2Vec2 offset(Random(-2.0f, 2.0f), Random(-2.0f, 2.0f));
+		b2XForm xfB = RandomXForm(b2Mul(xfA, a->GetCentroid()) + offset);
+		xfB.position -= b2Mul(xfB.R, b->GetCentroid());
+		Compare(&chainBoxes, a, xfA, b, xfB);
+	}
+	ok = Report("chain segment vs box", chainBoxes) && ok;
+
+	Stats chains;
+	for (int32 i = 0; i < 50000; ++i)
+	{
+		const b2ChainSegment* a = segments + s_seed % segmentCount;
+		b2XForm xfA = RandomXForm(b2Vec2(Random(-10.0f, 10.0f), Random(-10.0f, 10.0f)));
+		const b2ChainSegment* b = segments + (s_seed >> 8) % segmentCount;
+		b2Vec2 offset(Random(-1.0f, 1.0f), Random(-1.0f, 1.0f));
+		b2XForm xfB = RandomXForm(b2Mul(xfA, a->GetCentroid()) + offset);
+		xfB.position -= b2Mul(xfB.R, b->GetCentroid());
+		Compare(&chains, a, xfA, b, xfB);
+	}
+	ok = Report("chain segment vs segment", chains) && ok;
+
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,182 @@
+/*
+* Copyright (c) 2006-2007 Erin Catto http://www.gphysics.com
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+// Contact solver back ends on stacked-box and long-chain workloads.
+// Each world runs with sleep off and 8 iterations; the time is ms/step,
+// best of 5 blocks of 60 steps. The height of a marker body is printed
+// so the back ends' results can be compared.
+
+#include "Box2D.h"
+#include "../../Source/Common/b2Timer.h"
+#include <cstdio>
+
+static const int32 k_blocks = 5;
+static const int32 k_steps = 60;
+static const int32 k_iterations = 8;
+
+static b2World* CreateWorld()
+{
+	b2AABB worldAABB;
+	worldAABB.lowerBound.Set(-500.0f, -100.0f);
+	worldAABB.upperBound.Set(500.0f, 500.0f);
+	return new b2World(worldAABB, b2Vec2(0.0f, -10.0f), false);
+}
+
+static b2Body* CreateGround(b2World* world, float32 halfWidth)
+{
+	b2BodyDef bd;
+	bd.position.Set(0.0f, -1.0f);
+	b2Body* ground = world->CreateBody(&bd);
+	b2PolygonDef sd;
+	sd.SetAsBox(halfWidth, 1.0f);
+	ground->CreateShape(&sd);
+	return ground;
+}
+
+static b2Body* CreateBox(b2World* world, float32 x, float32 y, float32 hx, float32 hy,
+						 int16 group = 0)
+{
+	b2BodyDef bd;
+	bd.position.Set(x, y);
+	b2Body* body = world->CreateBody(&bd);
+	b2PolygonDef sd;
+	sd.SetAsBox(hx, hy);
+	sd.density = 1.0f;
+	sd.friction = 0.6f;
+	sd.filter.groupIndex = group;
+	body->CreateShape(&sd);
+	body->SetMassFromShapes();
+	return body;
+}
+
+// A 30 row pyramid of unit boxes, 465 bodies. The marker is the top box.
+static b2Body* Pyramid(b2World* world)
+{
+	CreateGround(world, 40.0f);
+	const int32 rows = 30;
+	b2Body* top = NULL;
+	for (int32 row = 0; row < rows; ++row)
+	{
+		int32 count = rows - row;
+		for (int32 i = 0; i < count; ++i)
+		{
+			float32 x = 1.05f * (i - 0.5f * (count - 1));
+			top = CreateBox(world, x, 0.5f + 1.0f * row, 0.5f, 0.5f);
+		}
+	}
+	return top;
+}
+
+// A 200 link chain lying on the ground with 100 boxes dropped on it.
+// The marker is the middle link.
+static b2Body* Chain(b2World* world)
+{
+	CreateGround(world, 150.0f);
+	const int32 links = 200;
+	const float32 y = 0.125f;
+	const float32 x0 = -0.5f * links;
+
+	b2RevoluteJointDef jd;
+	b2Body* prev = NULL;
+	b2Body* middle = NULL;
+	for (int32 i = 0; i < links; ++i)
+	{
+		b2Body* link = CreateBox(world, x0 + i + 0.5f, y, 0.5f, 0.125f, -1);
+		if (prev)
+		{
+			jd.Initialize(prev, link, b2Vec2(x0 + i, y));
+			world->CreateJoint(&jd);
+		}
+		prev = link;
+		if (i == links / 2)
+		{
+			middle = link;
+		}
+	}
+
+	for (int32 i = 0; i < 100; ++i)
+	{
+		CreateBox(world, x0 + 10.0f + 1.8f * i, 1.0f + 1.5f * (i % 3), 0.4f, 0.4f);
+	}
+	return middle;
+}
+
+// 150 separate stacks of two boxes: islands too small for the lanes, so
+// every back end runs the scalar solver. The marker is the last top box.
+static b2Body* Islands(b2World* world)
+{
+	CreateGround(world, 250.0f);
+	b2Body* top = NULL;
+	for (int32 i = 0; i < 150; ++i)
+	{
+		float32 x = 3.0f * (i - 75);
+		CreateBox(world, x, 0.5f, 0.5f, 0.5f);
+		top = CreateBox(world, x, 1.5f, 0.5f, 0.5f);
+	}
+	return top;
+}
+
+typedef b2Body* (*Workload)(b2World* world);
+
+static void Run(const char* name, Workload workload)
+{
+	static const b2ContactSolverType types[] =
+	{
+		e_scalarContactSolver, e_sse2ContactSolver, e_avx2ContactSolver
+	};
+	static const char* typeNames[] = { "scalar", "sse2", "avx2" };
+
+	for (int32 t = 0; t < 3; ++t)
+	{
+		b2World* world = CreateWorld();
+		world->SetContactSolver(types[t]);
+		if (world->GetContactSolver() != types[t])
+		{
+			printf("%-10s %-8s unsupported\n", name, typeNames[t]);
+			delete world;
+			continue;
+		}
+		b2Body* marker = workload(world);
+
+		float32 best = 0.0f;
+		b2Timer timer;
+		for (int32 b = 0; b < k_blocks; ++b)
+		{
+			timer.Reset();
+			for (int32 i = 0; i < k_steps; ++i)
+			{
+				world->Step(1.0f / 60.0f, k_iterations);
+			}
+			float32 ms = timer.GetMilliseconds() / k_steps;
+			if (b == 0 || ms < best) best = ms;
+		}
+		printf("%-10s %-8s %8.3f ms/step   marker y %.3f\n",
+			   name, typeNames[t], best, marker->GetPosition().y);
+		delete world;
+	}
+}
+
+int main()
+{
+	printf("contact solver: %d iterations, best of %d blocks of %d steps\n",
+		   k_iterations, k_blocks, k_steps);
+	Run("pyramid", Pyramid);
+	Run("chain", Chain);
+	Run("islands", Islands);
+	return 0;
+}
@@ -35,9 +35,11 @@ For discussion please visit http://www.box2d.org/forum
 
 #include "../Source/Collision/Shapes/b2CircleShape.h"
 #include "../Source/Collision/Shapes/b2PolygonShape.h"
+#include "../Source/Collision/Shapes/b2ChainShape.h"
 #include "../Source/Collision/b2BroadPhase.h"
 #include "../Source/Dynamics/b2WorldCallbacks.h"
 #include "../Source/Dynamics/b2World.h"
+#include "../Source/Dynamics/b2WorldState.h"
 #include "../Source/Dynamics/b2Body.h"
 
 #include "../Source/Dynamics/Contacts/b2Contact.h"
@@ -0,0 +1,284 @@
+/*
+* Copyright (c) 2006-2007 Erin Catto http://www.gphysics.com
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "b2ChainShape.h"
+
+b2Vec2 b2ChainSegment::Support(const b2XForm& xf, const b2Vec2& d) const
+{
+	b2Vec2 dLocal = b2MulT(xf.R, d);
+
+	int32 bestIndex = 0;
+	float32 bestValue = b2Dot(coreVertices[0], dLocal);
+	for (int32 i = 1; i < 4; ++i)
+	{
+		float32 value = b2Dot(coreVertices[i], dLocal);
+		if (value > bestValue)
+		{
+			bestIndex = i;
+			bestValue = value;
+		}
+	}
+
+	return b2Mul(xf, coreVertices[bestIndex]);
+}
+
+b2ChainShape::b2ChainShape(const b2ShapeDef* def)
+	: b2Shape(def)
+{
+	b2Assert(def->type == e_chainShape);
+	m_type = e_chainShape;
+	const b2ChainDef* chain = (const b2ChainDef*)def;
+
+	b2Assert(chain->vertexCount >= 2);
+
+	// Segment indices are packed into 16 bits in chain-vs-chain manifold keys.
+	b2Assert(chain->vertexCount - 1 <= 0xFFFF);
+
+	// The segment box must be thick enough to hold a core box for CCD.
+	m_radius = chain->radius;
+	b2Assert(m_radius > b2_toiSlop);
+
+	m_segments = (b2ChainSegment*)b2Alloc((chain->vertexCount - 1) * sizeof(b2ChainSegment));
+	m_segmentCount = 0;
+
+	m_aabb.lowerBound.Set(B2_FLT_MAX, B2_FLT_MAX);
+	m_aabb.upperBound.Set(-B2_FLT_MAX, -B2_FLT_MAX);
+
+	for (int32 i = 1; i < chain->vertexCount; ++i)
+	{
+		b2Vec2 v1 = chain->vertices[i-1];
+		b2Vec2 v2 = chain->vertices[i];
+
+		b2Vec2 u = v2 - v1;
+		float32 length = u.Normalize();
+
+		// Skip degenerate segments, they have no orientation.
+		if (length < b2_linearSlop)
+		{
+			continue;
+		}
+
+		b2Vec2 w(-u.y, u.x);
+		float32 hx = 0.5f * length;
+		float32 hy = m_radius;
+
+		b2ChainSegment* s = m_segments + m_segmentCount;
+		s->centroid = 0.5f * (v1 + v2);
+
+		// Same layout as b2PolygonDef::SetAsBox: CCW, edge i runs from
+		// vertex i to vertex i+1.
+		s->vertices[0] = s->centroid - hx * u - hy * w;
+		s->vertices[1] = s->centroid + hx * u - hy * w;
+		s->vertices[2] = s->centroid + hx * u + hy * w;
+		s->vertices[3] = s->centroid - hx * u + hy * w;
+
+		s->normals[0] = -w;
+		s->normals[1] = u;
+		s->normals[2] = w;
+		s->normals[3] = -u;
+
+		// Core box shrunk by b2_toiSlop. Very short segments collapse
+		// to a line, which GJK handles fine.
+		float32 cx = b2Max(hx - b2_toiSlop, 0.0f);
+		float32 cy = hy - b2_toiSlop;
+		s->coreVertices[0] = s->centroid - cx * u - cy * w;
+		s->coreVertices[1] = s->centroid + cx * u - cy * w;
+		s->coreVertices[2] = s->centroid + cx * u + cy * w;
+		s->coreVertices[3] = s->centroid - cx * u + cy * w;
+
+		s->aabb.lowerBound = b2Min(b2Min(s->vertices[0], s->vertices[1]), b2Min(s->vertices[2], s->vertices[3]));
+		s->aabb.upperBound = b2Max(b2Max(s->vertices[0], s->vertices[1]), b2Max(s->vertices[2], s->vertices[3]));
+
+		m_aabb.lowerBound = b2Min(m_aabb.lowerBound, s->aabb.lowerBound);
+		m_aabb.upperBound = b2Max(m_aabb.upperBound, s->aabb.upperBound);
+
+		++m_segmentCount;
+	}
+
+	// You are creating a chain with no usable segments.
+	b2Assert(m_segmentCount > 0);
+}
+
+b2ChainShape::~b2ChainShape()
+{
+	b2Free(m_segments);
+}
+
+void b2ChainShape::UpdateSweepRadius(const b2Vec2& center)
+{
+	// Update the sweep radius (maximum radius) as measured from
+	// a local center point.
+	m_sweepRadius = 0.0f;
+	for (int32 i = 0; i < m_segmentCount; ++i)
+	{
+		for (int32 j = 0; j < 4; ++j)
+		{
+			b2Vec2 d = m_segments[i].coreVertices[j] - center;
+			m_sweepRadius = b2Max(m_sweepRadius, d.Length());
+		}
+	}
+}
+
+bool b2ChainShape::TestPoint(const b2XForm& xf, const b2Vec2& p) const
+{
+	b2Vec2 pLocal = b2MulT(xf, p);
+
+	for (int32 i = 0; i < m_segmentCount; ++i)
+	{
+		const b2ChainSegment* s = m_segments + i;
+
+		bool inside = true;
+		for (int32 j = 0; j < 4; ++j)
+		{
+			if (b2Dot(s->normals[j], pLocal - s->vertices[j]) > 0.0f)
+			{
+				inside = false;
+				break;
+			}
+		}
+
+		if (inside)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool b2ChainShape::TestSegment(
+	const b2XForm& xf,
+	float32* lambda,
+	b2Vec2* normal,
+	const b2Segment& segment,
+	float32 maxLambda) const
+{
+	b2Vec2 p1 = b2MulT(xf, segment.p1);
+	b2Vec2 p2 = b2MulT(xf, segment.p2);
+	b2Vec2 d = p2 - p1;
+
+	// Clip the ray against each segment box, see b2PolygonShape::TestSegment.
+	// maxLambda shrinks as hits are found so we keep the closest one.
+	bool hit = false;
+	for (int32 i = 0; i < m_segmentCount; ++i)
+	{
+		const b2ChainSegment* s = m_segments + i;
+
+		float32 lower = 0.0f, upper = maxLambda;
+		int32 index = -1;
+
+		for (int32 j = 0; j < 4; ++j)
+		{
+			float32 numerator = b2Dot(s->normals[j], s->vertices[j] - p1);
+			float32 denominator = b2Dot(s->normals[j], d);
+
+			if (denominator < 0.0f && numerator < lower * denominator)
+			{
+				lower = numerator / denominator;
+				index = j;
+			}
+			else if (denominator > 0.0f && numerator < upper * denominator)
+			{
+				upper = numerator / denominator;
+			}
+
+			if (upper < lower)
+			{
+				index = -1;
+				break;
+			}
+		}
+
+		if (index >= 0)
+		{
+			maxLambda = lower;
+			*lambda = lower;
+			*normal = b2Mul(xf.R, s->normals[index]);
+			hit = true;
+		}
+	}
+
+	return hit;
+}
+
+void b2ChainShape::ComputeAABB(b2AABB* aabb, const b2XForm& xf) const
+{
+	b2Vec2 lower(B2_FLT_MAX, B2_FLT_MAX);
+	b2Vec2 upper(-B2_FLT_MAX, -B2_FLT_MAX);
+
+	for (int32 i = 0; i < m_segmentCount; ++i)
+	{
+		const b2ChainSegment* s = m_segments + i;
+		for (int32 j = 0; j < 4; ++j)
+		{
+			b2Vec2 v = b2Mul(xf, s->vertices[j]);
+			lower = b2Min(lower, v);
+			upper = b2Max(upper, v);
+		}
+	}
+
+	aabb->lowerBound = lower;
+	aabb->upperBound = upper;
+}
+
+void b2ChainShape::ComputeSweptAABB(b2AABB* aabb,
+					  const b2XForm& transform1,
+					  const b2XForm& transform2) const
+{
+	b2AABB aabb1, aabb2;
+	ComputeAABB(&aabb1, transform1);
+	ComputeAABB(&aabb2, transform2);
+	aabb->lowerBound = b2Min(aabb1.lowerBound, aabb2.lowerBound);
+	aabb->upperBound = b2Max(aabb1.upperBound, aabb2.upperBound);
+}
+
+void b2ChainShape::ComputeMass(b2MassData* massData) const
+{
+	// Sum the boxes. A box of half-widths (hx, hy) centered at c has
+	// area 4 * hx * hy and inertia about the origin of
+	// area * ((hx * hx + hy * hy) / 3 + dot(c, c)) per unit density.
+	b2Vec2 center; center.Set(0.0f, 0.0f);
+	float32 area = 0.0f;
+	float32 I = 0.0f;
+
+	const float32 k_inv3 = 1.0f / 3.0f;
+
+	for (int32 i = 0; i < m_segmentCount; ++i)
+	{
+		const b2ChainSegment* s = m_segments + i;
+
+		float32 hx = 0.5f * b2Dot(s->vertices[1] - s->vertices[0], s->normals[1]);
+		float32 hy = m_radius;
+		float32 boxArea = 4.0f * hx * hy;
+
+		area += boxArea;
+		center += boxArea * s->centroid;
+		I += boxArea * (k_inv3 * (hx * hx + hy * hy) + b2Dot(s->centroid, s->centroid));
+	}
+
+	// Total mass
+	massData->mass = m_density * area;
+
+	// Center of mass
+	b2Assert(area > B2_FLT_EPSILON);
+	center *= 1.0f / area;
+	massData->center = center;
+
+	// Inertia tensor relative to the local origin.
+	massData->I = m_density * I;
+}
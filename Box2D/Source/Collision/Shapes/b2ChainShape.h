@@ -0,0 +1,162 @@
+/*
+* Copyright (c) 2006-2007 Erin Catto http://www.gphysics.com
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B2_CHAIN_SHAPE_H
+#define B2_CHAIN_SHAPE_H
+
+#include "b2Shape.h"
+
+/// This structure is used to build chain shapes. A chain is an open
+/// polyline where every segment is swept into a box of half-width radius.
+/// The vertices are copied when the shape is created.
+struct b2ChainDef : public b2ShapeDef
+{
+	b2ChainDef()
+	{
+		type = e_chainShape;
+		vertices = NULL;
+		vertexCount = 0;
+		radius = 0.1f;
+	}
+
+	/// The chain vertices in local coordinates.
+	const b2Vec2* vertices;
+
+	/// The number of chain vertices. There must be at least two.
+	int32 vertexCount;
+
+	/// The half-thickness of each segment.
+	float32 radius;
+};
+
+/// One segment of a chain: an oriented box around the segment, laid out
+/// like a 4 vertex polygon so the convex collision and distance code can
+/// be shared with b2PolygonShape.
+struct b2ChainSegment
+{
+	int32 GetVertexCount() const { return 4; }
+	const b2Vec2* GetVertices() const { return vertices; }
+	const b2Vec2* GetNormals() const { return normals; }
+	const b2Vec2& GetCentroid() const { return centroid; }
+
+	/// Get the first core vertex and apply the supplied transform.
+	b2Vec2 GetFirstVertex(const b2XForm& xf) const { return b2Mul(xf, coreVertices[0]); }
+
+	/// Get the support point in the given world direction.
+	b2Vec2 Support(const b2XForm& xf, const b2Vec2& d) const;
+
+	b2Vec2 vertices[4];
+	b2Vec2 normals[4];
+	b2Vec2 coreVertices[4];
+	b2Vec2 centroid;
+
+	/// Bounds of the segment box relative to the parent body.
+	b2AABB aabb;
+};
+
+/// A chain of thick segments sharing a single broad-phase proxy. This is
+/// much cheaper than one polygon per segment: the broad-phase sees one
+/// proxy and the narrow-phase culls segments with their local bounds.
+class b2ChainShape : public b2Shape
+{
+public:
+	/// @see b2Shape::TestPoint
+	bool TestPoint(const b2XForm& transform, const b2Vec2& p) const;
+
+	/// @see b2Shape::TestSegment
+	bool TestSegment(	const b2XForm& transform,
+						float32* lambda,
+						b2Vec2* normal,
+						const b2Segment& segment,
+						float32 maxLambda) const;
+
+	/// @see b2Shape::ComputeAABB
+	void ComputeAABB(b2AABB* aabb, const b2XForm& transform) const;
+
+	/// @see b2Shape::ComputeSweptAABB
+	void ComputeSweptAABB(	b2AABB* aabb,
+							const b2XForm& transform1,
+							const b2XForm& transform2) const;
+
+	/// @see b2Shape::ComputeMass
+	void ComputeMass(b2MassData* massData) const;
+
+	/// Get the number of segments.
+	int32 GetSegmentCount() const;
+
+	/// Get the segments. Vertices are in local coordinates.
+	const b2ChainSegment* GetSegments() const;
+
+	/// Get the bounds of all segments relative to the parent body.
+	const b2AABB& GetLocalAABB() const;
+
+	/// Get the segment half-thickness.
+	float32 GetRadius() const;
+
+private:
+
+	friend class b2Shape;
+
+	b2ChainShape(const b2ShapeDef* def);
+	~b2ChainShape();
+
+	void UpdateSweepRadius(const b2Vec2& center);
+
+	b2ChainSegment* m_segments;
+	int32 m_segmentCount;
+
+	b2AABB m_aabb;
+	float32 m_radius;
+};
+
+inline int32 b2ChainShape::GetSegmentCount() const
+{
+	return m_segmentCount;
+}
+
+inline const b2ChainSegment* b2ChainShape::GetSegments() const
+{
+	return m_segments;
+}
+
+inline const b2AABB& b2ChainShape::GetLocalAABB() const
+{
+	return m_aabb;
+}
+
+inline float32 b2ChainShape::GetRadius() const
+{
+	return m_radius;
+}
+
+/// Convert a box given relative to frame xf2 into an axis aligned box in frame xf1.
+inline b2AABB b2TransformAABB(const b2AABB& aabb, const b2XForm& xf1, const b2XForm& xf2)
+{
+	b2Mat22 R = b2MulT(xf1.R, xf2.R);
+	b2Vec2 center = 0.5f * (aabb.lowerBound + aabb.upperBound);
+	b2Vec2 extents = 0.5f * (aabb.upperBound - aabb.lowerBound);
+	center = b2MulT(xf1, b2Mul(xf2, center));
+	extents = b2Mul(b2Abs(R), extents);
+
+	b2AABB out;
+	out.lowerBound = center - extents;
+	out.upperBound = center + extents;
+	return out;
+}
+
+#endif
@@ -202,6 +202,19 @@ b2PolygonShape::b2PolygonShape(const b2ShapeDef* def)
 	// Compute the oriented bounding box.
 	ComputeOBB(&m_obb, m_vertices, m_vertexCount);
 
+	// Rectangles take the fixed axis path in b2CollidePolygons. Opposite
+	// edges must be parallel and adjacent edges perpendicular.
+	m_isBox = false;
+	if (m_vertexCount == 4)
+	{
+		const float32 k_tolerance = 0.0001f;
+		m_isBox = b2Abs(b2Cross(m_normals[0], m_normals[2])) < k_tolerance &&
+			b2Abs(b2Cross(m_normals[1], m_normals[3])) < k_tolerance &&
+			b2Abs(b2Dot(m_normals[0], m_normals[1])) < k_tolerance &&
+			b2Dot(m_normals[0], m_normals[2]) < 0.0f &&
+			b2Dot(m_normals[1], m_normals[3]) < 0.0f;
+	}
+
 	// Create core polygon shape by shifting edges inward.
 	// Also compute the min/max radius for CCD.
 	for (int32 i = 0; i < m_vertexCount; ++i)
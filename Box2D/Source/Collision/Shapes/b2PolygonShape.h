@@ -96,6 +96,10 @@ public:
 	/// Get the edge normal vectors. There is one for each vertex.
 	const b2Vec2* GetNormals() const;
 
+	/// Is this polygon a rectangle? Rectangles have the same layout as
+	/// b2PolygonDef::SetAsBox and collide with each other faster.
+	bool IsBox() const;
+
 	/// Get the first vertex and apply the supplied transform.
 	b2Vec2 GetFirstVertex(const b2XForm& xf) const;
 
@@ -123,6 +127,7 @@ private:
 	b2Vec2 m_normals[b2_maxPolygonVertices];
 	b2Vec2 m_coreVertices[b2_maxPolygonVertices];
 	int32 m_vertexCount;
+	bool m_isBox;
 };
 
 inline b2Vec2 b2PolygonShape::GetFirstVertex(const b2XForm& xf) const
@@ -160,4 +165,9 @@ inline const b2Vec2* b2PolygonShape::GetNormals() const
 	return m_normals;
 }
 
+inline bool b2PolygonShape::IsBox() const
+{
+	return m_isBox;
+}
+
 #endif
@@ -19,6 +19,7 @@
 #include "b2Shape.h"
 #include "b2CircleShape.h"
 #include "b2PolygonShape.h"
+#include "b2ChainShape.h"
 #include "../b2Collision.h"
 #include "../b2BroadPhase.h"
 #include "../../Common/b2BlockAllocator.h"
@@ -41,6 +42,12 @@ b2Shape* b2Shape::Create(const b2ShapeDef* def, b2BlockAllocator* allocator)
 			return new (mem) b2PolygonShape(def);
 		}
 
+	case e_chainShape:
+		{
+			void* mem = allocator->Allocate(sizeof(b2ChainShape));
+			return new (mem) b2ChainShape(def);
+		}
+
 	default:
 		b2Assert(false);
 		return NULL;
@@ -61,6 +68,11 @@ void b2Shape::Destroy(b2Shape* s, b2BlockAllocator* allocator)
 		allocator->Free(s, sizeof(b2PolygonShape));
 		break;
 
+	case e_chainShape:
+		s->~b2Shape();
+		allocator->Free(s, sizeof(b2ChainShape));
+		break;
+
 	default:
 		b2Assert(false);
 	}
@@ -133,7 +145,7 @@ bool b2Shape::Synchronize(b2BroadPhase* broadPhase, const b2XForm& transform1, c
 
 	if (broadPhase->InRange(aabb))
 	{
-		broadPhase->MoveProxy(m_proxyId, aabb);
+		broadPhase->MoveProxy(m_proxyId, aabb, transform2.position - transform1.position);
 		return true;
 	}
 	else
@@ -61,6 +61,7 @@ enum b2ShapeType
 	e_unknownShape = -1,
 	e_circleShape,
 	e_polygonShape,
+	e_chainShape,
 	e_shapeTypeCount,
 };
 
@@ -219,7 +220,7 @@ protected:
 	float32 m_friction;
 	float32 m_restitution;
 
-	uint16 m_proxyId;
+	int32 m_proxyId;
 	b2FilterData m_filter;
 
 	bool m_isSensor;
@@ -20,49 +20,16 @@
 #define B2_BROAD_PHASE_H
 
 /*
-This broad phase uses the Sweep and Prune algorithm as described in:
-Collision Detection in Interactive 3D Environments by Gino van den Bergen
-Also, some ideas, such as using integral values for fast compares comes from
-Bullet (http:/www.bulletphysics.com).
+This broad phase uses a dynamic AABB tree (see b2DynamicTree.h). Proxies
+that moved out of their fat AABB are buffered and, on Commit, re-queried
+against the tree to find new pairs and to drop pairs that stopped overlapping.
+There is no proxy limit and the world AABB is only used by InRange.
 */
 
 #include "../Common/b2Settings.h"
 #include "b2Collision.h"
+#include "b2DynamicTree.h"
 #include "b2PairManager.h"
-#include <climits>
-
-#ifdef TARGET_FLOAT32_IS_FIXED
-#define	B2BROADPHASE_MAX	(USHRT_MAX/2)
-#else
-#define	B2BROADPHASE_MAX	USHRT_MAX
-
-#endif
-
-const uint16 b2_invalid = B2BROADPHASE_MAX;
-const uint16 b2_nullEdge = B2BROADPHASE_MAX;
-struct b2BoundValues;
-
-struct b2Bound
-{
-	bool IsLower() const { return (value & 1) == 0; }
-	bool IsUpper() const { return (value & 1) == 1; }
-
-	uint16 value;
-	uint16 proxyId;
-	uint16 stabbingCount;
-};
-
-struct b2Proxy
-{
-	uint16 GetNext() const { return lowerBounds[0]; }
-	void SetNext(uint16 next) { lowerBounds[0] = next; }
-	bool IsValid() const { return overlapCount != b2_invalid; }
-
-	uint16 lowerBounds[2], upperBounds[2];
-	uint16 overlapCount;
-	uint16 timeStamp;
-	void* userData;
-};
 
 class b2BroadPhase
 {
@@ -70,62 +37,55 @@ public:
 	b2BroadPhase(const b2AABB& worldAABB, b2PairCallback* callback);
 	~b2BroadPhase();
 
-	// Use this to see if your proxy is in range. If it is not in range,
-	// it should be destroyed. Otherwise you may get O(m^2) pairs, where m
-	// is the number of proxies that are out of range.
+	// The tree itself is unbounded. The world AABB is kept as a policy
+	// so that bodies that leave it are frozen instead of simulated forever.
 	bool InRange(const b2AABB& aabb) const;
 
-	// Create and destroy proxies. These call Flush first.
-	uint16 CreateProxy(const b2AABB& aabb, void* userData);
+	// Create and destroy proxies. These call Commit first.
+	int32 CreateProxy(const b2AABB& aabb, void* userData);
 	void DestroyProxy(int32 proxyId);
 
 	// Call MoveProxy as many times as you like, then when you are done
 	// call Commit to finalized the proxy pairs (for your time step).
-	void MoveProxy(int32 proxyId, const b2AABB& aabb);
+	// The displacement is the motion of the proxy over the step.
+	void MoveProxy(int32 proxyId, const b2AABB& aabb, const b2Vec2& displacement);
 	void Commit();
 
-	// Get a single proxy. Returns NULL if the id is invalid.
-	b2Proxy* GetProxy(int32 proxyId);
-
 	// Query an AABB for overlapping proxies, returns the user data and
 	// the count, up to the supplied maximum count.
 	int32 Query(const b2AABB& aabb, void** userData, int32 maxCount);
 
-	void Validate();
-	void ValidatePairs();
-
-private:
-	void ComputeBounds(uint16* lowerValues, uint16* upperValues, const b2AABB& aabb);
+	// Get the number of live proxies.
+	int32 GetProxyCount() const { return m_proxyCount; }
 
-	bool TestOverlap(b2Proxy* p1, b2Proxy* p2);
-	bool TestOverlap(const b2BoundValues& b, b2Proxy* p);
+	void Validate();
 
-	void Query(int32* lowerIndex, int32* upperIndex, uint16 lowerValue, uint16 upperValue,
-				b2Bound* bounds, int32 boundCount, int32 axis);
-	void IncrementOverlapCount(int32 proxyId);
-	void IncrementTimeStamp();
+	// Tree query callbacks.
+	bool QueryCallback(int32 proxyId);
 
 public:
 	friend class b2PairManager;
 
+	b2DynamicTree m_tree;
 	b2PairManager m_pairManager;
 
-	b2Proxy m_proxyPool[b2_maxProxies];
-	uint16 m_freeProxy;
-
-	b2Bound m_bounds[2][2*b2_maxProxies];
+	int32* m_moveBuffer;
+	int32 m_moveCapacity;
+	int32 m_moveCount;
 
-	uint16 m_queryResults[b2_maxProxies];
+	int32 m_queryProxyId;
+	void** m_queryResults;
 	int32 m_queryResultCount;
+	int32 m_queryMaxCount;
 
 	b2AABB m_worldAABB;
-	b2Vec2 m_quantizationFactor;
 	int32 m_proxyCount;
-	uint16 m_timeStamp;
 
 	static bool s_validate;
-};
 
+private:
+	void BufferMove(int32 proxyId);
+};
 
 inline bool b2BroadPhase::InRange(const b2AABB& aabb) const
 {
@@ -133,14 +93,4 @@ inline bool b2BroadPhase::InRange(const b2AABB& aabb) const
 	return b2Max(d.x, d.y) < 0.0f;
 }
 
-inline b2Proxy* b2BroadPhase::GetProxy(int32 proxyId)
-{
-	if (proxyId == b2_nullProxy || m_proxyPool[proxyId].IsValid() == false)
-	{
-		return NULL;
-	}
-
-	return m_proxyPool + proxyId;
-}
-
 #endif
@@ -19,6 +19,7 @@
 #include "b2Collision.h"
 #include "Shapes/b2CircleShape.h"
 #include "Shapes/b2PolygonShape.h"
+#include "Shapes/b2ChainShape.h"
 
 void b2CollideCircles(
 	b2Manifold* manifold,
@@ -68,9 +69,11 @@ void b2CollideCircles(
 	manifold->points[0].localPoint2 = b2MulT(xf2, p);
 }
 
-void b2CollidePolygonAndCircle(
+// T is a convex polygon type: b2PolygonShape or a b2ChainSegment.
+template <typename T>
+static void CollideConvexAndCircle(
 	b2Manifold* manifold,
-	const b2PolygonShape* polygon, const b2XForm& xf1,
+	const T* polygon, const b2XForm& xf1,
 	const b2CircleShape* circle, const b2XForm& xf2)
 {
 	manifold->pointCount = 0;
@@ -166,3 +169,50 @@ void b2CollidePolygonAndCircle(
 	manifold->points[0].id.features.referenceEdge = 0;
 	manifold->points[0].id.features.flip = 0;
 }
+
+void b2CollidePolygonAndCircle(
+	b2Manifold* manifold,
+	const b2PolygonShape* polygon, const b2XForm& xf1,
+	const b2CircleShape* circle, const b2XForm& xf2)
+{
+	CollideConvexAndCircle(manifold, polygon, xf1, circle, xf2);
+}
+
+int32 b2CollideChainAndCircle(
+	b2Manifold* manifolds, uint32* keys, int32 maxCount,
+	const b2ChainShape* chain, const b2XForm& xf1,
+	const b2CircleShape* circle, const b2XForm& xf2)
+{
+	// Bound the circle in the chain's frame.
+	b2Vec2 cLocal = b2MulT(xf1, b2Mul(xf2, circle->GetLocalPosition()));
+	b2Vec2 r(circle->GetRadius(), circle->GetRadius());
+	b2AABB box;
+	box.lowerBound = cLocal - r;
+	box.upperBound = cLocal + r;
+
+	const b2ChainSegment* segments = chain->GetSegments();
+	int32 segmentCount = chain->GetSegmentCount();
+
+	int32 count = 0;
+	for (int32 i = 0; i < segmentCount; ++i)
+	{
+		if (b2TestOverlap(segments[i].aabb, box) == false)
+		{
+			continue;
+		}
+
+		b2Manifold m;
+		b2Manifold* manifold = count < maxCount ? manifolds + count : &m;
+		CollideConvexAndCircle(manifold, segments + i, xf1, circle, xf2);
+		if (manifold->pointCount > 0)
+		{
+			if (count < maxCount)
+			{
+				keys[count] = uint32(i);
+			}
+			++count;
+		}
+	}
+
+	return count;
+}
@@ -18,6 +18,7 @@
 
 #include "b2Collision.h"
 #include "Shapes/b2PolygonShape.h"
+#include "Shapes/b2ChainShape.h"
 
 struct ClipVertex
 {
@@ -59,9 +60,13 @@ static int32 ClipSegmentToLine(ClipVertex vOut[2], ClipVertex vIn[2],
 	return numOut;
 }
 
+// The convex routines below are templates so they can run on both
+// b2PolygonShape and b2ChainSegment, which share the vertex/normal accessors.
+
 // Find the separation between poly1 and poly2 for a give edge normal on poly1.
-static float32 EdgeSeparation(const b2PolygonShape* poly1, const b2XForm& xf1, int32 edge1,
-							  const b2PolygonShape* poly2, const b2XForm& xf2)
+template <typename T1, typename T2>
+static float32 EdgeSeparation(const T1* poly1, const b2XForm& xf1, int32 edge1,
+							  const T2* poly2, const b2XForm& xf2)
 {
 	int32 count1 = poly1->GetVertexCount();
 	const b2Vec2* vertices1 = poly1->GetVertices();
@@ -97,9 +102,10 @@ static float32 EdgeSeparation(const b2PolygonShape* poly1, const b2XForm& xf1, i
 }
 
 // Find the max separation between poly1 and poly2 using edge normals from poly1.
+template <typename T1, typename T2>
 static float32 FindMaxSeparation(int32* edgeIndex,
-								 const b2PolygonShape* poly1, const b2XForm& xf1,
-								 const b2PolygonShape* poly2, const b2XForm& xf2)
+								 const T1* poly1, const b2XForm& xf1,
+								 const T2* poly2, const b2XForm& xf2)
 {
 	int32 count1 = poly1->GetVertexCount();
 	const b2Vec2* normals1 = poly1->GetNormals();
@@ -195,9 +201,10 @@ static float32 FindMaxSeparation(int32* edgeIndex,
 	return bestSeparation;
 }
 
+template <typename T1, typename T2>
 static void FindIncidentEdge(ClipVertex c[2],
-							 const b2PolygonShape* poly1, const b2XForm& xf1, int32 edge1,
-							 const b2PolygonShape* poly2, const b2XForm& xf2)
+							 const T1* poly1, const b2XForm& xf1, int32 edge1,
+							 const T2* poly2, const b2XForm& xf2)
 {
 	int32 count1 = poly1->GetVertexCount();
 	const b2Vec2* normals1 = poly1->GetNormals();
@@ -239,74 +246,13 @@ static void FindIncidentEdge(ClipVertex c[2],
 	c[1].id.features.incidentVertex = 1;
 }
 
-// Find edge normal of max separation on A - return if separating axis is found
-// Find edge normal of max separation on B - return if separation axis is found
-// Choose reference edge as min(minA, minB)
-// Find incident edge
-// Clip
-
-// The normal points from 1 to 2
-void b2CollidePolygons(b2Manifold* manifold,
-					  const b2PolygonShape* polyA, const b2XForm& xfA,
-					  const b2PolygonShape* polyB, const b2XForm& xfB)
+// Clip the incident edge against the sides of the reference edge v11-v12
+// and build the manifold. flip says whether the reference edge is on shape B.
+static void ClipIncidentEdge(b2Manifold* manifold, ClipVertex incidentEdge[2],
+							 const b2Vec2& v11, const b2Vec2& v12,
+							 const b2Vec2& sideNormal, const b2Vec2& frontNormal,
+							 const b2XForm& xfA, const b2XForm& xfB, uint8 flip)
 {
-	manifold->pointCount = 0;
-
-	int32 edgeA = 0;
-	float32 separationA = FindMaxSeparation(&edgeA, polyA, xfA, polyB, xfB);
-	if (separationA > 0.0f)
-		return;
-
-	int32 edgeB = 0;
-	float32 separationB = FindMaxSeparation(&edgeB, polyB, xfB, polyA, xfA);
-	if (separationB > 0.0f)
-		return;
-
-	const b2PolygonShape* poly1;	// reference poly
-	const b2PolygonShape* poly2;	// incident poly
-	b2XForm xf1, xf2;
-	int32 edge1;		// reference edge
-	uint8 flip;
-	const float32 k_relativeTol = 0.98f;
-	const float32 k_absoluteTol = 0.001f;
-
-	// TODO_ERIN use "radius" of poly for absolute tolerance.
-	if (separationB > k_relativeTol * separationA + k_absoluteTol)
-	{
-		poly1 = polyB;
-		poly2 = polyA;
-		xf1 = xfB;
-		xf2 = xfA;
-		edge1 = edgeB;
-		flip = 1;
-	}
-	else
-	{
-		poly1 = polyA;
-		poly2 = polyB;
-		xf1 = xfA;
-		xf2 = xfB;
-		edge1 = edgeA;
-		flip = 0;
-	}
-
-	ClipVertex incidentEdge[2];
-	FindIncidentEdge(incidentEdge, poly1, xf1, edge1, poly2, xf2);
-
-	int32 count1 = poly1->GetVertexCount();
-	const b2Vec2* vertices1 = poly1->GetVertices();
-
-	b2Vec2 v11 = vertices1[edge1];
-	b2Vec2 v12 = edge1 + 1 < count1 ? vertices1[edge1+1] : vertices1[0];
-
-	b2Vec2 dv = v12 - v11;
-	b2Vec2 sideNormal = b2Mul(xf1.R, v12 - v11);
-	sideNormal.Normalize();
-	b2Vec2 frontNormal = b2Cross(sideNormal, 1.0f);
-	
-	v11 = b2Mul(xf1, v11);
-	v12 = b2Mul(xf1, v12);
-
 	float32 frontOffset = b2Dot(frontNormal, v11);
 	float32 sideOffset1 = -b2Dot(sideNormal, v11);
 	float32 sideOffset2 = b2Dot(sideNormal, v12);
@@ -350,3 +296,327 @@ void b2CollidePolygons(b2Manifold* manifold,
 
 	manifold->pointCount = pointCount;
 }
+
+// Clip the incident edge of poly2 against the reference edge of poly1
+// and build the manifold. flip says whether poly1 is shape B.
+template <typename T1, typename T2>
+static void ClipEdges(b2Manifold* manifold,
+					  const T1* poly1, const b2XForm& xf1, int32 edge1,
+					  const T2* poly2, const b2XForm& xf2, uint8 flip)
+{
+	ClipVertex incidentEdge[2];
+	FindIncidentEdge(incidentEdge, poly1, xf1, edge1, poly2, xf2);
+
+	int32 count1 = poly1->GetVertexCount();
+	const b2Vec2* vertices1 = poly1->GetVertices();
+
+	b2Vec2 v11 = vertices1[edge1];
+	b2Vec2 v12 = edge1 + 1 < count1 ? vertices1[edge1+1] : vertices1[0];
+
+	b2Vec2 sideNormal = b2Mul(xf1.R, v12 - v11);
+	sideNormal.Normalize();
+	b2Vec2 frontNormal = b2Cross(sideNormal, 1.0f);
+	
+	v11 = b2Mul(xf1, v11);
+	v12 = b2Mul(xf1, v12);
+
+	ClipIncidentEdge(manifold, incidentEdge, v11, v12, sideNormal, frontNormal,
+					 flip ? xf2 : xf1, flip ? xf1 : xf2, flip);
+}
+
+// Rectangles need only two face axes each: edge i+2 is the opposite of
+// edge i. The routines below run the four axis separating axis test and
+// pick the incident edge directly instead of searching the vertices. They
+// take the same reference edge as CollideConvex and build the same
+// manifold, including the feature ids.
+
+// The extents of a rectangle along its first two edge normals.
+template <typename T>
+inline b2Vec2 BoxExtents(const T* box)
+{
+	const b2Vec2* vertices = box->GetVertices();
+	const b2Vec2* normals = box->GetNormals();
+	const b2Vec2& c = box->GetCentroid();
+	return b2Vec2(b2Dot(normals[0], vertices[0] - c), b2Dot(normals[1], vertices[1] - c));
+}
+
+template <typename T1, typename T2>
+static void CollideBoxes(b2Manifold* manifold,
+						 const T1* boxA, const b2XForm& xfA,
+						 const T2* boxB, const b2XForm& xfB)
+{
+	manifold->pointCount = 0;
+
+	const b2Vec2* normalsA = boxA->GetNormals();
+	const b2Vec2* normalsB = boxB->GetNormals();
+
+	// Work in world space like CollideConvex.
+	b2Vec2 a0 = b2Mul(xfA.R, normalsA[0]);
+	b2Vec2 a1 = b2Mul(xfA.R, normalsA[1]);
+	b2Vec2 b0 = b2Mul(xfB.R, normalsB[0]);
+	b2Vec2 b1 = b2Mul(xfB.R, normalsB[1]);
+	b2Vec2 d = b2Mul(xfB, boxB->GetCentroid()) - b2Mul(xfA, boxA->GetCentroid());
+
+	b2Vec2 hA = BoxExtents(boxA);
+	b2Vec2 hB = BoxExtents(boxB);
+
+	float32 c00 = b2Abs(b2Dot(a0, b0));
+	float32 c01 = b2Abs(b2Dot(a0, b1));
+	float32 c10 = b2Abs(b2Dot(a1, b0));
+	float32 c11 = b2Abs(b2Dot(a1, b1));
+
+	// Faces of A. The face on the side of B is edge k or edge k+2.
+	float32 dA0 = b2Dot(d, a0);
+	float32 dA1 = b2Dot(d, a1);
+	float32 sA0 = b2Abs(dA0) - hA.x - (hB.x * c00 + hB.y * c01);
+	float32 sA1 = b2Abs(dA1) - hA.y - (hB.x * c10 + hB.y * c11);
+	if (sA0 > 0.0f || sA1 > 0.0f)
+		return;
+
+	// Faces of B, seen from B so the offset is reversed.
+	float32 dB0 = b2Dot(d, b0);
+	float32 dB1 = b2Dot(d, b1);
+	float32 sB0 = b2Abs(dB0) - hB.x - (hA.x * c00 + hA.y * c10);
+	float32 sB1 = b2Abs(dB1) - hB.y - (hA.x * c01 + hA.y * c11);
+	if (sB0 > 0.0f || sB1 > 0.0f)
+		return;
+
+	int32 edgeA;
+	float32 separationA;
+	if (sA0 >= sA1)
+	{
+		edgeA = dA0 >= 0.0f ? 0 : 2;
+		separationA = sA0;
+	}
+	else
+	{
+		edgeA = dA1 >= 0.0f ? 1 : 3;
+		separationA = sA1;
+	}
+
+	int32 edgeB;
+	float32 separationB;
+	if (sB0 >= sB1)
+	{
+		edgeB = dB0 <= 0.0f ? 0 : 2;
+		separationB = sB0;
+	}
+	else
+	{
+		edgeB = dB1 <= 0.0f ? 1 : 3;
+		separationB = sB1;
+	}
+
+	const float32 k_relativeTol = 0.98f;
+	const float32 k_absoluteTol = 0.001f;
+
+	// Set up the reference box 1 and incident box 2 as in ClipEdges.
+	const b2Vec2* vertices1;
+	const b2Vec2* vertices2;
+	const b2XForm* xf1;
+	const b2XForm* xf2;
+	const b2Vec2* normals1;
+	int32 edge1;
+	b2Vec2 n20, n21;
+	uint8 flip;
+	if (separationB > k_relativeTol * separationA + k_absoluteTol)
+	{
+		vertices1 = boxB->GetVertices();
+		vertices2 = boxA->GetVertices();
+		normals1 = normalsB;
+		xf1 = &xfB;
+		xf2 = &xfA;
+		edge1 = edgeB;
+		n20 = a0;
+		n21 = a1;
+		flip = 1;
+	}
+	else
+	{
+		vertices1 = boxA->GetVertices();
+		vertices2 = boxB->GetVertices();
+		normals1 = normalsA;
+		xf1 = &xfA;
+		xf2 = &xfB;
+		edge1 = edgeA;
+		n20 = b0;
+		n21 = b1;
+		flip = 0;
+	}
+
+	// Edge i runs along normal i+1, so the side normal needs no square root.
+	b2Vec2 frontNormal = b2Mul(xf1->R, normals1[edge1]);
+	b2Vec2 sideNormal = b2Mul(xf1->R, normals1[(edge1 + 1) & 3]);
+
+	// The incident edge is the one whose normal is most anti-parallel
+	// to the reference normal.
+	float32 dot0 = b2Dot(frontNormal, n20);
+	float32 dot1 = b2Dot(frontNormal, n21);
+	int32 i1;
+	if (b2Abs(dot0) >= b2Abs(dot1))
+	{
+		i1 = dot0 <= 0.0f ? 0 : 2;
+	}
+	else
+	{
+		i1 = dot1 <= 0.0f ? 1 : 3;
+	}
+	int32 i2 = (i1 + 1) & 3;
+
+	ClipVertex incidentEdge[2];
+	incidentEdge[0].v = b2Mul(*xf2, vertices2[i1]);
+	incidentEdge[0].id.features.referenceEdge = (uint8)edge1;
+	incidentEdge[0].id.features.incidentEdge = (uint8)i1;
+	incidentEdge[0].id.features.incidentVertex = 0;
+
+	incidentEdge[1].v = b2Mul(*xf2, vertices2[i2]);
+	incidentEdge[1].id.features.referenceEdge = (uint8)edge1;
+	incidentEdge[1].id.features.incidentEdge = (uint8)i2;
+	incidentEdge[1].id.features.incidentVertex = 1;
+
+	b2Vec2 v11 = b2Mul(*xf1, vertices1[edge1]);
+	b2Vec2 v12 = b2Mul(*xf1, vertices1[(edge1 + 1) & 3]);
+
+	ClipIncidentEdge(manifold, incidentEdge, v11, v12, sideNormal, frontNormal, xfA, xfB, flip);
+}
+
+// Find edge normal of max separation on A - return if separating axis is found
+// Find edge normal of max separation on B - return if separation axis is found
+// Choose reference edge as min(minA, minB)
+// Find incident edge
+// Clip
+
+// The normal points from 1 to 2
+template <typename TA, typename TB>
+static void CollideConvex(b2Manifold* manifold,
+						  const TA* polyA, const b2XForm& xfA,
+						  const TB* polyB, const b2XForm& xfB)
+{
+	manifold->pointCount = 0;
+
+	int32 edgeA = 0;
+	float32 separationA = FindMaxSeparation(&edgeA, polyA, xfA, polyB, xfB);
+	if (separationA > 0.0f)
+		return;
+
+	int32 edgeB = 0;
+	float32 separationB = FindMaxSeparation(&edgeB, polyB, xfB, polyA, xfA);
+	if (separationB > 0.0f)
+		return;
+
+	const float32 k_relativeTol = 0.98f;
+	const float32 k_absoluteTol = 0.001f;
+
+	// TODO_ERIN use "radius" of poly for absolute tolerance.
+	if (separationB > k_relativeTol * separationA + k_absoluteTol)
+	{
+		ClipEdges(manifold, polyB, xfB, edgeB, polyA, xfA, 1);
+	}
+	else
+	{
+		ClipEdges(manifold, polyA, xfA, edgeA, polyB, xfB, 0);
+	}
+}
+
+void b2CollidePolygons(b2Manifold* manifold,
+					  const b2PolygonShape* polyA, const b2XForm& xfA,
+					  const b2PolygonShape* polyB, const b2XForm& xfB)
+{
+	if (polyA->IsBox() && polyB->IsBox())
+	{
+		CollideBoxes(manifold, polyA, xfA, polyB, xfB);
+	}
+	else
+	{
+		CollideConvex(manifold, polyA, xfA, polyB, xfB);
+	}
+}
+
+int32 b2CollideChainAndPolygon(b2Manifold* manifolds, uint32* keys, int32 maxCount,
+							   const b2ChainShape* chain, const b2XForm& xf1,
+							   const b2PolygonShape* polygon, const b2XForm& xf2)
+{
+	// Bound the polygon in the chain's frame, then only collide the
+	// segments whose local bounds it touches.
+	b2AABB box;
+	polygon->ComputeAABB(&box, xf2);
+	box = b2TransformAABB(box, xf1, b2XForm_identity);
+
+	const b2ChainSegment* segments = chain->GetSegments();
+	int32 segmentCount = chain->GetSegmentCount();
+
+	int32 count = 0;
+	for (int32 i = 0; i < segmentCount; ++i)
+	{
+		if (b2TestOverlap(segments[i].aabb, box) == false)
+		{
+			continue;
+		}
+
+		b2Manifold m;
+		b2Manifold* manifold = count < maxCount ? manifolds + count : &m;
+		if (polygon->IsBox())
+		{
+			CollideBoxes(manifold, segments + i, xf1, polygon, xf2);
+		}
+		else
+		{
+			CollideConvex(manifold, segments + i, xf1, polygon, xf2);
+		}
+		if (manifold->pointCount > 0)
+		{
+			if (count < maxCount)
+			{
+				keys[count] = uint32(i);
+			}
+			++count;
+		}
+	}
+
+	return count;
+}
+
+int32 b2CollideChains(b2Manifold* manifolds, uint32* keys, int32 maxCount,
+					  const b2ChainShape* chain1, const b2XForm& xf1,
+					  const b2ChainShape* chain2, const b2XForm& xf2)
+{
+	const b2ChainSegment* segments1 = chain1->GetSegments();
+	const b2ChainSegment* segments2 = chain2->GetSegments();
+	int32 segmentCount1 = chain1->GetSegmentCount();
+	int32 segmentCount2 = chain2->GetSegmentCount();
+	const b2AABB& bounds1 = chain1->GetLocalAABB();
+
+	int32 count = 0;
+	for (int32 j = 0; j < segmentCount2; ++j)
+	{
+		// Bound segment j in chain1's frame and cull it against the
+		// whole chain before testing individual segments.
+		b2AABB box = b2TransformAABB(segments2[j].aabb, xf1, xf2);
+		if (b2TestOverlap(bounds1, box) == false)
+		{
+			continue;
+		}
+
+		for (int32 i = 0; i < segmentCount1; ++i)
+		{
+			if (b2TestOverlap(segments1[i].aabb, box) == false)
+			{
+				continue;
+			}
+
+			b2Manifold m;
+			b2Manifold* manifold = count < maxCount ? manifolds + count : &m;
+			CollideBoxes(manifold, segments1 + i, xf1, segments2 + j, xf2);
+			if (manifold->pointCount > 0)
+			{
+				if (count < maxCount)
+				{
+					keys[count] = (uint32(i) << 16) | uint32(j);
+				}
+				++count;
+			}
+		}
+	}
+
+	return count;
+}
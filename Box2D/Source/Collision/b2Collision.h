@@ -29,6 +29,7 @@
 class b2Shape;
 class b2CircleShape;
 class b2PolygonShape;
+class b2ChainShape;
 
 const uint8 b2_nullFeature = UCHAR_MAX;
 
@@ -112,6 +113,27 @@ void b2CollidePolygons(b2Manifold* manifold,
 					   const b2PolygonShape* polygon1, const b2XForm& xf1,
 					   const b2PolygonShape* polygon2, const b2XForm& xf2);
 
+/// Compute the collision manifolds between a chain and a polygon. One manifold
+/// is produced for each chain segment in contact. At most maxCount manifolds
+/// and keys (the segment index) are written; the number found is returned and
+/// may be larger, in which case the caller should grow its buffers and retry.
+int32 b2CollideChainAndPolygon(b2Manifold* manifolds, uint32* keys, int32 maxCount,
+							   const b2ChainShape* chain, const b2XForm& xf1,
+							   const b2PolygonShape* polygon, const b2XForm& xf2);
+
+/// Compute the collision manifolds between a chain and a circle.
+/// @see b2CollideChainAndPolygon
+int32 b2CollideChainAndCircle(b2Manifold* manifolds, uint32* keys, int32 maxCount,
+							  const b2ChainShape* chain, const b2XForm& xf1,
+							  const b2CircleShape* circle, const b2XForm& xf2);
+
+/// Compute the collision manifolds between two chains. One manifold is produced
+/// for each pair of segments in contact, keyed by (index1 << 16) | index2.
+/// @see b2CollideChainAndPolygon
+int32 b2CollideChains(b2Manifold* manifolds, uint32* keys, int32 maxCount,
+					  const b2ChainShape* chain1, const b2XForm& xf1,
+					  const b2ChainShape* chain2, const b2XForm& xf2);
+
 /// Compute the distance between two shapes and the closest points.
 /// @return the distance between the shapes or zero if they are overlapped/touching.
 float32 b2Distance(b2Vec2* x1, b2Vec2* x2,
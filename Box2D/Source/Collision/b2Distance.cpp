@@ -19,6 +19,7 @@
 #include "b2Collision.h"
 #include "Shapes/b2CircleShape.h"
 #include "Shapes/b2PolygonShape.h"
+#include "Shapes/b2ChainShape.h"
 
 int32 g_GJK_Iterations = 0;
 
@@ -305,9 +306,10 @@ struct Point
 
 // GJK is more robust with polygon-vs-point than polygon-vs-circle.
 // So we convert polygon-vs-circle to polygon-vs-point.
+template <typename T>
 static float32 DistancePC(
 	b2Vec2* x1, b2Vec2* x2,
-	const b2PolygonShape* polygon, const b2XForm& xf1,
+	const T* polygon, const b2XForm& xf1,
 	const b2CircleShape* circle, const b2XForm& xf2)
 {
 	Point point;
@@ -333,6 +335,99 @@ static float32 DistancePC(
 	return distance;
 }
 
+// A lower bound on the distance between two boxes.
+static float32 AABBGap(const b2AABB& a, const b2AABB& b)
+{
+	b2Vec2 d = b2Max(b.lowerBound - a.upperBound, a.lowerBound - b.upperBound);
+	return b2Max(d.x, d.y);
+}
+
+// The distance to a chain is the minimum over its segments. Segments whose
+// bounds are farther away than the best distance so far are skipped.
+static float32 DistanceChainAndShape(
+	b2Vec2* x1, b2Vec2* x2,
+	const b2ChainShape* chain, const b2XForm& xf1,
+	const b2Shape* shape2, const b2XForm& xf2)
+{
+	b2AABB box;
+	shape2->ComputeAABB(&box, xf2);
+	box = b2TransformAABB(box, xf1, b2XForm_identity);
+
+	const b2ChainSegment* segments = chain->GetSegments();
+	int32 segmentCount = chain->GetSegmentCount();
+
+	float32 best = B2_FLT_MAX;
+	for (int32 i = 0; i < segmentCount && best > 0.0f; ++i)
+	{
+		if (AABBGap(segments[i].aabb, box) >= best)
+		{
+			continue;
+		}
+
+		b2Vec2 p1, p2;
+		float32 distance;
+		if (shape2->GetType() == e_circleShape)
+		{
+			distance = DistancePC(&p1, &p2, segments + i, xf1, (b2CircleShape*)shape2, xf2);
+		}
+		else
+		{
+			b2Assert(shape2->GetType() == e_polygonShape);
+			distance = DistanceGeneric(&p1, &p2, segments + i, xf1, (b2PolygonShape*)shape2, xf2);
+		}
+
+		if (distance < best)
+		{
+			best = distance;
+			*x1 = p1;
+			*x2 = p2;
+		}
+	}
+
+	return best;
+}
+
+static float32 DistanceChains(
+	b2Vec2* x1, b2Vec2* x2,
+	const b2ChainShape* chain1, const b2XForm& xf1,
+	const b2ChainShape* chain2, const b2XForm& xf2)
+{
+	const b2ChainSegment* segments1 = chain1->GetSegments();
+	const b2ChainSegment* segments2 = chain2->GetSegments();
+	int32 segmentCount1 = chain1->GetSegmentCount();
+	int32 segmentCount2 = chain2->GetSegmentCount();
+	const b2AABB& bounds1 = chain1->GetLocalAABB();
+
+	float32 best = B2_FLT_MAX;
+	for (int32 j = 0; j < segmentCount2 && best > 0.0f; ++j)
+	{
+		b2AABB box = b2TransformAABB(segments2[j].aabb, xf1, xf2);
+		if (AABBGap(bounds1, box) >= best)
+		{
+			continue;
+		}
+
+		for (int32 i = 0; i < segmentCount1 && best > 0.0f; ++i)
+		{
+			if (AABBGap(segments1[i].aabb, box) >= best)
+			{
+				continue;
+			}
+
+			b2Vec2 p1, p2;
+			float32 distance = DistanceGeneric(&p1, &p2, segments1 + i, xf1, segments2 + j, xf2);
+			if (distance < best)
+			{
+				best = distance;
+				*x1 = p1;
+				*x2 = p2;
+			}
+		}
+	}
+
+	return best;
+}
+
 float32 b2Distance(b2Vec2* x1, b2Vec2* x2,
 				   const b2Shape* shape1, const b2XForm& xf1,
 				   const b2Shape* shape2, const b2XForm& xf2)
@@ -360,5 +455,20 @@ float32 b2Distance(b2Vec2* x1, b2Vec2* x2,
 		return DistanceGeneric(x1, x2, (b2PolygonShape*)shape1, xf1, (b2PolygonShape*)shape2, xf2);
 	}
 
+	if (type1 == e_chainShape && type2 == e_chainShape)
+	{
+		return DistanceChains(x1, x2, (b2ChainShape*)shape1, xf1, (b2ChainShape*)shape2, xf2);
+	}
+
+	if (type1 == e_chainShape)
+	{
+		return DistanceChainAndShape(x1, x2, (b2ChainShape*)shape1, xf1, shape2, xf2);
+	}
+
+	if (type2 == e_chainShape)
+	{
+		return DistanceChainAndShape(x2, x1, (b2ChainShape*)shape2, xf2, shape1, xf1);
+	}
+
 	return 0.0f;
 }
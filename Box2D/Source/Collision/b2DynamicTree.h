@@ -0,0 +1,234 @@
+/*
+* Copyright (c) 2006-2007 Erin Catto http://www.gphysics.com
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B2_DYNAMIC_TREE_H
+#define B2_DYNAMIC_TREE_H
+
+/*
+A dynamic AABB tree broad-phase, inspired by Nathanael Presson's btDbvt.
+Leaves are proxies with an AABB fattened by b2_aabbExtension so that small
+movements do not require the tree to be updated. Internal nodes store the
+union of their children. The tree is kept balanced with rotations, so
+insertion, removal and queries are O(log n) and there is no world bound.
+*/
+
+#include "../Common/b2Settings.h"
+#include "b2Collision.h"
+
+const int32 b2_nullNode = -1;
+
+/// A node in the dynamic tree. The client does not interact with this directly.
+struct b2DynamicTreeNode
+{
+	bool IsLeaf() const
+	{
+		return child1 == b2_nullNode;
+	}
+
+	/// This is the fattened AABB.
+	b2AABB aabb;
+
+	void* userData;
+
+	union
+	{
+		int32 parent;
+		int32 next;
+	};
+
+	int32 child1;
+	int32 child2;
+
+	// leaf = 0, free node = -1
+	int32 height;
+};
+
+/// A growable stack of node ids used for tree traversal. Small trees
+/// use the embedded array; larger ones spill into b2Alloc'd memory.
+class b2NodeStack
+{
+public:
+	b2NodeStack();
+	~b2NodeStack();
+
+	void Push(int32 node);
+	int32 Pop();
+	int32 GetCount() const { return m_count; }
+
+private:
+	enum { e_stackSize = 256 };
+
+	int32* m_stack;
+	int32 m_array[e_stackSize];
+	int32 m_count;
+	int32 m_capacity;
+};
+
+/// A dynamic tree arranges data in a binary tree to accelerate
+/// queries such as volume queries. Nodes are pooled and relocatable,
+/// so we use node indices rather than pointers. The pool grows on
+/// demand, so there is no fixed proxy limit.
+class b2DynamicTree
+{
+public:
+	/// Constructing the tree initializes the node pool.
+	b2DynamicTree();
+
+	/// Destroy the tree, freeing the node pool.
+	~b2DynamicTree();
+
+	/// Create a proxy. Provide a tight fitting AABB and a userData pointer.
+	int32 CreateProxy(const b2AABB& aabb, void* userData);
+
+	/// Destroy a proxy. This asserts if the id is invalid.
+	void DestroyProxy(int32 proxyId);
+
+	/// Move a proxy. If the proxy has moved outside of its fattened AABB,
+	/// then the proxy is removed from the tree and re-inserted. Otherwise
+	/// the function returns immediately. The displacement is used to
+	/// fatten the AABB further along the direction of motion.
+	/// @return true if the proxy was re-inserted.
+	bool MoveProxy(int32 proxyId, const b2AABB& aabb, const b2Vec2& displacement);
+
+	/// Get proxy user data.
+	/// @return the proxy user data or NULL if the id is invalid.
+	void* GetUserData(int32 proxyId) const;
+
+	/// Get the fat AABB for a proxy.
+	const b2AABB& GetFatAABB(int32 proxyId) const;
+
+	/// Query an AABB for overlapping proxies. The callback class
+	/// is called for each proxy that overlaps the supplied AABB
+	/// and should return false to terminate the query.
+	template <typename T>
+	void Query(T* callback, const b2AABB& aabb) const;
+
+	/// Validate this tree. For testing.
+	void Validate() const;
+
+	/// Compute the height of the tree. This is O(1).
+	int32 GetHeight() const;
+
+	/// Get the number of nodes in use, including internal nodes.
+	int32 GetNodeCount() const { return m_nodeCount; }
+
+	/// Get the capacity of the node pool. Proxy ids are always less than this.
+	int32 GetNodeCapacity() const { return m_nodeCapacity; }
+
+private:
+
+	int32 AllocateNode();
+	void FreeNode(int32 node);
+
+	void InsertLeaf(int32 node);
+	void RemoveLeaf(int32 node);
+
+	int32 Balance(int32 index);
+
+	void ValidateStructure(int32 index) const;
+	void ValidateMetrics(int32 index) const;
+
+	int32 m_root;
+
+	b2DynamicTreeNode* m_nodes;
+	int32 m_nodeCount;
+	int32 m_nodeCapacity;
+
+	int32 m_freeList;
+};
+
+inline bool b2ContainsAABB(const b2AABB& outer, const b2AABB& inner)
+{
+	return outer.lowerBound.x <= inner.lowerBound.x
+		&& outer.lowerBound.y <= inner.lowerBound.y
+		&& inner.upperBound.x <= outer.upperBound.x
+		&& inner.upperBound.y <= outer.upperBound.y;
+}
+
+inline b2AABB b2CombineAABB(const b2AABB& a, const b2AABB& b)
+{
+	b2AABB c;
+	c.lowerBound = b2Min(a.lowerBound, b.lowerBound);
+	c.upperBound = b2Max(a.upperBound, b.upperBound);
+	return c;
+}
+
+/// Half the perimeter of an AABB, used as the insertion cost metric.
+inline float32 b2AABBPerimeter(const b2AABB& a)
+{
+	return (a.upperBound.x - a.lowerBound.x) + (a.upperBound.y - a.lowerBound.y);
+}
+
+inline void* b2DynamicTree::GetUserData(int32 proxyId) const
+{
+	b2Assert(0 <= proxyId && proxyId < m_nodeCapacity);
+	return m_nodes[proxyId].userData;
+}
+
+inline const b2AABB& b2DynamicTree::GetFatAABB(int32 proxyId) const
+{
+	b2Assert(0 <= proxyId && proxyId < m_nodeCapacity);
+	return m_nodes[proxyId].aabb;
+}
+
+inline int32 b2DynamicTree::GetHeight() const
+{
+	if (m_root == b2_nullNode)
+	{
+		return 0;
+	}
+
+	return m_nodes[m_root].height;
+}
+
+template <typename T>
+inline void b2DynamicTree::Query(T* callback, const b2AABB& aabb) const
+{
+	b2NodeStack stack;
+	stack.Push(m_root);
+
+	while (stack.GetCount() > 0)
+	{
+		int32 nodeId = stack.Pop();
+		if (nodeId == b2_nullNode)
+		{
+			continue;
+		}
+
+		const b2DynamicTreeNode* node = m_nodes + nodeId;
+
+		if (b2TestOverlap(node->aabb, aabb))
+		{
+			if (node->IsLeaf())
+			{
+				bool proceed = callback->QueryCallback(nodeId);
+				if (proceed == false)
+				{
+					return;
+				}
+			}
+			else
+			{
+				stack.Push(node->child1);
+				stack.Push(node->child2);
+			}
+		}
+	}
+}
+
+#endif
@@ -19,13 +19,12 @@
 #include "b2PairManager.h"
 #include "b2BroadPhase.h"
 
-#include <algorithm>
+#include <cstring>
 
 // Thomas Wang's hash, see: http://www.concentric.net/~Ttwang/tech/inthash.htm
-// This assumes proxyId1 and proxyId2 are 16-bit.
 inline uint32 Hash(uint32 proxyId1, uint32 proxyId2)
 {
-	uint32 key = (proxyId2 << 16) | proxyId1;
+	uint32 key = (proxyId2 << 16) ^ proxyId1;
 	key = ~key + (key << 15);
 	key = key ^ (key >> 12);
 	key = key + (key << 2);
@@ -40,48 +39,41 @@ inline bool Equals(const b2Pair& pair, int32 proxyId1, int32 proxyId2)
 	return pair.proxyId1 == proxyId1 && pair.proxyId2 == proxyId2;
 }
 
-inline bool Equals(const b2BufferedPair& pair1, const b2BufferedPair& pair2)
+b2PairManager::b2PairManager()
 {
-	return pair1.proxyId1 == pair2.proxyId1 && pair1.proxyId2 == pair2.proxyId2;
-}
+	m_broadPhase = NULL;
+	m_callback = NULL;
 
-// For sorting.
-inline bool operator < (const b2BufferedPair& pair1, const b2BufferedPair& pair2)
-{
-	if (pair1.proxyId1 < pair2.proxyId1)
+	m_pairCapacity = 64;
+	m_pairCount = 0;
+	m_pairs = (b2Pair*)b2Alloc(m_pairCapacity * sizeof(b2Pair));
+	for (int32 i = 0; i < m_pairCapacity; ++i)
 	{
-		return true;
+		m_pairs[i].next = i + 1;
 	}
+	m_pairs[m_pairCapacity-1].next = b2_nullPair;
+	m_freePair = 0;
 
-	if (pair1.proxyId1 == pair2.proxyId1)
+	m_tableCapacity = 64;
+	m_tableMask = m_tableCapacity - 1;
+	m_hashTable = (int32*)b2Alloc(m_tableCapacity * sizeof(int32));
+	for (int32 i = 0; i < m_tableCapacity; ++i)
 	{
-		return pair1.proxyId2 < pair2.proxyId2;
+		m_hashTable[i] = b2_nullPair;
 	}
 
-	return false;
+	m_proxyCapacity = 0;
+	m_proxyPairs = NULL;
 }
 
-
-b2PairManager::b2PairManager()
+b2PairManager::~b2PairManager()
 {
-	b2Assert(b2IsPowerOfTwo(b2_tableCapacity) == true);
-	b2Assert(b2_tableCapacity >= b2_maxPairs);
-	for (int32 i = 0; i < b2_tableCapacity; ++i)
-	{
-		m_hashTable[i] = b2_nullPair;
-	}
-	m_freePair = 0;
-	for (int32 i = 0; i < b2_maxPairs; ++i)
+	b2Free(m_pairs);
+	b2Free(m_hashTable);
+	if (m_proxyPairs)
 	{
-		m_pairs[i].proxyId1 = b2_nullProxy;
-		m_pairs[i].proxyId2 = b2_nullProxy;
-		m_pairs[i].userData = NULL;
-		m_pairs[i].status = 0;
-		m_pairs[i].next = uint16(i + 1);
+		b2Free(m_proxyPairs);
 	}
-	m_pairs[b2_maxPairs-1].next = b2_nullPair;
-	m_pairCount = 0;
-	m_pairBufferCount = 0;
 }
 
 void b2PairManager::Initialize(b2BroadPhase* broadPhase, b2PairCallback* callback)
@@ -90,307 +82,220 @@ void b2PairManager::Initialize(b2BroadPhase* broadPhase, b2PairCallback* callbac
 	m_callback = callback;
 }
 
-b2Pair* b2PairManager::Find(int32 proxyId1, int32 proxyId2, uint32 hash)
+void b2PairManager::ReserveProxies(int32 proxyCapacity)
 {
-	int32 index = m_hashTable[hash];
-
-	while (index != b2_nullPair && Equals(m_pairs[index], proxyId1, proxyId2) == false)
+	if (proxyCapacity <= m_proxyCapacity)
 	{
-		index = m_pairs[index].next;
+		return;
 	}
 
-	if (index == b2_nullPair)
+	int32* old = m_proxyPairs;
+	m_proxyPairs = (int32*)b2Alloc(proxyCapacity * sizeof(int32));
+	if (old)
 	{
-		return NULL;
+		memcpy(m_proxyPairs, old, m_proxyCapacity * sizeof(int32));
+		b2Free(old);
 	}
 
-	b2Assert(index < b2_maxPairs);
-
-	return m_pairs + index;
+	for (int32 i = m_proxyCapacity; i < proxyCapacity; ++i)
+	{
+		m_proxyPairs[i] = b2_nullPair;
+	}
+	m_proxyCapacity = proxyCapacity;
 }
 
-b2Pair* b2PairManager::Find(int32 proxyId1, int32 proxyId2)
+int32 b2PairManager::Find(int32 proxyId1, int32 proxyId2, uint32 hash) const
 {
-	if (proxyId1 > proxyId2) b2Swap(proxyId1, proxyId2);
+	int32 index = m_hashTable[hash];
 
-	int32 hash = Hash(proxyId1, proxyId2) & b2_tableMask;
+	while (index != b2_nullPair && Equals(m_pairs[index], proxyId1, proxyId2) == false)
+	{
+		index = m_pairs[index].next;
+	}
 
-	return Find(proxyId1, proxyId2, hash);
+	return index;
 }
 
-// Returns existing pair or creates a new one.
-b2Pair* b2PairManager::AddPair(int32 proxyId1, int32 proxyId2)
+int32 b2PairManager::AllocatePair()
 {
-	if (proxyId1 > proxyId2) b2Swap(proxyId1, proxyId2);
-
-	int32 hash = Hash(proxyId1, proxyId2) & b2_tableMask;
-
-	b2Pair* pair = Find(proxyId1, proxyId2, hash);
-	if (pair != NULL)
+	if (m_freePair == b2_nullPair)
 	{
-		return pair;
-	}
-
-	b2Assert(m_pairCount < b2_maxPairs && m_freePair != b2_nullPair);
-
-	uint16 pairIndex = m_freePair;
-	pair = m_pairs + pairIndex;
-	m_freePair = pair->next;
+		b2Assert(m_pairCount == m_pairCapacity);
 
-	pair->proxyId1 = (uint16)proxyId1;
-	pair->proxyId2 = (uint16)proxyId2;
-	pair->status = 0;
-	pair->userData = NULL;
-	pair->next = m_hashTable[hash];
+		b2Pair* oldPairs = m_pairs;
+		m_pairCapacity *= 2;
+		m_pairs = (b2Pair*)b2Alloc(m_pairCapacity * sizeof(b2Pair));
+		memcpy(m_pairs, oldPairs, m_pairCount * sizeof(b2Pair));
+		b2Free(oldPairs);
 
-	m_hashTable[hash] = pairIndex;
+		for (int32 i = m_pairCount; i < m_pairCapacity; ++i)
+		{
+			m_pairs[i].next = i + 1;
+		}
+		m_pairs[m_pairCapacity-1].next = b2_nullPair;
+		m_freePair = m_pairCount;
+	}
 
+	int32 pairId = m_freePair;
+	m_freePair = m_pairs[pairId].next;
 	++m_pairCount;
-
-	return pair;
+	return pairId;
 }
 
-// Removes a pair. The pair must exist.
-void* b2PairManager::RemovePair(int32 proxyId1, int32 proxyId2)
+// Double the hash table once the load factor passes one.
+void b2PairManager::GrowTable()
 {
-	b2Assert(m_pairCount > 0);
-
-	if (proxyId1 > proxyId2) b2Swap(proxyId1, proxyId2);
-
-	int32 hash = Hash(proxyId1, proxyId2) & b2_tableMask;
+	b2Free(m_hashTable);
+	m_tableCapacity *= 2;
+	m_tableMask = m_tableCapacity - 1;
+	m_hashTable = (int32*)b2Alloc(m_tableCapacity * sizeof(int32));
+	for (int32 i = 0; i < m_tableCapacity; ++i)
+	{
+		m_hashTable[i] = b2_nullPair;
+	}
 
-	uint16* node = &m_hashTable[hash];
-	while (*node != b2_nullPair)
+	// Rehash the live pairs. Live pairs are exactly those on a proxy's
+	// pair list, reached here through their first proxy.
+	for (int32 proxyId = 0; proxyId < m_proxyCapacity; ++proxyId)
 	{
-		if (Equals(m_pairs[*node], proxyId1, proxyId2))
+		for (int32 index = m_proxyPairs[proxyId]; index != b2_nullPair; index = GetNext(index, proxyId))
 		{
-			uint16 index = *node;
-			*node = m_pairs[*node].next;
-			
 			b2Pair* pair = m_pairs + index;
-			void* userData = pair->userData;
-
-			// Scrub
-			pair->next = m_freePair;
-			pair->proxyId1 = b2_nullProxy;
-			pair->proxyId2 = b2_nullProxy;
-			pair->userData = NULL;
-			pair->status = 0;
-
-			m_freePair = index;
-			--m_pairCount;
-			return userData;
-		}
-		else
-		{
-			node = &m_pairs[*node].next;
+			if (pair->proxyId1 != proxyId)
+			{
+				continue;
+			}
+
+			uint32 hash = Hash(pair->proxyId1, pair->proxyId2) & m_tableMask;
+			pair->next = m_hashTable[hash];
+			m_hashTable[hash] = index;
 		}
 	}
-
-	b2Assert(false);
-	return NULL;
 }
 
-/*
-As proxies are created and moved, many pairs are created and destroyed. Even worse, the same
-pair may be added and removed multiple times in a single time step of the physics engine. To reduce
-traffic in the pair manager, we try to avoid destroying pairs in the pair manager until the
-end of the physics step. This is done by buffering all the RemovePair requests. AddPair
-requests are processed immediately because we need the hash table entry for quick lookup.
-
-All user user callbacks are delayed until the buffered pairs are confirmed in Commit.
-This is very important because the user callbacks may be very expensive and client logic
-may be harmed if pairs are added and removed within the same time step.
-
-Buffer a pair for addition.
-We may add a pair that is not in the pair manager or pair buffer.
-We may add a pair that is already in the pair manager and pair buffer.
-If the added pair is not a new pair, then it must be in the pair buffer (because RemovePair was called).
-*/
-void b2PairManager::AddBufferedPair(int32 id1, int32 id2)
+void b2PairManager::AddPair(int32 proxyId1, int32 proxyId2)
 {
-	b2Assert(id1 != b2_nullProxy && id2 != b2_nullProxy);
-	b2Assert(m_pairBufferCount < b2_maxPairs);
+	b2Assert(proxyId1 != proxyId2);
 
-	b2Pair* pair = AddPair(id1, id2);
-
-	// If this pair is not in the pair buffer ...
-	if (pair->IsBuffered() == false)
+	if (proxyId1 > proxyId2)
 	{
-		// This must be a newly added pair.
-		b2Assert(pair->IsFinal() == false);
-
-		// Add it to the pair buffer.
-		pair->SetBuffered();
-		m_pairBuffer[m_pairBufferCount].proxyId1 = pair->proxyId1;
-		m_pairBuffer[m_pairBufferCount].proxyId2 = pair->proxyId2;
-		++m_pairBufferCount;
-
-		b2Assert(m_pairBufferCount <= m_pairCount);
+		b2Swap(proxyId1, proxyId2);
 	}
 
-	// Confirm this pair for the subsequent call to Commit.
-	pair->ClearRemoved();
+	uint32 hash = Hash(proxyId1, proxyId2) & m_tableMask;
 
-	if (b2BroadPhase::s_validate)
+	if (Find(proxyId1, proxyId2, hash) != b2_nullPair)
 	{
-		ValidateBuffer();
+		return;
 	}
-}
-
-// Buffer a pair for removal.
-void b2PairManager::RemoveBufferedPair(int32 id1, int32 id2)
-{
-	b2Assert(id1 != b2_nullProxy && id2 != b2_nullProxy);
-	b2Assert(m_pairBufferCount < b2_maxPairs);
 
-	b2Pair* pair = Find(id1, id2);
-
-	if (pair == NULL)
+	if (m_pairCount >= m_tableCapacity)
 	{
-		// The pair never existed. This is legal (due to collision filtering).
-		return;
+		GrowTable();
+		hash = Hash(proxyId1, proxyId2) & m_tableMask;
 	}
 
-	// If this pair is not in the pair buffer ...
-	if (pair->IsBuffered() == false)
-	{
-		// This must be an old pair.
-		b2Assert(pair->IsFinal() == true);
+	int32 pairId = AllocatePair();
+	b2Pair* pair = m_pairs + pairId;
+	pair->proxyId1 = proxyId1;
+	pair->proxyId2 = proxyId2;
 
-		pair->SetBuffered();
-		m_pairBuffer[m_pairBufferCount].proxyId1 = pair->proxyId1;
-		m_pairBuffer[m_pairBufferCount].proxyId2 = pair->proxyId2;
-		++m_pairBufferCount;
+	pair->next = m_hashTable[hash];
+	m_hashTable[hash] = pairId;
 
-		b2Assert(m_pairBufferCount <= m_pairCount);
-	}
+	pair->next1 = m_proxyPairs[proxyId1];
+	m_proxyPairs[proxyId1] = pairId;
+	pair->next2 = m_proxyPairs[proxyId2];
+	m_proxyPairs[proxyId2] = pairId;
 
-	pair->SetRemoved();
+	const b2DynamicTree& tree = m_broadPhase->m_tree;
+	pair->userData = m_callback->PairAdded(tree.GetUserData(proxyId1), tree.GetUserData(proxyId2));
+}
 
-	if (b2BroadPhase::s_validate)
+// Remove the pair from a proxy's pair list.
+void b2PairManager::Unlink(int32 pairId, int32 proxyId)
+{
+	int32* link = m_proxyPairs + proxyId;
+	while (*link != pairId)
 	{
-		ValidateBuffer();
+		b2Assert(*link != b2_nullPair);
+		b2Pair* pair = m_pairs + *link;
+		link = pair->proxyId1 == proxyId ? &pair->next1 : &pair->next2;
 	}
+
+	*link = GetNext(pairId, proxyId);
 }
 
-void b2PairManager::Commit()
+void b2PairManager::RemovePair(int32 pairId)
 {
-	int32 removeCount = 0;
-
-	b2Proxy* proxies = m_broadPhase->m_proxyPool;
+	b2Pair* pair = m_pairs + pairId;
+	int32 proxyId1 = pair->proxyId1;
+	int32 proxyId2 = pair->proxyId2;
 
-	for (int32 i = 0; i < m_pairBufferCount; ++i)
+	uint32 hash = Hash(proxyId1, proxyId2) & m_tableMask;
+	int32* link = m_hashTable + hash;
+	while (*link != pairId)
 	{
-		b2Pair* pair = Find(m_pairBuffer[i].proxyId1, m_pairBuffer[i].proxyId2);
-		b2Assert(pair->IsBuffered());
-		pair->ClearBuffered();
-
-		b2Assert(pair->proxyId1 < b2_maxProxies && pair->proxyId2 < b2_maxProxies);
-
-		b2Proxy* proxy1 = proxies + pair->proxyId1;
-		b2Proxy* proxy2 = proxies + pair->proxyId2;
-
-		b2Assert(proxy1->IsValid());
-		b2Assert(proxy2->IsValid());
-
-		if (pair->IsRemoved())
-		{
-			// It is possible a pair was added then removed before a commit. Therefore,
-			// we should be careful not to tell the user the pair was removed when the
-			// the user didn't receive a matching add.
-			if (pair->IsFinal() == true)
-			{
-				m_callback->PairRemoved(proxy1->userData, proxy2->userData, pair->userData);
-			}
-
-			// Store the ids so we can actually remove the pair below.
-			m_pairBuffer[removeCount].proxyId1 = pair->proxyId1;
-			m_pairBuffer[removeCount].proxyId2 = pair->proxyId2;
-			++removeCount;
-		}
-		else
-		{
-			b2Assert(m_broadPhase->TestOverlap(proxy1, proxy2) == true);
-
-			if (pair->IsFinal() == false)
-			{
-				pair->userData = m_callback->PairAdded(proxy1->userData, proxy2->userData);
-				pair->SetFinal();
-			}
-		}
+		b2Assert(*link != b2_nullPair);
+		link = &m_pairs[*link].next;
 	}
+	*link = pair->next;
 
-	for (int32 i = 0; i < removeCount; ++i)
-	{
-		RemovePair(m_pairBuffer[i].proxyId1, m_pairBuffer[i].proxyId2);
-	}
+	Unlink(pairId, proxyId1);
+	Unlink(pairId, proxyId2);
 
-	m_pairBufferCount = 0;
+	void* userData = pair->userData;
+	pair->next = m_freePair;
+	m_freePair = pairId;
+	--m_pairCount;
 
-	if (b2BroadPhase::s_validate)
-	{
-		ValidateTable();
-	}
+	const b2DynamicTree& tree = m_broadPhase->m_tree;
+	m_callback->PairRemoved(tree.GetUserData(proxyId1), tree.GetUserData(proxyId2), userData);
 }
 
-void b2PairManager::ValidateBuffer()
+void b2PairManager::RemoveStalePairs(int32 proxyId)
 {
-#ifdef _DEBUG
-	b2Assert(m_pairBufferCount <= m_pairCount);
+	const b2DynamicTree& tree = m_broadPhase->m_tree;
+	const b2AABB& aabb = tree.GetFatAABB(proxyId);
 
-	std::sort(m_pairBuffer, m_pairBuffer + m_pairBufferCount);
-
-	for (int32 i = 0; i < m_pairBufferCount; ++i)
+	int32 index = m_proxyPairs[proxyId];
+	while (index != b2_nullPair)
 	{
-		if (i > 0)
+		const b2Pair* pair = m_pairs + index;
+		int32 next = GetNext(index, proxyId);
+		int32 otherId = pair->proxyId1 == proxyId ? pair->proxyId2 : pair->proxyId1;
+
+		if (b2TestOverlap(aabb, tree.GetFatAABB(otherId)) == false)
 		{
-			b2Assert(Equals(m_pairBuffer[i], m_pairBuffer[i-1]) == false);
+			RemovePair(index);
 		}
 
-		b2Pair* pair = Find(m_pairBuffer[i].proxyId1, m_pairBuffer[i].proxyId2);
-		b2Assert(pair->IsBuffered());
-
-		b2Assert(pair->proxyId1 != pair->proxyId2);
-		b2Assert(pair->proxyId1 < b2_maxProxies);
-		b2Assert(pair->proxyId2 < b2_maxProxies);
-
-		b2Proxy* proxy1 = m_broadPhase->m_proxyPool + pair->proxyId1;
-		b2Proxy* proxy2 = m_broadPhase->m_proxyPool + pair->proxyId2;
+		index = next;
+	}
+}
 
-		b2Assert(proxy1->IsValid() == true);
-		b2Assert(proxy2->IsValid() == true);
+void b2PairManager::RemoveProxyPairs(int32 proxyId)
+{
+	while (m_proxyPairs[proxyId] != b2_nullPair)
+	{
+		RemovePair(m_proxyPairs[proxyId]);
 	}
-#endif
 }
 
-void b2PairManager::ValidateTable()
+void b2PairManager::Validate()
 {
-#ifdef _DEBUG
-	for (int32 i = 0; i < b2_tableCapacity; ++i)
+	int32 count = 0;
+	for (int32 i = 0; i < m_tableCapacity; ++i)
 	{
-		uint16 index = m_hashTable[i];
-		while (index != b2_nullPair)
+		for (int32 index = m_hashTable[i]; index != b2_nullPair; index = m_pairs[index].next)
 		{
-			b2Pair* pair = m_pairs + index;
-			b2Assert(pair->IsBuffered() == false);
-			b2Assert(pair->IsFinal() == true);
-			b2Assert(pair->IsRemoved() == false);
-
-			b2Assert(pair->proxyId1 != pair->proxyId2);
-			b2Assert(pair->proxyId1 < b2_maxProxies);
-			b2Assert(pair->proxyId2 < b2_maxProxies);
-
-			b2Proxy* proxy1 = m_broadPhase->m_proxyPool + pair->proxyId1;
-			b2Proxy* proxy2 = m_broadPhase->m_proxyPool + pair->proxyId2;
-
-			b2Assert(proxy1->IsValid() == true);
-			b2Assert(proxy2->IsValid() == true);
-
-			b2Assert(m_broadPhase->TestOverlap(proxy1, proxy2) == true);
-
-			index = pair->next;
+			const b2Pair* pair = m_pairs + index;
+			b2Assert(pair->proxyId1 < pair->proxyId2);
+			b2Assert((Hash(pair->proxyId1, pair->proxyId2) & m_tableMask) == uint32(i));
+			B2_NOT_USED(pair);
+			++count;
 		}
 	}
-#endif
+
+	b2Assert(count == m_pairCount);
 }
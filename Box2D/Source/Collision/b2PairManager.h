@@ -17,8 +17,9 @@
 */
 
 // The pair manager is used by the broad-phase to quickly add/remove/find pairs
-// of overlapping proxies. It is based closely on code provided by Pierre Terdiman.
-// http://www.codercorner.com/IncrementalSAP.txt
+// of overlapping proxies. Pairs live in a growable pool and are indexed both
+// by a hash table keyed on the (ordered) proxy ids and by a per-proxy list, so
+// all pairs of a moved or destroyed proxy can be visited without a full scan.
 
 #ifndef B2_PAIR_MANAGER_H
 #define B2_PAIR_MANAGER_H
@@ -26,47 +27,19 @@
 #include "../Common/b2Settings.h"
 #include "../Common/b2Math.h"
 
-#include <climits>
-
 class b2BroadPhase;
-struct b2Proxy;
 
-const uint16 b2_nullPair = USHRT_MAX;
-const uint16 b2_nullProxy = USHRT_MAX;
-const int32 b2_tableCapacity = b2_maxPairs;	// must be a power of two
-const int32 b2_tableMask = b2_tableCapacity - 1;
+const int32 b2_nullPair = -1;
+const int32 b2_nullProxy = -1;
 
 struct b2Pair
 {
-	enum
-	{
-		e_pairBuffered	= 0x0001,
-		e_pairRemoved	= 0x0002,
-		e_pairFinal		= 0x0004,
-	};
-
-	void SetBuffered()		{ status |= e_pairBuffered; }
-	void ClearBuffered()	{ status &= ~e_pairBuffered; }
-	bool IsBuffered()		{ return (status & e_pairBuffered) == e_pairBuffered; }
-
-	void SetRemoved()		{ status |= e_pairRemoved; }
-	void ClearRemoved()		{ status &= ~e_pairRemoved; }
-	bool IsRemoved()		{ return (status & e_pairRemoved) == e_pairRemoved; }
-
-	void SetFinal()		{ status |= e_pairFinal; }
-	bool IsFinal()		{ return (status & e_pairFinal) == e_pairFinal; }
-
 	void* userData;
-	uint16 proxyId1;
-	uint16 proxyId2;
-	uint16 next;
-	uint16 status;
-};
-
-struct b2BufferedPair
-{
-	uint16 proxyId1;
-	uint16 proxyId2;
+	int32 proxyId1;
+	int32 proxyId2;
+	int32 next;			// hash chain or free list
+	int32 next1;		// next pair in proxyId1's pair list
+	int32 next2;		// next pair in proxyId2's pair list
 };
 
 class b2PairCallback
@@ -87,35 +60,61 @@ class b2PairManager
 {
 public:
 	b2PairManager();
+	~b2PairManager();
 
 	void Initialize(b2BroadPhase* broadPhase, b2PairCallback* callback);
 
-	void AddBufferedPair(int32 proxyId1, int32 proxyId2);
-	void RemoveBufferedPair(int32 proxyId1, int32 proxyId2);
+	// Make room for proxy ids up to (but not including) proxyCapacity.
+	void ReserveProxies(int32 proxyCapacity);
+
+	// Add a pair if it does not exist yet, reporting it to the callback.
+	void AddPair(int32 proxyId1, int32 proxyId2);
 
-	void Commit();
+	// Remove every pair of the proxy whose fat AABBs no longer overlap.
+	void RemoveStalePairs(int32 proxyId);
+
+	// Remove every pair of the proxy. Used when the proxy is destroyed.
+	void RemoveProxyPairs(int32 proxyId);
+
+	int32 GetPairCount() const { return m_pairCount; }
+
+	// Get the first pair of a proxy, then follow GetNext.
+	int32 GetFirstPair(int32 proxyId) const { return m_proxyPairs[proxyId]; }
+	int32 GetNext(int32 pairId, int32 proxyId) const;
+
+	const b2Pair* GetPair(int32 pairId) const { return m_pairs + pairId; }
+
+	void Validate();
 
 private:
-	b2Pair* Find(int32 proxyId1, int32 proxyId2);
-	b2Pair* Find(int32 proxyId1, int32 proxyId2, uint32 hashValue);
+	int32 Find(int32 proxyId1, int32 proxyId2, uint32 hashValue) const;
 
-	b2Pair* AddPair(int32 proxyId1, int32 proxyId2);
-	void* RemovePair(int32 proxyId1, int32 proxyId2);
+	int32 AllocatePair();
+	void RemovePair(int32 pairId);
+	void Unlink(int32 pairId, int32 proxyId);
 
-	void ValidateBuffer();
-	void ValidateTable();
+	void GrowTable();
 
-public:
 	b2BroadPhase *m_broadPhase;
 	b2PairCallback *m_callback;
-	b2Pair m_pairs[b2_maxPairs];
-	uint16 m_freePair;
+
+	b2Pair* m_pairs;
+	int32 m_pairCapacity;
 	int32 m_pairCount;
+	int32 m_freePair;
 
-	b2BufferedPair m_pairBuffer[b2_maxPairs];
-	int32 m_pairBufferCount;
+	int32* m_hashTable;
+	int32 m_tableCapacity;	// must be a power of two
+	int32 m_tableMask;
 
-	uint16 m_hashTable[b2_tableCapacity];
+	int32* m_proxyPairs;
+	int32 m_proxyCapacity;
 };
 
+inline int32 b2PairManager::GetNext(int32 pairId, int32 proxyId) const
+{
+	const b2Pair* pair = m_pairs + pairId;
+	return pair->proxyId1 == proxyId ? pair->next1 : pair->next2;
+}
+
 #endif
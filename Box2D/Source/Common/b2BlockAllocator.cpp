@@ -40,7 +40,6 @@ int32 b2BlockAllocator::s_blockSizes[b2_blockSizes] =
 	640,	// 13
 };
 uint8 b2BlockAllocator::s_blockSizeLookup[b2_maxBlockSize + 1];
-bool b2BlockAllocator::s_blockSizeLookupInitialized;
 
 struct b2Chunk
 {
@@ -60,29 +59,35 @@ b2BlockAllocator::b2BlockAllocator()
 	m_chunkSpace = b2_chunkArrayIncrement;
 	m_chunkCount = 0;
 	m_chunks = (b2Chunk*)b2Alloc(m_chunkSpace * sizeof(b2Chunk));
+	m_allocation = 0;
+	m_maxAllocation = 0;
 	
 	memset(m_chunks, 0, m_chunkSpace * sizeof(b2Chunk));
 	memset(m_freeLists, 0, sizeof(m_freeLists));
 
-	if (s_blockSizeLookupInitialized == false)
+	// Worlds may be created on several threads at once. A local static
+	// is initialized exactly once, and the others wait until it is.
+	static bool lookupInitialized = InitializeBlockSizeLookup();
+	(void)lookupInitialized;
+}
+
+bool b2BlockAllocator::InitializeBlockSizeLookup()
+{
+	int32 j = 0;
+	for (int32 i = 1; i <= b2_maxBlockSize; ++i)
 	{
-		int32 j = 0;
-		for (int32 i = 1; i <= b2_maxBlockSize; ++i)
+		b2Assert(j < b2_blockSizes);
+		if (i <= s_blockSizes[j])
 		{
-			b2Assert(j < b2_blockSizes);
-			if (i <= s_blockSizes[j])
-			{
-				s_blockSizeLookup[i] = (uint8)j;
-			}
-			else
-			{
-				++j;
-				s_blockSizeLookup[i] = (uint8)j;
-			}
+			s_blockSizeLookup[i] = (uint8)j;
+		}
+		else
+		{
+			++j;
+			s_blockSizeLookup[i] = (uint8)j;
 		}
-
-		s_blockSizeLookupInitialized = true;
 	}
+	return true;
 }
 
 b2BlockAllocator::~b2BlockAllocator()
@@ -105,6 +110,12 @@ void* b2BlockAllocator::Allocate(int32 size)
 	int32 index = s_blockSizeLookup[size];
 	b2Assert(0 <= index && index < b2_blockSizes);
 
+	m_allocation += s_blockSizes[index];
+	if (m_allocation > m_maxAllocation)
+	{
+		m_maxAllocation = m_allocation;
+	}
+
 	if (m_freeLists[index])
 	{
 		b2Block* block = m_freeLists[index];
@@ -187,6 +198,8 @@ void b2BlockAllocator::Free(void* p, int32 size)
 	memset(p, 0xfd, blockSize);
 #endif
 
+	m_allocation -= s_blockSizes[index];
+
 	b2Block* block = (b2Block*)p;
 	block->next = m_freeLists[index];
 	m_freeLists[index] = block;
@@ -203,4 +216,34 @@ void b2BlockAllocator::Clear()
 	memset(m_chunks, 0, m_chunkSpace * sizeof(b2Chunk));
 
 	memset(m_freeLists, 0, sizeof(m_freeLists));
+	m_allocation = 0;
+}
+
+void b2BlockAllocator::Reset()
+{
+	memset(m_freeLists, 0, sizeof(m_freeLists));
+
+	// Thread every chunk back onto the free list of its block size.
+	for (int32 i = 0; i < m_chunkCount; ++i)
+	{
+		b2Chunk* chunk = m_chunks + i;
+		int32 blockSize = chunk->blockSize;
+		int32 index = s_blockSizeLookup[blockSize];
+		int32 blockCount = b2_chunkSize / blockSize;
+#if defined(_DEBUG)
+		memset(chunk->blocks, 0xfd, b2_chunkSize);
+#endif
+		for (int32 j = 0; j < blockCount - 1; ++j)
+		{
+			b2Block* block = (b2Block*)((int8*)chunk->blocks + blockSize * j);
+			b2Block* next = (b2Block*)((int8*)chunk->blocks + blockSize * (j + 1));
+			block->next = next;
+		}
+		b2Block* last = (b2Block*)((int8*)chunk->blocks + blockSize * (blockCount - 1));
+		last->next = m_freeLists[index];
+
+		m_freeLists[index] = chunk->blocks;
+	}
+
+	m_allocation = 0;
 }
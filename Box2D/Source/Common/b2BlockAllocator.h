@@ -41,19 +41,35 @@ public:
 	void* Allocate(int32 size);
 	void Free(void* p, int32 size);
 
+	// Free all chunks.
 	void Clear();
 
+	// Free all blocks at once. The chunks are kept for reuse.
+	void Reset();
+
+	// Bytes in allocated blocks, rounded up to the block sizes.
+	int32 GetAllocation() const { return m_allocation; }
+
+	// Peak of GetAllocation.
+	int32 GetMaxAllocation() const { return m_maxAllocation; }
+
+	// Number of b2_chunkSize chunks taken from the heap.
+	int32 GetChunkCount() const { return m_chunkCount; }
+
 private:
 
 	b2Chunk* m_chunks;
 	int32 m_chunkCount;
 	int32 m_chunkSpace;
 
+	int32 m_allocation;
+	int32 m_maxAllocation;
+
 	b2Block* m_freeLists[b2_blockSizes];
 
 	static int32 s_blockSizes[b2_blockSizes];
 	static uint8 s_blockSizeLookup[b2_maxBlockSize + 1];
-	static bool s_blockSizeLookupInitialized;
+	static bool InitializeBlockSizeLookup();
 };
 
 #endif
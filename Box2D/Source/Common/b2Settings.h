@@ -62,6 +62,11 @@ typedef float float32;
 #define	B2FORCE_SCALE(x)	(x)
 #define	B2FORCE_INV_SCALE(x)	(x)
 
+// The SIMD contact solvers need real floats and SSE2/AVX2 intrinsics.
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#define B2_SIMD_CONTACTS
+#endif
+
 #endif
 
 const float32 b2_pi = 3.14159265359f;
@@ -73,8 +78,16 @@ const float32 b2_pi = 3.14159265359f;
 // Collision
 const int32 b2_maxManifoldPoints = 2;
 const int32 b2_maxPolygonVertices = 8;
-const int32 b2_maxProxies = 512*4;				// this must be a power of two
-const int32 b2_maxPairs = 8 * b2_maxProxies;	// this must be a power of two
+
+/// This is used to fatten AABBs in the dynamic tree. This allows proxies
+/// to move by a small amount without triggering a tree adjustment.
+/// This is in meters.
+const float32 b2_aabbExtension = 0.1f;
+
+/// This is used to fatten AABBs in the dynamic tree. This is used to predict
+/// the future position based on the current displacement.
+/// This is a dimensionless multiplier.
+const float32 b2_aabbMultiplier = 2.0f;
 
 // Dynamics
 
@@ -94,6 +107,9 @@ const float32 b2_toiSlop = 8.0f * b2_linearSlop;
 /// Maximum number of contacts to be handled to solve a TOI island.
 const int32 b2_maxTOIContactsPerIsland = 32;
 
+/// Maximum number of warm starting values a joint keeps, see b2WorldState.
+const int32 b2_maxJointStateValues = 9;
+
 /// A velocity threshold for elastic collisions. Any collision with a relative linear
 /// velocity below this threshold will be treated as inelastic.
 const float32 b2_velocityThreshold = 1.0f;		// 1 m/s
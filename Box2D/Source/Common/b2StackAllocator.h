@@ -21,7 +21,7 @@
 
 #include "b2Settings.h"
 
-const int32 b2_stackSize = 100 * 1024;	// 100k
+const int32 b2_stackSize = 100 * 1024;	// 100k, initial capacity
 const int32 b2_maxStackEntries = 32;
 
 struct b2StackEntry
@@ -34,6 +34,8 @@ struct b2StackEntry
 // This is a stack allocator used for fast per step allocations.
 // You must nest allocate/free pairs. The code will assert
 // if you try to interleave multiple allocate/free pairs.
+// Allocations that do not fit fall back to malloc. Once the stack is
+// empty again the buffer grows to the observed peak.
 class b2StackAllocator
 {
 public:
@@ -43,15 +45,24 @@ public:
 	void* Allocate(int32 size);
 	void Free(void* p);
 
+	// Peak number of bytes allocated at once.
 	int32 GetMaxAllocation() const;
 
+	// Size of the stack buffer in bytes.
+	int32 GetCapacity() const;
+
+	// Number of allocations that did not fit and used malloc.
+	int32 GetFallbackCount() const;
+
 private:
 
-	char m_data[b2_stackSize];
+	char* m_data;
+	int32 m_capacity;
 	int32 m_index;
 
 	int32 m_allocation;
 	int32 m_maxAllocation;
+	int32 m_fallbackCount;
 
 	b2StackEntry m_entries[b2_maxStackEntries];
 	int32 m_entryCount;
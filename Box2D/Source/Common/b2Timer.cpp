@@ -0,0 +1,74 @@
+/*
+* Copyright (c) 2006-2007 Erin Catto http://www.gphysics.com
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "b2Timer.h"
+
+#if defined(_WIN32)
+
+#include <windows.h>
+
+static double b2GetTicks()
+{
+	static double s_invFrequency = 0.0;
+	LARGE_INTEGER counter;
+	if (s_invFrequency == 0.0)
+	{
+		LARGE_INTEGER frequency;
+		QueryPerformanceFrequency(&frequency);
+		s_invFrequency = 1000.0 / double(frequency.QuadPart);
+	}
+	QueryPerformanceCounter(&counter);
+	return double(counter.QuadPart) * s_invFrequency;
+}
+
+#elif defined(__linux__) || defined(__APPLE__) || defined(__unix__)
+
+#include <time.h>
+#include <sys/time.h>
+
+static double b2GetTicks()
+{
+#if defined(CLOCK_MONOTONIC)
+	timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec * 1000.0 + t.tv_nsec * 0.000001;
+#else
+	timeval t;
+	gettimeofday(&t, 0);
+	return t.tv_sec * 1000.0 + t.tv_usec * 0.001;
+#endif
+}
+
+#else
+
+static double b2GetTicks()
+{
+	return 0.0;
+}
+
+#endif
+
+void b2Timer::Reset()
+{
+	m_start = b2GetTicks();
+}
+
+float32 b2Timer::GetMilliseconds() const
+{
+	return float32(b2GetTicks() - m_start);
+}
@@ -0,0 +1,42 @@
+/*
+* Copyright (c) 2006-2007 Erin Catto http://www.gphysics.com
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B2_TIMER_H
+#define B2_TIMER_H
+
+#include "b2Settings.h"
+
+/// Timer for profiling. This has platform specific code and may
+/// not work on every platform, in which case it always reads zero.
+class b2Timer
+{
+public:
+	/// Construct the timer. It does not read the clock until it is reset.
+	b2Timer() : m_start(0.0) {}
+
+	/// Reset the timer.
+	void Reset();
+
+	/// Get the time since the last reset.
+	float32 GetMilliseconds() const;
+
+private:
+	double m_start;
+};
+
+#endif
@@ -0,0 +1,242 @@
+/*
+* Copyright (c) 2006-2007 Erin Catto http://www.gphysics.com
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <cstring>
+#include "b2ChainContact.h"
+#include "../b2Body.h"
+#include "../b2WorldCallbacks.h"
+#include "../../Collision/Shapes/b2ChainShape.h"
+#include "../../Common/b2BlockAllocator.h"
+
+#include <new>
+
+b2Contact* b2ChainContact::Create(b2Shape* shape1, b2Shape* shape2, b2BlockAllocator* allocator)
+{
+	void* mem = allocator->Allocate(sizeof(b2ChainContact));
+	return new (mem) b2ChainContact(shape1, shape2);
+}
+
+void b2ChainContact::Destroy(b2Contact* contact, b2BlockAllocator* allocator)
+{
+	((b2ChainContact*)contact)->~b2ChainContact();
+	allocator->Free(contact, sizeof(b2ChainContact));
+}
+
+b2ChainContact::b2ChainContact(b2Shape* s1, b2Shape* s2)
+: b2Contact(s1, s2)
+{
+	b2Assert(m_shape1->GetType() == e_chainShape);
+	m_manifolds = NULL;
+	m_keys = NULL;
+	m_manifolds0 = NULL;
+	m_keys0 = NULL;
+	m_capacity = 0;
+}
+
+b2ChainContact::~b2ChainContact()
+{
+	if (m_capacity > 0)
+	{
+		b2Free(m_manifolds);
+		b2Free(m_keys);
+		b2Free(m_manifolds0);
+		b2Free(m_keys0);
+	}
+}
+
+// Grow the manifold buffers, keeping the previous step's manifolds.
+void b2ChainContact::Reserve(int32 capacity, int32 oldCount)
+{
+	b2Manifold* manifolds0 = (b2Manifold*)b2Alloc(capacity * sizeof(b2Manifold));
+	uint32* keys0 = (uint32*)b2Alloc(capacity * sizeof(uint32));
+
+	if (m_capacity > 0)
+	{
+		memcpy(manifolds0, m_manifolds0, oldCount * sizeof(b2Manifold));
+		memcpy(keys0, m_keys0, oldCount * sizeof(uint32));
+
+		b2Free(m_manifolds);
+		b2Free(m_keys);
+		b2Free(m_manifolds0);
+		b2Free(m_keys0);
+	}
+
+	m_manifolds0 = manifolds0;
+	m_keys0 = keys0;
+	m_manifolds = (b2Manifold*)b2Alloc(capacity * sizeof(b2Manifold));
+	m_keys = (uint32*)b2Alloc(capacity * sizeof(uint32));
+	m_capacity = capacity;
+}
+
+void b2ChainContact::SetManifolds(const b2Manifold* manifolds, const uint32* keys, int32 count)
+{
+	if (count > m_capacity)
+	{
+		Reserve(count, 0);
+	}
+
+	if (count > 0)
+	{
+		memcpy(m_manifolds, manifolds, count * sizeof(b2Manifold));
+		memcpy(m_keys, keys, count * sizeof(uint32));
+	}
+	m_manifoldCount = count;
+}
+
+int32 b2ChainContact::Collide(int32 maxCount)
+{
+	const b2ChainShape* chain = (b2ChainShape*)m_shape1;
+	const b2XForm& xf1 = m_shape1->GetBody()->GetXForm();
+	const b2XForm& xf2 = m_shape2->GetBody()->GetXForm();
+
+	switch (m_shape2->GetType())
+	{
+	case e_polygonShape:
+		return b2CollideChainAndPolygon(m_manifolds, m_keys, maxCount, chain, xf1, (b2PolygonShape*)m_shape2, xf2);
+
+	case e_circleShape:
+		return b2CollideChainAndCircle(m_manifolds, m_keys, maxCount, chain, xf1, (b2CircleShape*)m_shape2, xf2);
+
+	case e_chainShape:
+		return b2CollideChains(m_manifolds, m_keys, maxCount, chain, xf1, (b2ChainShape*)m_shape2, xf2);
+
+	default:
+		b2Assert(false);
+		return 0;
+	}
+}
+
+void b2ChainContact::Evaluate(b2ContactListener* listener)
+{
+	b2Body* b1 = m_shape1->GetBody();
+	b2Body* b2 = m_shape2->GetBody();
+
+	// The current manifolds become the old ones.
+	b2Swap(m_manifolds, m_manifolds0);
+	b2Swap(m_keys, m_keys0);
+	int32 count0 = m_manifoldCount;
+
+	int32 count = Collide(m_capacity);
+	if (count > m_capacity)
+	{
+		Reserve(b2Max(count, 2 * m_capacity), count0);
+		count = Collide(m_capacity);
+	}
+
+	b2ContactPoint cp;
+	cp.shape1 = m_shape1;
+	cp.shape2 = m_shape2;
+	cp.friction = m_friction;
+	cp.restitution = m_restitution;
+
+	// Match manifolds by segment key, then match contact ids within the
+	// manifold to copy the stored impulses for warm starting. Both lists
+	// are produced in the same order, so the search starts after the
+	// last match.
+	int32 hint = 0;
+	for (int32 i = 0; i < count; ++i)
+	{
+		b2Manifold* m = m_manifolds + i;
+
+		b2Manifold* m0 = NULL;
+		for (int32 k = 0; k < count0; ++k)
+		{
+			int32 index = hint + k < count0 ? hint + k : hint + k - count0;
+			if (m_keys0[index] == m_keys[i])
+			{
+				m0 = m_manifolds0 + index;
+				hint = index + 1;
+				break;
+			}
+		}
+
+		for (int32 j = 0; j < m->pointCount; ++j)
+		{
+			b2ManifoldPoint* mp = m->points + j;
+			mp->normalImpulse = 0.0f;
+			mp->tangentImpulse = 0.0f;
+			bool found = false;
+			b2ContactID id = mp->id;
+
+			for (int32 k = 0; m0 != NULL && k < m0->pointCount; ++k)
+			{
+				b2ManifoldPoint* mp0 = m0->points + k;
+				if (mp0->id.key == id.key)
+				{
+					mp->normalImpulse = mp0->normalImpulse;
+					mp->tangentImpulse = mp0->tangentImpulse;
+
+					// Mark the old point as persisted. A real id never
+					// has a flip of b2_nullFeature.
+					mp0->id.features.flip = b2_nullFeature;
+					found = true;
+					break;
+				}
+			}
+
+			if (listener != NULL)
+			{
+				cp.position = b1->GetWorldPoint(mp->localPoint1);
+				b2Vec2 v1 = b1->GetLinearVelocityFromLocalPoint(mp->localPoint1);
+				b2Vec2 v2 = b2->GetLinearVelocityFromLocalPoint(mp->localPoint2);
+				cp.velocity = v2 - v1;
+				cp.normal = m->normal;
+				cp.separation = mp->separation;
+				cp.id = id;
+				if (found)
+				{
+					listener->Persist(&cp);
+				}
+				else
+				{
+					listener->Add(&cp);
+				}
+			}
+		}
+	}
+
+	m_manifoldCount = count;
+
+	if (listener == NULL)
+	{
+		return;
+	}
+
+	// Report removed points.
+	for (int32 i = 0; i < count0; ++i)
+	{
+		b2Manifold* m0 = m_manifolds0 + i;
+		for (int32 j = 0; j < m0->pointCount; ++j)
+		{
+			b2ManifoldPoint* mp0 = m0->points + j;
+			if (mp0->id.features.flip == b2_nullFeature)
+			{
+				continue;
+			}
+
+			cp.position = b1->GetWorldPoint(mp0->localPoint1);
+			b2Vec2 v1 = b1->GetLinearVelocityFromLocalPoint(mp0->localPoint1);
+			b2Vec2 v2 = b2->GetLinearVelocityFromLocalPoint(mp0->localPoint2);
+			cp.velocity = v2 - v1;
+			cp.normal = m0->normal;
+			cp.separation = mp0->separation;
+			cp.id = mp0->id;
+			listener->Remove(&cp);
+		}
+	}
+}
@@ -0,0 +1,66 @@
+/*
+* Copyright (c) 2006-2007 Erin Catto http://www.gphysics.com
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef CHAIN_CONTACT_H
+#define CHAIN_CONTACT_H
+
+#include "b2Contact.h"
+
+class b2BlockAllocator;
+
+/// Contact between a chain (shape1) and a polygon, circle or chain.
+/// There is one manifold per touching segment, so the manifold arrays
+/// grow on demand. The previous step's manifolds are kept to match
+/// contact points for warm starting.
+class b2ChainContact : public b2Contact
+{
+public:
+	static b2Contact* Create(b2Shape* shape1, b2Shape* shape2, b2BlockAllocator* allocator);
+	static void Destroy(b2Contact* contact, b2BlockAllocator* allocator);
+
+	b2ChainContact(b2Shape* shape1, b2Shape* shape2);
+	~b2ChainContact();
+
+	void Evaluate(b2ContactListener* listener);
+	b2Manifold* GetManifolds()
+	{
+		return m_manifolds;
+	}
+
+	const uint32* GetManifoldKeys()
+	{
+		return m_keys;
+	}
+
+	void SetManifolds(const b2Manifold* manifolds, const uint32* keys, int32 count);
+
+private:
+	int32 Collide(int32 maxCount);
+	void Reserve(int32 capacity, int32 oldCount);
+
+	b2Manifold* m_manifolds;
+	uint32* m_keys;
+
+	// The manifolds of the previous step.
+	b2Manifold* m_manifolds0;
+	uint32* m_keys0;
+
+	int32 m_capacity;
+};
+
+#endif
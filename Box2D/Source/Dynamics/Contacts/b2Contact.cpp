@@ -20,6 +20,7 @@
 #include "b2CircleContact.h"
 #include "b2PolyAndCircleContact.h"
 #include "b2PolyContact.h"
+#include "b2ChainContact.h"
 #include "b2ContactSolver.h"
 #include "../../Collision/b2Collision.h"
 #include "../../Collision/Shapes/b2Shape.h"
@@ -32,9 +33,18 @@ bool b2Contact::s_initialized = false;
 
 void b2Contact::InitializeRegisters()
 {
+	if (s_initialized)
+	{
+		return;
+	}
+
 	AddType(b2CircleContact::Create, b2CircleContact::Destroy, e_circleShape, e_circleShape);
 	AddType(b2PolyAndCircleContact::Create, b2PolyAndCircleContact::Destroy, e_polygonShape, e_circleShape);
 	AddType(b2PolygonContact::Create, b2PolygonContact::Destroy, e_polygonShape, e_polygonShape);
+	AddType(b2ChainContact::Create, b2ChainContact::Destroy, e_chainShape, e_circleShape);
+	AddType(b2ChainContact::Create, b2ChainContact::Destroy, e_chainShape, e_polygonShape);
+	AddType(b2ChainContact::Create, b2ChainContact::Destroy, e_chainShape, e_chainShape);
+	s_initialized = true;
 }
 
 void b2Contact::AddType(b2ContactCreateFcn* createFcn, b2ContactDestroyFcn* destoryFcn,
@@ -57,11 +67,7 @@ void b2Contact::AddType(b2ContactCreateFcn* createFcn, b2ContactDestroyFcn* dest
 
 b2Contact* b2Contact::Create(b2Shape* shape1, b2Shape* shape2, b2BlockAllocator* allocator)
 {
-	if (s_initialized == false)
-	{
-		InitializeRegisters();
-		s_initialized = true;
-	}
+	b2Assert(s_initialized == true);
 
 	b2ShapeType type1 = shape1->GetType();
 	b2ShapeType type2 = shape2->GetType();
@@ -131,6 +137,12 @@ b2Contact::b2Contact(b2Shape* s1, b2Shape* s2)
 	m_restitution = b2MixRestitution(m_shape1->GetRestitution(), m_shape2->GetRestitution());
 	m_prev = NULL;
 	m_next = NULL;
+	m_awakePrev = NULL;
+	m_awakeNext = NULL;
+
+	m_island = NULL;
+	m_islandPrev = NULL;
+	m_islandNext = NULL;
 
 	m_node1.contact = NULL;
 	m_node1.prev = NULL;
@@ -143,6 +155,22 @@ b2Contact::b2Contact(b2Shape* s1, b2Shape* s2)
 	m_node2.other = NULL;
 }
 
+void b2Contact::SetManifolds(const b2Manifold* manifolds, const uint32*, int32 count)
+{
+	b2Assert(count <= 1);
+
+	b2Manifold* manifold = GetManifolds();
+	if (count > 0)
+	{
+		*manifold = manifolds[0];
+	}
+	else
+	{
+		manifold->pointCount = 0;
+	}
+	m_manifoldCount = count;
+}
+
 void b2Contact::Update(b2ContactListener* listener)
 {
 	int32 oldCount = GetManifoldCount();
@@ -160,6 +188,17 @@ void b2Contact::Update(b2ContactListener* listener)
 		body2->WakeUp();
 	}
 
+	// Touching contacts connect their bodies' islands.
+	b2IslandManager* islandManager = &body1->GetWorld()->m_islandManager;
+	if (newCount > 0 && m_island == NULL && IsSolid())
+	{
+		islandManager->LinkContact(this);
+	}
+	else if (newCount == 0 && m_island != NULL)
+	{
+		islandManager->UnlinkContact(this);
+	}
+
 	// Slow contacts don't generate TOI events.
 	if (body1->IsStatic() || body1->IsBullet() || body2->IsStatic() || body2->IsBullet())
 	{
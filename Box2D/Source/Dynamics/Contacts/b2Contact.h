@@ -29,6 +29,7 @@ class b2World;
 class b2BlockAllocator;
 class b2StackAllocator;
 class b2ContactListener;
+struct b2PersistentIsland;
 
 typedef b2Contact* b2ContactCreateFcn(b2Shape* shape1, b2Shape* shape2, b2BlockAllocator* allocator);
 typedef void b2ContactDestroyFcn(b2Contact* contact, b2BlockAllocator* allocator);
@@ -117,10 +118,14 @@ public:
 		e_slowFlag		= 0x0002,
 		e_islandFlag	= 0x0004,
 		e_toiFlag		= 0x0008,
+		e_awakeFlag		= 0x0010,	// in the world's awake contact list
+		e_refreshFlag	= 0x0020,	// evaluate once more even if both bodies sleep
 	};
 
 	static void AddType(b2ContactCreateFcn* createFcn, b2ContactDestroyFcn* destroyFcn,
 						b2ShapeType type1, b2ShapeType type2);
+	/// Fill in the contact registers. Every world does this when it is
+	/// created; call it before creating worlds on several threads at once.
 	static void InitializeRegisters();
 	static b2Contact* Create(b2Shape* shape1, b2Shape* shape2, b2BlockAllocator* allocator);
 	static void Destroy(b2Contact* contact, b2BlockAllocator* allocator);
@@ -131,6 +136,14 @@ public:
 
 	void Update(b2ContactListener* listener);
 	virtual void Evaluate(b2ContactListener* listener) = 0;
+
+	// The keys that match manifolds between steps, or NULL if there is at
+	// most one manifold.
+	virtual const uint32* GetManifoldKeys() { return NULL; }
+
+	// Replace the manifolds, see b2WorldState.
+	virtual void SetManifolds(const b2Manifold* manifolds, const uint32* keys, int32 count);
+
 	static b2ContactRegister s_registers[e_shapeTypeCount][e_shapeTypeCount];
 	static bool s_initialized;
 
@@ -141,6 +154,15 @@ public:
 	b2Contact* m_prev;
 	b2Contact* m_next;
 
+	// Awake contact list pointers. Only valid with e_awakeFlag.
+	b2Contact* m_awakePrev;
+	b2Contact* m_awakeNext;
+
+	// The persistent island while the contact is touching and solid.
+	b2PersistentIsland* m_island;
+	b2Contact* m_islandPrev;
+	b2Contact* m_islandNext;
+
 	// Nodes for connecting bodies.
 	b2ContactEdge m_node1;
 	b2ContactEdge m_node2;
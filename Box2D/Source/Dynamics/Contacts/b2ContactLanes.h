@@ -0,0 +1,347 @@
+/*
+* Copyright (c) 2006-2007 Erin Catto http://www.gphysics.com
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B2_CONTACT_LANES_H
+#define B2_CONTACT_LANES_H
+
+#include "../../Common/b2Settings.h"
+
+// Per batch constraint fields. Each field holds one value per lane, so a
+// batch is loaded with aligned vector loads.
+enum b2LaneField
+{
+	e_laneNormalX,
+	e_laneNormalY,
+	e_laneFriction,
+	e_lanePoints,
+};
+
+// Per manifold point fields, following e_lanePoints. Unused points have
+// zero masses and so never apply an impulse.
+enum b2LanePointField
+{
+	e_pointR1X,
+	e_pointR1Y,
+	e_pointR2X,
+	e_pointR2Y,
+	e_pointNormalMass,
+	e_pointTangentMass,
+	e_pointVelocityBias,
+	e_pointNormalImpulse,
+	e_pointTangentImpulse,
+	e_pointAnchor1X,		// anchors are relative to the body centers
+	e_pointAnchor1Y,
+	e_pointAnchor2X,
+	e_pointAnchor2Y,
+	e_pointSeparation,
+	e_pointEqualizedMass,
+	e_pointPositionImpulse,
+	e_pointActive,			// 1 for a real point, 0 for padding
+	e_pointFieldCount,
+};
+
+const int32 b2_laneFieldCount = e_lanePoints + b2_maxManifoldPoints * e_pointFieldCount;
+
+// Body state, one array per field. Lanes refer to bodies by slot index.
+enum b2SlotField
+{
+	e_slotVX,
+	e_slotVY,
+	e_slotW,
+	e_slotInvMass,
+	e_slotInvI,
+	e_slotCX,
+	e_slotCY,
+	e_slotA,
+	e_slotCos,
+	e_slotSin,
+	e_slotPositionInvMass,	// m_mass * m_invMass
+	e_slotPositionInvI,		// m_mass * m_invI
+	e_slotFieldCount,
+};
+
+/// Contact constraints packed into structure-of-arrays batches. Within a
+/// batch no dynamic body appears twice, so every lane can update its
+/// bodies at once. Static bodies are only read; each reference to one gets
+/// its own slot.
+struct b2ContactLanes
+{
+	int32 width;			// lanes per batch
+	int32 batchCount;
+	float32* data;			// batchCount * b2_laneFieldCount * width
+	int32* indices1;		// body slot of each lane
+	int32* indices2;
+	int32* constraints;		// constraint of each lane, -1 for padding
+	int32 slotStride;
+	float32* slots;			// e_slotFieldCount * slotStride
+};
+
+#ifdef B2_SIMD_CONTACTS
+
+void b2SolveVelocityLanesSSE2(const b2ContactLanes* lanes);
+float32 b2SolvePositionLanesSSE2(const b2ContactLanes* lanes, float32 baumgarte);
+
+void b2SolveVelocityLanesAVX2(const b2ContactLanes* lanes);
+float32 b2SolvePositionLanesAVX2(const b2ContactLanes* lanes, float32 baumgarte);
+
+// The solvers are written once against a small vector type V providing
+// width, Set, Load, Store, Gather, Scatter, Min, Max, MinLane and the
+// arithmetic operators. Each back end instantiates them with its own type.
+
+template <typename V>
+void b2SolveVelocityLanes(const b2ContactLanes* lanes)
+{
+	const int32 width = V::width;
+	float32* vx = lanes->slots + e_slotVX * lanes->slotStride;
+	float32* vy = lanes->slots + e_slotVY * lanes->slotStride;
+	float32* w = lanes->slots + e_slotW * lanes->slotStride;
+	const float32* invMass = lanes->slots + e_slotInvMass * lanes->slotStride;
+	const float32* invI = lanes->slots + e_slotInvI * lanes->slotStride;
+	const V zero = V::Set(0.0f);
+
+	for (int32 i = 0; i < lanes->batchCount; ++i)
+	{
+		float32* d = lanes->data + i * b2_laneFieldCount * width;
+		const int32* index1 = lanes->indices1 + i * width;
+		const int32* index2 = lanes->indices2 + i * width;
+
+		V v1x = V::Gather(vx, index1);
+		V v1y = V::Gather(vy, index1);
+		V w1 = V::Gather(w, index1);
+		V v2x = V::Gather(vx, index2);
+		V v2y = V::Gather(vy, index2);
+		V w2 = V::Gather(w, index2);
+		V invMass1 = V::Gather(invMass, index1);
+		V invI1 = V::Gather(invI, index1);
+		V invMass2 = V::Gather(invMass, index2);
+		V invI2 = V::Gather(invI, index2);
+
+		V nx = V::Load(d + e_laneNormalX * width);
+		V ny = V::Load(d + e_laneNormalY * width);
+		V tx = ny;
+		V ty = zero - nx;
+		V friction = V::Load(d + e_laneFriction * width);
+
+		// Solve normal constraints
+		for (int32 j = 0; j < b2_maxManifoldPoints; ++j)
+		{
+			float32* p = d + (e_lanePoints + j * e_pointFieldCount) * width;
+			V r1x = V::Load(p + e_pointR1X * width);
+			V r1y = V::Load(p + e_pointR1Y * width);
+			V r2x = V::Load(p + e_pointR2X * width);
+			V r2y = V::Load(p + e_pointR2Y * width);
+
+			// Relative velocity at contact
+			V dvx = v2x - w2 * r2y - v1x + w1 * r1y;
+			V dvy = v2y + w2 * r2x - v1y - w1 * r1x;
+
+			// Compute normal impulse
+			V vn = dvx * nx + dvy * ny;
+			V lambda = (zero - V::Load(p + e_pointNormalMass * width)) * (vn - V::Load(p + e_pointVelocityBias * width));
+
+			// Clamp the accumulated impulse
+			V impulse = V::Load(p + e_pointNormalImpulse * width);
+			V newImpulse = V::Max(impulse + lambda, zero);
+			lambda = newImpulse - impulse;
+
+			// Apply contact impulse
+			V px = lambda * nx;
+			V py = lambda * ny;
+
+			v1x = v1x - invMass1 * px;
+			v1y = v1y - invMass1 * py;
+			w1 = w1 - invI1 * (r1x * py - r1y * px);
+
+			v2x = v2x + invMass2 * px;
+			v2y = v2y + invMass2 * py;
+			w2 = w2 + invI2 * (r2x * py - r2y * px);
+
+			V::Store(p + e_pointNormalImpulse * width, newImpulse);
+		}
+
+		// Solve tangent constraints
+		for (int32 j = 0; j < b2_maxManifoldPoints; ++j)
+		{
+			float32* p = d + (e_lanePoints + j * e_pointFieldCount) * width;
+			V r1x = V::Load(p + e_pointR1X * width);
+			V r1y = V::Load(p + e_pointR1Y * width);
+			V r2x = V::Load(p + e_pointR2X * width);
+			V r2y = V::Load(p + e_pointR2Y * width);
+
+			// Relative velocity at contact
+			V dvx = v2x - w2 * r2y - v1x + w1 * r1y;
+			V dvy = v2y + w2 * r2x - v1y - w1 * r1x;
+
+			// Compute tangent force
+			V vt = dvx * tx + dvy * ty;
+			V lambda = V::Load(p + e_pointTangentMass * width) * (zero - vt);
+
+			// Clamp the accumulated force
+			V maxFriction = friction * V::Load(p + e_pointNormalImpulse * width);
+			V impulse = V::Load(p + e_pointTangentImpulse * width);
+			V newImpulse = V::Max(zero - maxFriction, V::Min(impulse + lambda, maxFriction));
+			lambda = newImpulse - impulse;
+
+			// Apply contact impulse
+			V px = lambda * tx;
+			V py = lambda * ty;
+
+			v1x = v1x - invMass1 * px;
+			v1y = v1y - invMass1 * py;
+			w1 = w1 - invI1 * (r1x * py - r1y * px);
+
+			v2x = v2x + invMass2 * px;
+			v2y = v2y + invMass2 * py;
+			w2 = w2 + invI2 * (r2x * py - r2y * px);
+
+			V::Store(p + e_pointTangentImpulse * width, newImpulse);
+		}
+
+		V::Scatter(vx, index1, v1x);
+		V::Scatter(vy, index1, v1y);
+		V::Scatter(w, index1, w1);
+		V::Scatter(vx, index2, v2x);
+		V::Scatter(vy, index2, v2y);
+		V::Scatter(w, index2, w2);
+	}
+}
+
+// Rotate the cosine/sine pair by a small angle. The position solver only
+// moves bodies by a few degrees per point, so a short Taylor series is
+// enough; the exact transform is rebuilt from the angle afterwards.
+template <typename V>
+inline void b2RotateLanes(V& c, V& s, const V& angle)
+{
+	V a2 = angle * angle;
+	V sa = angle * (V::Set(1.0f) - a2 * V::Set(1.0f / 6.0f));
+	V ca = V::Set(1.0f) - a2 * (V::Set(0.5f) - a2 * V::Set(1.0f / 24.0f));
+	V c0 = c;
+	c = c0 * ca - s * sa;
+	s = s * ca + c0 * sa;
+}
+
+template <typename V>
+float32 b2SolvePositionLanes(const b2ContactLanes* lanes, float32 baumgarte)
+{
+	const int32 width = V::width;
+	float32* cx = lanes->slots + e_slotCX * lanes->slotStride;
+	float32* cy = lanes->slots + e_slotCY * lanes->slotStride;
+	float32* a = lanes->slots + e_slotA * lanes->slotStride;
+	float32* cosA = lanes->slots + e_slotCos * lanes->slotStride;
+	float32* sinA = lanes->slots + e_slotSin * lanes->slotStride;
+	const float32* invMass = lanes->slots + e_slotPositionInvMass * lanes->slotStride;
+	const float32* invI = lanes->slots + e_slotPositionInvI * lanes->slotStride;
+	const V zero = V::Set(0.0f);
+	const V beta = V::Set(baumgarte);
+	const V slop = V::Set(b2_linearSlop);
+	const V maxCorrection = V::Set(-b2_maxLinearCorrection);
+
+	V minSeparation = zero;
+
+	for (int32 i = 0; i < lanes->batchCount; ++i)
+	{
+		float32* d = lanes->data + i * b2_laneFieldCount * width;
+		const int32* index1 = lanes->indices1 + i * width;
+		const int32* index2 = lanes->indices2 + i * width;
+
+		V c1x = V::Gather(cx, index1);
+		V c1y = V::Gather(cy, index1);
+		V a1 = V::Gather(a, index1);
+		V cos1 = V::Gather(cosA, index1);
+		V sin1 = V::Gather(sinA, index1);
+		V c2x = V::Gather(cx, index2);
+		V c2y = V::Gather(cy, index2);
+		V a2 = V::Gather(a, index2);
+		V cos2 = V::Gather(cosA, index2);
+		V sin2 = V::Gather(sinA, index2);
+		V invMass1 = V::Gather(invMass, index1);
+		V invI1 = V::Gather(invI, index1);
+		V invMass2 = V::Gather(invMass, index2);
+		V invI2 = V::Gather(invI, index2);
+
+		V nx = V::Load(d + e_laneNormalX * width);
+		V ny = V::Load(d + e_laneNormalY * width);
+
+		// Solver normal constraints
+		for (int32 j = 0; j < b2_maxManifoldPoints; ++j)
+		{
+			float32* p = d + (e_lanePoints + j * e_pointFieldCount) * width;
+			V l1x = V::Load(p + e_pointAnchor1X * width);
+			V l1y = V::Load(p + e_pointAnchor1Y * width);
+			V l2x = V::Load(p + e_pointAnchor2X * width);
+			V l2y = V::Load(p + e_pointAnchor2Y * width);
+
+			V r1x = cos1 * l1x - sin1 * l1y;
+			V r1y = sin1 * l1x + cos1 * l1y;
+			V r2x = cos2 * l2x - sin2 * l2y;
+			V r2y = sin2 * l2x + cos2 * l2y;
+
+			// Approximate the current separation.
+			V dpx = c2x + r2x - c1x - r1x;
+			V dpy = c2y + r2y - c1y - r1y;
+			V separation = dpx * nx + dpy * ny + V::Load(p + e_pointSeparation * width);
+
+			// Track max constraint error, ignoring padding.
+			minSeparation = V::Min(minSeparation, separation * V::Load(p + e_pointActive * width));
+
+			// Prevent large corrections and allow slop.
+			V C = beta * V::Max(maxCorrection, V::Min(separation + slop, zero));
+
+			// Compute normal impulse
+			V dImpulse = (zero - V::Load(p + e_pointEqualizedMass * width)) * C;
+
+			// Clamp the accumulated impulse
+			V impulse0 = V::Load(p + e_pointPositionImpulse * width);
+			V impulse = V::Max(impulse0 + dImpulse, zero);
+			dImpulse = impulse - impulse0;
+			V::Store(p + e_pointPositionImpulse * width, impulse);
+
+			V px = dImpulse * nx;
+			V py = dImpulse * ny;
+
+			V da1 = zero - invI1 * (r1x * py - r1y * px);
+			c1x = c1x - invMass1 * px;
+			c1y = c1y - invMass1 * py;
+			a1 = a1 + da1;
+			b2RotateLanes(cos1, sin1, da1);
+
+			V da2 = invI2 * (r2x * py - r2y * px);
+			c2x = c2x + invMass2 * px;
+			c2y = c2y + invMass2 * py;
+			a2 = a2 + da2;
+			b2RotateLanes(cos2, sin2, da2);
+		}
+
+		V::Scatter(cx, index1, c1x);
+		V::Scatter(cy, index1, c1y);
+		V::Scatter(a, index1, a1);
+		V::Scatter(cosA, index1, cos1);
+		V::Scatter(sinA, index1, sin1);
+		V::Scatter(cx, index2, c2x);
+		V::Scatter(cy, index2, c2y);
+		V::Scatter(a, index2, a2);
+		V::Scatter(cosA, index2, cos2);
+		V::Scatter(sinA, index2, sin2);
+	}
+
+	return V::MinLane(minSeparation);
+}
+
+#endif
+
+#endif
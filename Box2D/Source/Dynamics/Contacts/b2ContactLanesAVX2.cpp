@@ -0,0 +1,90 @@
+/*
+* Copyright (c) 2006-2007 Erin Catto http://www.gphysics.com
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+// Keep the target switch ahead of the solver templates but after the
+// shared headers, so only the code in this file uses AVX2.
+#include "../../Common/b2Settings.h"
+
+#ifdef B2_SIMD_CONTACTS
+
+#pragma GCC target("avx2")
+
+#include "b2ContactLanes.h"
+#include <immintrin.h>
+
+namespace
+{
+
+struct b2Float8
+{
+	enum { width = 8 };
+
+	b2Float8() {}
+	b2Float8(__m256 x) : v(x) {}
+
+	static b2Float8 Set(float32 x) { return _mm256_set1_ps(x); }
+	static b2Float8 Load(const float32* p) { return _mm256_load_ps(p); }
+	static void Store(float32* p, const b2Float8& x) { _mm256_store_ps(p, x.v); }
+
+	static b2Float8 Gather(const float32* base, const int32* index)
+	{
+		return _mm256_i32gather_ps(base, _mm256_load_si256((const __m256i*)index), 4);
+	}
+
+	// There is no scatter before AVX-512.
+	static void Scatter(float32* base, const int32* index, const b2Float8& x)
+	{
+		float32 t[8] __attribute__((aligned(32)));
+		_mm256_store_ps(t, x.v);
+		for (int32 i = 0; i < 8; ++i)
+		{
+			base[index[i]] = t[i];
+		}
+	}
+
+	static b2Float8 Min(const b2Float8& a, const b2Float8& b) { return _mm256_min_ps(a.v, b.v); }
+	static b2Float8 Max(const b2Float8& a, const b2Float8& b) { return _mm256_max_ps(a.v, b.v); }
+
+	static float32 MinLane(const b2Float8& x)
+	{
+		__m128 m = _mm_min_ps(_mm256_castps256_ps128(x.v), _mm256_extractf128_ps(x.v, 1));
+		m = _mm_min_ps(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(1, 0, 3, 2)));
+		m = _mm_min_ps(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(2, 3, 0, 1)));
+		return _mm_cvtss_f32(m);
+	}
+
+	__m256 v;
+};
+
+inline b2Float8 operator + (const b2Float8& a, const b2Float8& b) { return _mm256_add_ps(a.v, b.v); }
+inline b2Float8 operator - (const b2Float8& a, const b2Float8& b) { return _mm256_sub_ps(a.v, b.v); }
+inline b2Float8 operator * (const b2Float8& a, const b2Float8& b) { return _mm256_mul_ps(a.v, b.v); }
+
+}
+
+void b2SolveVelocityLanesAVX2(const b2ContactLanes* lanes)
+{
+	b2SolveVelocityLanes<b2Float8>(lanes);
+}
+
+float32 b2SolvePositionLanesAVX2(const b2ContactLanes* lanes, float32 baumgarte)
+{
+	return b2SolvePositionLanes<b2Float8>(lanes, baumgarte);
+}
+
+#endif
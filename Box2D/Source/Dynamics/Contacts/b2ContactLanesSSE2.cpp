@@ -0,0 +1,89 @@
+/*
+* Copyright (c) 2006-2007 Erin Catto http://www.gphysics.com
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+// Keep the target switch ahead of the solver templates but after the
+// shared headers, so only the code in this file uses SSE2.
+#include "../../Common/b2Settings.h"
+
+#ifdef B2_SIMD_CONTACTS
+
+#pragma GCC target("sse2")
+
+#include "b2ContactLanes.h"
+#include <emmintrin.h>
+
+namespace
+{
+
+struct b2Float4
+{
+	enum { width = 4 };
+
+	b2Float4() {}
+	b2Float4(__m128 x) : v(x) {}
+
+	static b2Float4 Set(float32 x) { return _mm_set1_ps(x); }
+	static b2Float4 Load(const float32* p) { return _mm_load_ps(p); }
+	static void Store(float32* p, const b2Float4& x) { _mm_store_ps(p, x.v); }
+
+	// SSE2 has no gather or scatter, so go through memory.
+	static b2Float4 Gather(const float32* base, const int32* index)
+	{
+		return _mm_setr_ps(base[index[0]], base[index[1]], base[index[2]], base[index[3]]);
+	}
+
+	static void Scatter(float32* base, const int32* index, const b2Float4& x)
+	{
+		float32 t[4] __attribute__((aligned(16)));
+		_mm_store_ps(t, x.v);
+		base[index[0]] = t[0];
+		base[index[1]] = t[1];
+		base[index[2]] = t[2];
+		base[index[3]] = t[3];
+	}
+
+	static b2Float4 Min(const b2Float4& a, const b2Float4& b) { return _mm_min_ps(a.v, b.v); }
+	static b2Float4 Max(const b2Float4& a, const b2Float4& b) { return _mm_max_ps(a.v, b.v); }
+
+	static float32 MinLane(const b2Float4& x)
+	{
+		__m128 m = _mm_min_ps(x.v, _mm_shuffle_ps(x.v, x.v, _MM_SHUFFLE(1, 0, 3, 2)));
+		m = _mm_min_ps(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(2, 3, 0, 1)));
+		return _mm_cvtss_f32(m);
+	}
+
+	__m128 v;
+};
+
+inline b2Float4 operator + (const b2Float4& a, const b2Float4& b) { return _mm_add_ps(a.v, b.v); }
+inline b2Float4 operator - (const b2Float4& a, const b2Float4& b) { return _mm_sub_ps(a.v, b.v); }
+inline b2Float4 operator * (const b2Float4& a, const b2Float4& b) { return _mm_mul_ps(a.v, b.v); }
+
+}
+
+void b2SolveVelocityLanesSSE2(const b2ContactLanes* lanes)
+{
+	b2SolveVelocityLanes<b2Float4>(lanes);
+}
+
+float32 b2SolvePositionLanesSSE2(const b2ContactLanes* lanes, float32 baumgarte)
+{
+	return b2SolvePositionLanes<b2Float4>(lanes, baumgarte);
+}
+
+#endif
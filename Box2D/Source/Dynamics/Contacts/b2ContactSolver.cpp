@@ -22,10 +22,26 @@
 #include "../b2World.h"
 #include "../../Common/b2StackAllocator.h"
 
-b2ContactSolver::b2ContactSolver(const b2TimeStep& step, b2Contact** contacts, int32 contactCount, b2StackAllocator* allocator)
+#include <cstring>
+
+// Colours are tracked with one bit per colour in a uint32 per body.
+const int32 b2_laneColorCount = 32;
+
+// Islands with fewer constraints than this many batches use the scalar
+// solver; small islands mostly fill their batches with padding.
+const int32 b2_laneMinBatches = 4;
+
+b2ContactSolver::b2ContactSolver(const b2TimeStep& step, b2Body** bodies, int32 bodyCount,
+								 b2Contact** contacts, int32 contactCount, b2StackAllocator* allocator)
 {
 	m_step = step;
 	m_allocator = allocator;
+	m_bodies = bodies;
+	m_bodyCount = bodyCount;
+	m_lanes.width = 1;
+	m_lanes.batchCount = 0;
+	m_overflowCount = 0;
+	m_laneMemory = NULL;
 
 	m_constraintCount = 0;
 	for (int32 i = 0; i < contactCount; ++i)
@@ -70,6 +86,7 @@ b2ContactSolver::b2ContactSolver(const b2TimeStep& step, b2Contact** contacts, i
 			c->pointCount = manifold->pointCount;
 			c->friction = friction;
 			c->restitution = restitution;
+			c->color = -1;
 
 			for (int32 k = 0; k < c->pointCount; ++k)
 			{
@@ -132,13 +149,248 @@ b2ContactSolver::b2ContactSolver(const b2TimeStep& step, b2Contact** contacts, i
 	}
 
 	b2Assert(count == m_constraintCount);
+
+	// Lanes only pay off once there are a few full batches.
+	if (m_step.contactSolver != e_scalarContactSolver)
+	{
+		m_lanes.width = m_step.contactSolver == e_avx2ContactSolver ? 8 : 4;
+		if (m_constraintCount >= b2_laneMinBatches * m_lanes.width)
+		{
+			InitLanes();
+		}
+	}
 }
 
 b2ContactSolver::~b2ContactSolver()
 {
+	if (m_laneMemory)
+	{
+		m_allocator->Free(m_laneMemory);
+	}
 	m_allocator->Free(m_constraints);
 }
 
+b2ContactSolverType b2ContactSolver::GetSupportedType(b2ContactSolverType type)
+{
+#ifdef B2_SIMD_CONTACTS
+	if (type == e_simdContactSolver)
+	{
+		type = e_avx2ContactSolver;
+	}
+	if (type == e_avx2ContactSolver && __builtin_cpu_supports("avx2") == 0)
+	{
+		type = e_sse2ContactSolver;
+	}
+	if (type == e_sse2ContactSolver && __builtin_cpu_supports("sse2") == 0)
+	{
+		type = e_scalarContactSolver;
+	}
+	return type;
+#else
+	return e_scalarContactSolver;
+#endif
+}
+
+// Pack the constraints into lanes. The constraints are greedily coloured
+// so that a dynamic body is used at most once per colour, then each colour
+// is cut into batches of lane width. Static bodies are never written, so
+// they do not take part in the colouring.
+void b2ContactSolver::InitLanes()
+{
+	const int32 width = m_lanes.width;
+
+	uint32* bodyColors = (uint32*)m_allocator->Allocate(m_bodyCount * sizeof(uint32));
+	memset(bodyColors, 0, m_bodyCount * sizeof(uint32));
+
+	int32 colorCounts[b2_laneColorCount];
+	memset(colorCounts, 0, sizeof(colorCounts));
+
+	int32 staticCount = 0;
+	for (int32 i = 0; i < m_constraintCount; ++i)
+	{
+		b2ContactConstraint* c = m_constraints + i;
+		uint32 used = 0;
+		if (c->body1->IsStatic())
+		{
+			++staticCount;
+		}
+		else
+		{
+			used |= bodyColors[c->body1->m_islandIndex];
+		}
+		if (c->body2->IsStatic())
+		{
+			++staticCount;
+		}
+		else
+		{
+			used |= bodyColors[c->body2->m_islandIndex];
+		}
+
+		if (used == 0xffffffff)
+		{
+			++m_overflowCount;
+			continue;
+		}
+
+		int32 color = 0;
+		while (used & (1 << color))
+		{
+			++color;
+		}
+
+		uint32 bit = 1 << color;
+		if (c->body1->IsStatic() == false)
+		{
+			bodyColors[c->body1->m_islandIndex] |= bit;
+		}
+		if (c->body2->IsStatic() == false)
+		{
+			bodyColors[c->body2->m_islandIndex] |= bit;
+		}
+
+		c->color = color;
+		++colorCounts[color];
+	}
+
+	m_allocator->Free(bodyColors);
+
+	// First lane of each colour. Every colour starts a new batch.
+	int32 colorLanes[b2_laneColorCount];
+	int32 laneCount = 0;
+	for (int32 i = 0; i < b2_laneColorCount; ++i)
+	{
+		colorLanes[i] = laneCount;
+		laneCount += (colorCounts[i] + width - 1) / width * width;
+	}
+
+	// Island bodies keep their index, then one slot for padding, then one
+	// per static body reference.
+	int32 slotStride = m_bodyCount + 1 + staticCount;
+
+	int32 dataSize = laneCount * b2_laneFieldCount * sizeof(float32);
+	int32 indexSize = laneCount * sizeof(int32);
+	int32 slotSize = e_slotFieldCount * slotStride * sizeof(float32);
+	int32 overflowSize = m_overflowCount * sizeof(int32);
+
+	const int32 alignment = 32;
+	m_laneMemory = m_allocator->Allocate(dataSize + 3 * indexSize + slotSize + overflowSize + alignment);
+	char* memory = (char*)m_laneMemory;
+	memory += (alignment - (int32)((size_t)memory & (alignment - 1))) & (alignment - 1);
+
+	m_lanes.width = width;
+	m_lanes.batchCount = laneCount / width;
+	m_lanes.data = (float32*)memory;
+	m_lanes.indices1 = (int32*)(memory + dataSize);
+	m_lanes.indices2 = (int32*)(memory + dataSize + indexSize);
+	m_lanes.constraints = (int32*)(memory + dataSize + 2 * indexSize);
+	m_lanes.slotStride = slotStride;
+	m_lanes.slots = (float32*)(memory + dataSize + 3 * indexSize);
+	m_overflow = (int32*)(memory + dataSize + 3 * indexSize + slotSize);
+
+	// Padding lanes have zero masses and use the padding slot.
+	const int32 padSlot = m_bodyCount;
+	memset(m_lanes.data, 0, dataSize);
+	memset(m_lanes.slots, 0, slotSize);
+	m_lanes.slots[e_slotCos * slotStride + padSlot] = 1.0f;
+	for (int32 i = 0; i < laneCount; ++i)
+	{
+		m_lanes.indices1[i] = padSlot;
+		m_lanes.indices2[i] = padSlot;
+		m_lanes.constraints[i] = -1;
+	}
+
+	// Masses of the island bodies. Velocities and positions are loaded on
+	// each solve because the joints change them in between.
+	float32* slots = m_lanes.slots;
+	for (int32 i = 0; i < m_bodyCount; ++i)
+	{
+		b2Body* b = m_bodies[i];
+		slots[e_slotInvMass * slotStride + i] = b->m_invMass;
+		slots[e_slotInvI * slotStride + i] = b->m_invI;
+		slots[e_slotPositionInvMass * slotStride + i] = b->m_mass * b->m_invMass;
+		slots[e_slotPositionInvI * slotStride + i] = b->m_mass * b->m_invI;
+	}
+
+	int32 staticSlot = m_bodyCount + 1;
+	int32 overflowCount = 0;
+	for (int32 i = 0; i < m_constraintCount; ++i)
+	{
+		b2ContactConstraint* c = m_constraints + i;
+		if (c->color < 0)
+		{
+			m_overflow[overflowCount++] = i;
+			continue;
+		}
+
+		int32 lane = colorLanes[c->color]++;
+		int32 batch = lane / width;
+		lane -= batch * width;
+
+		int32 index[2];
+		b2Body* bodies[2] = {c->body1, c->body2};
+		for (int32 j = 0; j < 2; ++j)
+		{
+			b2Body* b = bodies[j];
+			if (b->IsStatic() == false)
+			{
+				index[j] = b->m_islandIndex;
+				continue;
+			}
+
+			// Static bodies do not move during the step.
+			int32 k = staticSlot++;
+			slots[e_slotVX * slotStride + k] = b->m_linearVelocity.x;
+			slots[e_slotVY * slotStride + k] = b->m_linearVelocity.y;
+			slots[e_slotW * slotStride + k] = b->m_angularVelocity;
+			slots[e_slotInvMass * slotStride + k] = b->m_invMass;
+			slots[e_slotInvI * slotStride + k] = b->m_invI;
+			slots[e_slotCX * slotStride + k] = b->m_sweep.c.x;
+			slots[e_slotCY * slotStride + k] = b->m_sweep.c.y;
+			slots[e_slotA * slotStride + k] = b->m_sweep.a;
+			slots[e_slotCos * slotStride + k] = b->m_xf.R.col1.x;
+			slots[e_slotSin * slotStride + k] = b->m_xf.R.col1.y;
+			slots[e_slotPositionInvMass * slotStride + k] = b->m_mass * b->m_invMass;
+			slots[e_slotPositionInvI * slotStride + k] = b->m_mass * b->m_invI;
+			index[j] = k;
+		}
+
+		m_lanes.indices1[batch * width + lane] = index[0];
+		m_lanes.indices2[batch * width + lane] = index[1];
+		m_lanes.constraints[batch * width + lane] = i;
+
+		float32* d = m_lanes.data + batch * b2_laneFieldCount * width + lane;
+		d[e_laneNormalX * width] = c->normal.x;
+		d[e_laneNormalY * width] = c->normal.y;
+		d[e_laneFriction * width] = c->friction;
+
+		for (int32 j = 0; j < c->pointCount; ++j)
+		{
+			b2ContactConstraintPoint* ccp = c->points + j;
+			b2Vec2 anchor1 = ccp->localAnchor1 - c->body1->GetLocalCenter();
+			b2Vec2 anchor2 = ccp->localAnchor2 - c->body2->GetLocalCenter();
+
+			float32* p = d + (e_lanePoints + j * e_pointFieldCount) * width;
+			p[e_pointR1X * width] = ccp->r1.x;
+			p[e_pointR1Y * width] = ccp->r1.y;
+			p[e_pointR2X * width] = ccp->r2.x;
+			p[e_pointR2Y * width] = ccp->r2.y;
+			p[e_pointNormalMass * width] = ccp->normalMass;
+			p[e_pointTangentMass * width] = ccp->tangentMass;
+			p[e_pointVelocityBias * width] = ccp->velocityBias;
+			p[e_pointNormalImpulse * width] = ccp->normalImpulse;
+			p[e_pointTangentImpulse * width] = ccp->tangentImpulse;
+			p[e_pointAnchor1X * width] = anchor1.x;
+			p[e_pointAnchor1Y * width] = anchor1.y;
+			p[e_pointAnchor2X * width] = anchor2.x;
+			p[e_pointAnchor2Y * width] = anchor2.y;
+			p[e_pointSeparation * width] = ccp->separation;
+			p[e_pointEqualizedMass * width] = ccp->equalizedMass;
+			p[e_pointActive * width] = 1.0f;
+		}
+	}
+}
+
 void b2ContactSolver::InitVelocityConstraints(const b2TimeStep& step)
 {
 	// Warm start.
@@ -179,111 +431,196 @@ void b2ContactSolver::InitVelocityConstraints(const b2TimeStep& step)
 			}
 		}
 	}
+
+	// Copy the warm starting impulses into the lanes.
+	const int32 width = m_lanes.width;
+	for (int32 i = 0; i < m_lanes.batchCount * width; ++i)
+	{
+		int32 index = m_lanes.constraints[i];
+		if (index < 0)
+		{
+			continue;
+		}
+
+		b2ContactConstraint* c = m_constraints + index;
+		float32* d = m_lanes.data + (i / width) * b2_laneFieldCount * width + i % width;
+		for (int32 j = 0; j < c->pointCount; ++j)
+		{
+			float32* p = d + (e_lanePoints + j * e_pointFieldCount) * width;
+			p[e_pointNormalImpulse * width] = c->points[j].normalImpulse;
+			p[e_pointTangentImpulse * width] = c->points[j].tangentImpulse;
+		}
+	}
 }
 
-void b2ContactSolver::SolveVelocityConstraints()
+void b2ContactSolver::SolveVelocityConstraint(b2ContactConstraint* c)
 {
-	for (int32 i = 0; i < m_constraintCount; ++i)
-	{
-		b2ContactConstraint* c = m_constraints + i;
-		b2Body* b1 = c->body1;
-		b2Body* b2 = c->body2;
-		float32 w1 = b1->m_angularVelocity;
-		float32 w2 = b2->m_angularVelocity;
-		b2Vec2 v1 = b1->m_linearVelocity;
-		b2Vec2 v2 = b2->m_linearVelocity;
-		float32 invMass1 = b1->m_invMass;
-		float32 invI1 = b1->m_invI;
-		float32 invMass2 = b2->m_invMass;
-		float32 invI2 = b2->m_invI;
-		b2Vec2 normal = c->normal;
-		b2Vec2 tangent = b2Cross(normal, 1.0f);
-		float32 friction = c->friction;
+	b2Body* b1 = c->body1;
+	b2Body* b2 = c->body2;
+	float32 w1 = b1->m_angularVelocity;
+	float32 w2 = b2->m_angularVelocity;
+	b2Vec2 v1 = b1->m_linearVelocity;
+	b2Vec2 v2 = b2->m_linearVelocity;
+	float32 invMass1 = b1->m_invMass;
+	float32 invI1 = b1->m_invI;
+	float32 invMass2 = b2->m_invMass;
+	float32 invI2 = b2->m_invI;
+	b2Vec2 normal = c->normal;
+	b2Vec2 tangent = b2Cross(normal, 1.0f);
+	float32 friction = c->friction;
 //#define DEFERRED_UPDATE
 #ifdef DEFERRED_UPDATE
-		b2Vec2 b1_linearVelocity = b1->m_linearVelocity;
-		float32 b1_angularVelocity = b1->m_angularVelocity;
-		b2Vec2 b2_linearVelocity = b2->m_linearVelocity;
-		float32 b2_angularVelocity = b2->m_angularVelocity;
+	b2Vec2 b1_linearVelocity = b1->m_linearVelocity;
+	float32 b1_angularVelocity = b1->m_angularVelocity;
+	b2Vec2 b2_linearVelocity = b2->m_linearVelocity;
+	float32 b2_angularVelocity = b2->m_angularVelocity;
 #endif
-		// Solve normal constraints
-		for (int32 j = 0; j < c->pointCount; ++j)
-		{
-			b2ContactConstraintPoint* ccp = c->points + j;
+	// Solve normal constraints
+	for (int32 j = 0; j < c->pointCount; ++j)
+	{
+		b2ContactConstraintPoint* ccp = c->points + j;
 
-			// Relative velocity at contact
-			b2Vec2 dv = v2 + b2Cross(w2, ccp->r2) - v1 - b2Cross(w1, ccp->r1);
+		// Relative velocity at contact
+		b2Vec2 dv = v2 + b2Cross(w2, ccp->r2) - v1 - b2Cross(w1, ccp->r1);
 
-			// Compute normal impulse
-			float32 vn = b2Dot(dv, normal);
-			float32 lambda = -ccp->normalMass * (vn - ccp->velocityBias);
+		// Compute normal impulse
+		float32 vn = b2Dot(dv, normal);
+		float32 lambda = -ccp->normalMass * (vn - ccp->velocityBias);
 
-			// b2Clamp the accumulated impulse
-			float32 newImpulse = b2Max(ccp->normalImpulse + lambda, 0.0f);
-			lambda = newImpulse - ccp->normalImpulse;
+		// b2Clamp the accumulated impulse
+		float32 newImpulse = b2Max(ccp->normalImpulse + lambda, 0.0f);
+		lambda = newImpulse - ccp->normalImpulse;
 
-			// Apply contact impulse
-			b2Vec2 P = lambda * normal;
+		// Apply contact impulse
+		b2Vec2 P = lambda * normal;
 #ifdef DEFERRED_UPDATE
-			b1_linearVelocity -= invMass1 * P;
-			b1_angularVelocity -= invI1 * b2Cross(r1, P);
+		b1_linearVelocity -= invMass1 * P;
+		b1_angularVelocity -= invI1 * b2Cross(r1, P);
 
-			b2_linearVelocity += invMass2 * P;
-			b2_angularVelocity += invI2 * b2Cross(r2, P);
+		b2_linearVelocity += invMass2 * P;
+		b2_angularVelocity += invI2 * b2Cross(r2, P);
 #else
-			v1 -= invMass1 * P;
-			w1 -= invI1 * b2Cross(ccp->r1, P);
+		v1 -= invMass1 * P;
+		w1 -= invI1 * b2Cross(ccp->r1, P);
 
-			v2 += invMass2 * P;
-			w2 += invI2 * b2Cross(ccp->r2, P);
+		v2 += invMass2 * P;
+		w2 += invI2 * b2Cross(ccp->r2, P);
 #endif
-			ccp->normalImpulse = newImpulse;
-		}
+		ccp->normalImpulse = newImpulse;
+	}
 
 #ifdef DEFERRED_UPDATE
-		b1->m_linearVelocity = b1_linearVelocity;
-		b1->m_angularVelocity = b1_angularVelocity;
-		b2->m_linearVelocity = b2_linearVelocity;
-		b2->m_angularVelocity = b2_angularVelocity;
+	b1->m_linearVelocity = b1_linearVelocity;
+	b1->m_angularVelocity = b1_angularVelocity;
+	b2->m_linearVelocity = b2_linearVelocity;
+	b2->m_angularVelocity = b2_angularVelocity;
 #endif
-		// Solve tangent constraints
-		for (int32 j = 0; j < c->pointCount; ++j)
-		{
-			b2ContactConstraintPoint* ccp = c->points + j;
+	// Solve tangent constraints
+	for (int32 j = 0; j < c->pointCount; ++j)
+	{
+		b2ContactConstraintPoint* ccp = c->points + j;
+
+		// Relative velocity at contact
+		b2Vec2 dv = v2 + b2Cross(w2, ccp->r2) - v1 - b2Cross(w1, ccp->r1);
+
+		// Compute tangent force
+		float32 vt = b2Dot(dv, tangent);
+		float32 lambda = ccp->tangentMass * (-vt);
 
-			// Relative velocity at contact
-			b2Vec2 dv = v2 + b2Cross(w2, ccp->r2) - v1 - b2Cross(w1, ccp->r1);
+		// b2Clamp the accumulated force
+		float32 maxFriction = friction * ccp->normalImpulse;
+		float32 newImpulse = b2Clamp(ccp->tangentImpulse + lambda, -maxFriction, maxFriction);
+		lambda = newImpulse - ccp->tangentImpulse;
 
-			// Compute tangent force
-			float32 vt = b2Dot(dv, tangent);
-			float32 lambda = ccp->tangentMass * (-vt);
+		// Apply contact impulse
+		b2Vec2 P = lambda * tangent;
 
-			// b2Clamp the accumulated force
-			float32 maxFriction = friction * ccp->normalImpulse;
-			float32 newImpulse = b2Clamp(ccp->tangentImpulse + lambda, -maxFriction, maxFriction);
-			lambda = newImpulse - ccp->tangentImpulse;
+		v1 -= invMass1 * P;
+		w1 -= invI1 * b2Cross(ccp->r1, P);
 
-			// Apply contact impulse
-			b2Vec2 P = lambda * tangent;
+		v2 += invMass2 * P;
+		w2 += invI2 * b2Cross(ccp->r2, P);
 
-			v1 -= invMass1 * P;
-			w1 -= invI1 * b2Cross(ccp->r1, P);
+		ccp->tangentImpulse = newImpulse;
+	}
+
+	b1->m_linearVelocity = v1;
+	b1->m_angularVelocity = w1;
+	b2->m_linearVelocity = v2;
+	b2->m_angularVelocity = w2;
+}
+
+void b2ContactSolver::SolveVelocityConstraints()
+{
+#ifdef B2_SIMD_CONTACTS
+	if (m_lanes.batchCount > 0)
+	{
+		float32* slots = m_lanes.slots;
+		const int32 stride = m_lanes.slotStride;
+		for (int32 i = 0; i < m_bodyCount; ++i)
+		{
+			b2Body* b = m_bodies[i];
+			slots[e_slotVX * stride + i] = b->m_linearVelocity.x;
+			slots[e_slotVY * stride + i] = b->m_linearVelocity.y;
+			slots[e_slotW * stride + i] = b->m_angularVelocity;
+		}
+
+		if (m_step.contactSolver == e_avx2ContactSolver)
+		{
+			b2SolveVelocityLanesAVX2(&m_lanes);
+		}
+		else
+		{
+			b2SolveVelocityLanesSSE2(&m_lanes);
+		}
 
-			v2 += invMass2 * P;
-			w2 += invI2 * b2Cross(ccp->r2, P);
+		for (int32 i = 0; i < m_bodyCount; ++i)
+		{
+			b2Body* b = m_bodies[i];
+			if (b->IsStatic())
+			{
+				continue;
+			}
+			b->m_linearVelocity.Set(slots[e_slotVX * stride + i], slots[e_slotVY * stride + i]);
+			b->m_angularVelocity = slots[e_slotW * stride + i];
+		}
 
-			ccp->tangentImpulse = newImpulse;
+		for (int32 i = 0; i < m_overflowCount; ++i)
+		{
+			SolveVelocityConstraint(m_constraints + m_overflow[i]);
 		}
+		return;
+	}
+#endif
 
-		b1->m_linearVelocity = v1;
-		b1->m_angularVelocity = w1;
-		b2->m_linearVelocity = v2;
-		b2->m_angularVelocity = w2;
+	for (int32 i = 0; i < m_constraintCount; ++i)
+	{
+		SolveVelocityConstraint(m_constraints + i);
 	}
 }
 
 void b2ContactSolver::FinalizeVelocityConstraints()
 {
+	// Copy the impulses back out of the lanes.
+	const int32 width = m_lanes.width;
+	for (int32 i = 0; i < m_lanes.batchCount * width; ++i)
+	{
+		int32 index = m_lanes.constraints[i];
+		if (index < 0)
+		{
+			continue;
+		}
+
+		b2ContactConstraint* c = m_constraints + index;
+		const float32* d = m_lanes.data + (i / width) * b2_laneFieldCount * width + i % width;
+		for (int32 j = 0; j < c->pointCount; ++j)
+		{
+			const float32* p = d + (e_lanePoints + j * e_pointFieldCount) * width;
+			c->points[j].normalImpulse = p[e_pointNormalImpulse * width];
+			c->points[j].tangentImpulse = p[e_pointTangentImpulse * width];
+		}
+	}
+
 	for (int32 i = 0; i < m_constraintCount; ++i)
 	{
 		b2ContactConstraint* c = m_constraints + i;
@@ -297,60 +634,111 @@ void b2ContactSolver::FinalizeVelocityConstraints()
 	}
 }
 
-bool b2ContactSolver::SolvePositionConstraints(float32 baumgarte)
+float32 b2ContactSolver::SolvePositionConstraint(b2ContactConstraint* c, float32 baumgarte, float32 minSeparation)
 {
-	float32 minSeparation = 0.0f;
-
-	for (int32 i = 0; i < m_constraintCount; ++i)
+	b2Body* b1 = c->body1;
+	b2Body* b2 = c->body2;
+	float32 invMass1 = b1->m_mass * b1->m_invMass;
+	float32 invI1 = b1->m_mass * b1->m_invI;
+	float32 invMass2 = b2->m_mass * b2->m_invMass;
+	float32 invI2 = b2->m_mass * b2->m_invI;
+	
+	b2Vec2 normal = c->normal;
+
+	// Solver normal constraints
+	for (int32 j = 0; j < c->pointCount; ++j)
 	{
-		b2ContactConstraint* c = m_constraints + i;
-		b2Body* b1 = c->body1;
-		b2Body* b2 = c->body2;
-		float32 invMass1 = b1->m_mass * b1->m_invMass;
-		float32 invI1 = b1->m_mass * b1->m_invI;
-		float32 invMass2 = b2->m_mass * b2->m_invMass;
-		float32 invI2 = b2->m_mass * b2->m_invI;
-		
-		b2Vec2 normal = c->normal;
+		b2ContactConstraintPoint* ccp = c->points + j;
 
-		// Solver normal constraints
-		for (int32 j = 0; j < c->pointCount; ++j)
-		{
-			b2ContactConstraintPoint* ccp = c->points + j;
+		b2Vec2 r1 = b2Mul(b1->GetXForm().R, ccp->localAnchor1 - b1->GetLocalCenter());
+		b2Vec2 r2 = b2Mul(b2->GetXForm().R, ccp->localAnchor2 - b2->GetLocalCenter());
+
+		b2Vec2 p1 = b1->m_sweep.c + r1;
+		b2Vec2 p2 = b2->m_sweep.c + r2;
+		b2Vec2 dp = p2 - p1;
+
+		// Approximate the current separation.
+		float32 separation = b2Dot(dp, normal) + ccp->separation;
+
+		// Track max constraint error.
+		minSeparation = b2Min(minSeparation, separation);
+
+		// Prevent large corrections and allow slop.
+		float32 C = baumgarte * b2Clamp(separation + b2_linearSlop, -b2_maxLinearCorrection, 0.0f);
 
-			b2Vec2 r1 = b2Mul(b1->GetXForm().R, ccp->localAnchor1 - b1->GetLocalCenter());
-			b2Vec2 r2 = b2Mul(b2->GetXForm().R, ccp->localAnchor2 - b2->GetLocalCenter());
+		// Compute normal impulse
+		float32 dImpulse = -ccp->equalizedMass * C;
 
-			b2Vec2 p1 = b1->m_sweep.c + r1;
-			b2Vec2 p2 = b2->m_sweep.c + r2;
-			b2Vec2 dp = p2 - p1;
+		// b2Clamp the accumulated impulse
+		float32 impulse0 = ccp->positionImpulse;
+		ccp->positionImpulse = b2Max(impulse0 + dImpulse, 0.0f);
+		dImpulse = ccp->positionImpulse - impulse0;
 
-			// Approximate the current separation.
-			float32 separation = b2Dot(dp, normal) + ccp->separation;
+		b2Vec2 impulse = dImpulse * normal;
 
-			// Track max constraint error.
-			minSeparation = b2Min(minSeparation, separation);
+		b1->m_sweep.c -= invMass1 * impulse;
+		b1->m_sweep.a -= invI1 * b2Cross(r1, impulse);
+		b1->SynchronizeTransform();
 
-			// Prevent large corrections and allow slop.
-			float32 C = baumgarte * b2Clamp(separation + b2_linearSlop, -b2_maxLinearCorrection, 0.0f);
+		b2->m_sweep.c += invMass2 * impulse;
+		b2->m_sweep.a += invI2 * b2Cross(r2, impulse);
+		b2->SynchronizeTransform();
+	}
+
+	return minSeparation;
+}
 
-			// Compute normal impulse
-			float32 dImpulse = -ccp->equalizedMass * C;
+bool b2ContactSolver::SolvePositionConstraints(float32 baumgarte)
+{
+	float32 minSeparation = 0.0f;
 
-			// b2Clamp the accumulated impulse
-			float32 impulse0 = ccp->positionImpulse;
-			ccp->positionImpulse = b2Max(impulse0 + dImpulse, 0.0f);
-			dImpulse = ccp->positionImpulse - impulse0;
+#ifdef B2_SIMD_CONTACTS
+	if (m_lanes.batchCount > 0)
+	{
+		float32* slots = m_lanes.slots;
+		const int32 stride = m_lanes.slotStride;
+		for (int32 i = 0; i < m_bodyCount; ++i)
+		{
+			b2Body* b = m_bodies[i];
+			slots[e_slotCX * stride + i] = b->m_sweep.c.x;
+			slots[e_slotCY * stride + i] = b->m_sweep.c.y;
+			slots[e_slotA * stride + i] = b->m_sweep.a;
+			slots[e_slotCos * stride + i] = b->m_xf.R.col1.x;
+			slots[e_slotSin * stride + i] = b->m_xf.R.col1.y;
+		}
 
-			b2Vec2 impulse = dImpulse * normal;
+		if (m_step.contactSolver == e_avx2ContactSolver)
+		{
+			minSeparation = b2SolvePositionLanesAVX2(&m_lanes, baumgarte);
+		}
+		else
+		{
+			minSeparation = b2SolvePositionLanesSSE2(&m_lanes, baumgarte);
+		}
 
-			b1->m_sweep.c -= invMass1 * impulse;
-			b1->m_sweep.a -= invI1 * b2Cross(r1, impulse);
-			b1->SynchronizeTransform();
+		for (int32 i = 0; i < m_bodyCount; ++i)
+		{
+			b2Body* b = m_bodies[i];
+			if (b->IsStatic())
+			{
+				continue;
+			}
+			b->m_sweep.c.Set(slots[e_slotCX * stride + i], slots[e_slotCY * stride + i]);
+			b->m_sweep.a = slots[e_slotA * stride + i];
+			b->SynchronizeTransform();
+		}
 
-			b2->m_sweep.c += invMass2 * impulse;
-			b2->m_sweep.a += invI2 * b2Cross(r2, impulse);
-			b2->SynchronizeTransform();
+		for (int32 i = 0; i < m_overflowCount; ++i)
+		{
+			minSeparation = SolvePositionConstraint(m_constraints + m_overflow[i], baumgarte, minSeparation);
+		}
+	}
+	else
+#endif
+	{
+		for (int32 i = 0; i < m_constraintCount; ++i)
+		{
+			minSeparation = SolvePositionConstraint(m_constraints + i, baumgarte, minSeparation);
 		}
 	}
 
@@ -22,6 +22,7 @@
 #include "../../Common/b2Math.h"
 #include "../../Collision/b2Collision.h"
 #include "../b2World.h"
+#include "b2ContactLanes.h"
 
 class b2Contact;
 class b2Body;
@@ -54,12 +55,14 @@ struct b2ContactConstraint
 	float32 friction;
 	float32 restitution;
 	int32 pointCount;
+	int32 color;
 };
 
 class b2ContactSolver
 {
 public:
-	b2ContactSolver(const b2TimeStep& step, b2Contact** contacts, int32 contactCount, b2StackAllocator* allocator);
+	b2ContactSolver(const b2TimeStep& step, b2Body** bodies, int32 bodyCount,
+					b2Contact** contacts, int32 contactCount, b2StackAllocator* allocator);
 	~b2ContactSolver();
 
 	void InitVelocityConstraints(const b2TimeStep& step);
@@ -68,10 +71,28 @@ public:
 
 	bool SolvePositionConstraints(float32 baumgarte);
 
+	/// Get the back end this CPU can run for the requested type.
+	static b2ContactSolverType GetSupportedType(b2ContactSolverType type);
+
 	b2TimeStep m_step;
 	b2StackAllocator* m_allocator;
 	b2ContactConstraint* m_constraints;
 	int m_constraintCount;
+
+	// SIMD back ends only. Constraints that could not be coloured are
+	// solved by the scalar code after the lanes.
+	b2Body** m_bodies;
+	int32 m_bodyCount;
+	b2ContactLanes m_lanes;
+	int32* m_overflow;
+	int32 m_overflowCount;
+	void* m_laneMemory;
+
+private:
+	void InitLanes();
+
+	static void SolveVelocityConstraint(b2ContactConstraint* c);
+	static float32 SolvePositionConstraint(b2ContactConstraint* c, float32 baumgarte, float32 minSeparation);
 };
 
 #endif
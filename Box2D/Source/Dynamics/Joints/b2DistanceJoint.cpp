@@ -204,3 +204,14 @@ float32 b2DistanceJoint::GetReactionTorque() const
 {
 	return 0.0f;
 }
+
+int32 b2DistanceJoint::SaveState(float32* values) const
+{
+	values[0] = m_impulse;
+	return 1;
+}
+
+void b2DistanceJoint::RestoreState(const float32* values)
+{
+	m_impulse = values[0];
+}
@@ -250,4 +250,13 @@ float32 b2GearJoint::GetRatio() const
 	return m_ratio;
 }
 
+int32 b2GearJoint::SaveState(float32* values) const
+{
+	values[0] = m_force;
+	return 1;
+}
 
+void b2GearJoint::RestoreState(const float32* values)
+{
+	m_force = values[0];
+}
@@ -77,6 +77,9 @@ public:
 	void SolveVelocityConstraints(const b2TimeStep& step);
 	bool SolvePositionConstraints();
 
+	int32 SaveState(float32* values) const;
+	void RestoreState(const float32* values);
+
 	b2Body* m_ground1;
 	b2Body* m_ground2;
 
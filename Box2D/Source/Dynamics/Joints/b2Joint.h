@@ -25,6 +25,7 @@ class b2Body;
 class b2Joint;
 struct b2TimeStep;
 class b2BlockAllocator;
+struct b2PersistentIsland;
 
 enum b2JointType
 {
@@ -139,6 +140,7 @@ protected:
 	friend class b2World;
 	friend class b2Body;
 	friend class b2Island;
+	friend class b2IslandManager;
 
 	static b2Joint* Create(const b2JointDef* def, b2BlockAllocator* allocator);
 	static void Destroy(b2Joint* joint, b2BlockAllocator* allocator);
@@ -153,6 +155,11 @@ protected:
 	virtual void InitPositionConstraints() {}
 	virtual bool SolvePositionConstraints() = 0;
 
+	// Copy the warm starting state out or in, see b2WorldState. Returns
+	// the number of values, at most b2_maxJointStateValues.
+	virtual int32 SaveState(float32*) const { return 0; }
+	virtual void RestoreState(const float32*) {}
+
 	b2JointType m_type;
 	b2Joint* m_prev;
 	b2Joint* m_next;
@@ -163,7 +170,11 @@ protected:
 
 	float32 m_inv_dt;
 
-	bool m_islandFlag;
+	// The persistent island, if either body is dynamic.
+	b2PersistentIsland* m_island;
+	b2Joint* m_islandPrev;
+	b2Joint* m_islandNext;
+
 	bool m_collideConnected;
 
 	void* m_userData;
@@ -144,3 +144,16 @@ float32 b2MouseJoint::GetReactionTorque() const
 {
 	return 0.0f;
 }
+
+int32 b2MouseJoint::SaveState(float32* values) const
+{
+	values[0] = m_impulse.x;
+	values[1] = m_impulse.y;
+	return 2;
+}
+
+void b2MouseJoint::RestoreState(const float32* values)
+{
+	m_impulse.x = values[0];
+	m_impulse.y = values[1];
+}
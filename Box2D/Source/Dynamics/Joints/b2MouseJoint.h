@@ -88,6 +88,9 @@ public:
 		return true;
 	}
 
+	int32 SaveState(float32* values) const;
+	void RestoreState(const float32* values);
+
 	b2Vec2 m_localAnchor;
 	b2Vec2 m_target;
 	b2Vec2 m_impulse;
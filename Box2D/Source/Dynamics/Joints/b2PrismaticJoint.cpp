@@ -474,5 +474,23 @@ float32 b2PrismaticJoint::GetMotorForce() const
 	return m_motorForce;
 }
 
+int32 b2PrismaticJoint::SaveState(float32* values) const
+{
+	values[0] = m_force;
+	values[1] = m_torque;
+	values[2] = m_motorForce;
+	values[3] = m_limitForce;
+	values[4] = m_limitPositionImpulse;
+	values[5] = float32(int32(m_limitState));
+	return 6;
+}
 
-
+void b2PrismaticJoint::RestoreState(const float32* values)
+{
+	m_force = values[0];
+	m_torque = values[1];
+	m_motorForce = values[2];
+	m_limitForce = values[3];
+	m_limitPositionImpulse = values[4];
+	m_limitState = b2LimitState(int32(float32(values[5])));
+}
@@ -139,6 +139,9 @@ public:
 	void SolveVelocityConstraints(const b2TimeStep& step);
 	bool SolvePositionConstraints();
 
+	int32 SaveState(float32* values) const;
+	void RestoreState(const float32* values);
+
 	b2Vec2 m_localAnchor1;
 	b2Vec2 m_localAnchor2;
 	b2Vec2 m_localXAxis1;
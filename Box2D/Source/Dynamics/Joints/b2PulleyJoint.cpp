@@ -428,3 +428,30 @@ float32 b2PulleyJoint::GetRatio() const
 {
 	return m_ratio;
 }
+
+int32 b2PulleyJoint::SaveState(float32* values) const
+{
+	values[0] = m_force;
+	values[1] = m_limitForce1;
+	values[2] = m_limitForce2;
+	values[3] = m_positionImpulse;
+	values[4] = m_limitPositionImpulse1;
+	values[5] = m_limitPositionImpulse2;
+	values[6] = float32(int32(m_state));
+	values[7] = float32(int32(m_limitState1));
+	values[8] = float32(int32(m_limitState2));
+	return 9;
+}
+
+void b2PulleyJoint::RestoreState(const float32* values)
+{
+	m_force = values[0];
+	m_limitForce1 = values[1];
+	m_limitForce2 = values[2];
+	m_positionImpulse = values[3];
+	m_limitPositionImpulse1 = values[4];
+	m_limitPositionImpulse2 = values[5];
+	m_state = b2LimitState(int32(float32(values[6])));
+	m_limitState1 = b2LimitState(int32(float32(values[7])));
+	m_limitState2 = b2LimitState(int32(float32(values[8])));
+}
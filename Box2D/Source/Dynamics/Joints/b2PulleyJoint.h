@@ -115,6 +115,9 @@ public:
 	void SolveVelocityConstraints(const b2TimeStep& step);
 	bool SolvePositionConstraints();
 
+	int32 SaveState(float32* values) const;
+	void RestoreState(const float32* values);
+
 	b2Body* m_ground;
 	b2Vec2 m_groundAnchor1;
 	b2Vec2 m_groundAnchor2;
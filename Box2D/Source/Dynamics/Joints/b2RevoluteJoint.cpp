@@ -62,6 +62,7 @@ b2RevoluteJoint::b2RevoluteJoint(const b2RevoluteJointDef* def)
 	m_motorSpeed = def->motorSpeed;
 	m_enableLimit = def->enableLimit;
 	m_enableMotor = def->enableMotor;
+	m_limitState = e_inactiveLimit;
 }
 
 void b2RevoluteJoint::InitVelocityConstraints(const b2TimeStep& step)
@@ -397,3 +398,24 @@ void b2RevoluteJoint::SetLimits(float32 lower, float32 upper)
 	m_lowerAngle = lower;
 	m_upperAngle = upper;
 }
+
+int32 b2RevoluteJoint::SaveState(float32* values) const
+{
+	values[0] = m_pivotForce.x;
+	values[1] = m_pivotForce.y;
+	values[2] = m_motorForce;
+	values[3] = m_limitForce;
+	values[4] = m_limitPositionImpulse;
+	values[5] = float32(int32(m_limitState));
+	return 6;
+}
+
+void b2RevoluteJoint::RestoreState(const float32* values)
+{
+	m_pivotForce.x = values[0];
+	m_pivotForce.y = values[1];
+	m_motorForce = values[2];
+	m_limitForce = values[3];
+	m_limitPositionImpulse = values[4];
+	m_limitState = b2LimitState(int32(float32(values[5])));
+}
@@ -143,6 +143,9 @@ public:
 
 	bool SolvePositionConstraints();
 
+	int32 SaveState(float32* values) const;
+	void RestoreState(const float32* values);
+
 	b2Vec2 m_localAnchor1;	// relative
 	b2Vec2 m_localAnchor2;
 	b2Vec2 m_pivotForce;
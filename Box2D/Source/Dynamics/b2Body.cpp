@@ -69,6 +69,11 @@ b2Body::b2Body(const b2BodyDef* bd, b2World* world)
 	m_angularVelocity = 0.0f;
 
 	m_sleepTime = 0.0f;
+	m_islandIndex = 0;
+
+	m_island = NULL;
+	m_islandPrev = NULL;
+	m_islandNext = NULL;
 
 	m_invMass = 0.0f;
 	m_I = 0.0f;
@@ -231,6 +236,8 @@ void b2Body::SetMass(const b2MassData* massData)
 		{
 			s->RefilterProxy(m_world->m_broadPhase, m_xf);
 		}
+
+		m_world->m_islandManager.UpdateBody(this);
 	}
 }
 
@@ -306,6 +313,8 @@ void b2Body::SetMassFromShapes()
 		{
 			s->RefilterProxy(m_world->m_broadPhase, m_xf);
 		}
+
+		m_world->m_islandManager.UpdateBody(this);
 	}
 }
 
@@ -356,6 +365,9 @@ bool b2Body::SetXForm(const b2Vec2& position, float32 angle)
 
 	// Success
 	m_world->m_broadPhase->Commit();
+
+	// The shapes moved, so their contacts need a look even if the body sleeps.
+	WakeContacts(true);
 	return true;
 }
 
@@ -392,3 +404,25 @@ bool b2Body::SynchronizeShapes()
 	// Success
 	return true;
 }
+
+void b2Body::WakeContacts(bool refresh)
+{
+	for (b2ContactEdge* ce = m_contactList; ce; ce = ce->next)
+	{
+		if (refresh)
+		{
+			ce->contact->m_flags |= b2Contact::e_refreshFlag;
+		}
+		m_world->m_contactManager.AddAwake(ce->contact);
+	}
+}
+
+void b2Body::WakeGraph()
+{
+	WakeContacts(false);
+
+	if (m_island)
+	{
+		m_world->m_islandManager.Wake(m_island);
+	}
+}
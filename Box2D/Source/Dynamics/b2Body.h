@@ -30,6 +30,7 @@ class b2Contact;
 class b2World;
 struct b2JointEdge;
 struct b2ContactEdge;
+struct b2PersistentIsland;
 
 /// A body definition holds all the data needed to construct a rigid body.
 /// You can safely re-use body definitions.
@@ -274,6 +275,7 @@ private:
 	friend class b2Island;
 	friend class b2ContactManager;
 	friend class b2ContactSolver;
+	friend class b2IslandManager;
 	
 	friend class b2DistanceJoint;
 	friend class b2GearJoint;
@@ -314,6 +316,16 @@ private:
 
 	void Advance(float32 t);
 
+	// Clear the sleep flag without touching the sleep timer.
+	void Awaken();
+
+	// Move this body's contacts back to the world's awake contact list.
+	// Refreshed contacts are evaluated once even if both bodies sleep.
+	void WakeContacts(bool refresh);
+
+	// Wake the contacts and the island after the sleep flag was cleared.
+	void WakeGraph();
+
 	uint16 m_flags;
 	int16 m_type;
 
@@ -345,6 +357,14 @@ private:
 
 	float32 m_sleepTime;
 
+	// Index in the island being solved. Only valid for non-static bodies.
+	int32 m_islandIndex;
+
+	// The persistent island and its body list. Static bodies have none.
+	b2PersistentIsland* m_island;
+	b2Body* m_islandPrev;
+	b2Body* m_islandNext;
+
 	void* m_userData;
 };
 
@@ -485,10 +505,24 @@ inline void b2Body::AllowSleeping(bool flag)
 
 inline void b2Body::WakeUp()
 {
-	m_flags &= ~e_sleepFlag;
+	Awaken();
 	m_sleepTime = 0.0f;
 }
 
+inline void b2Body::Awaken()
+{
+	if (m_flags & e_sleepFlag)
+	{
+		m_flags &= ~e_sleepFlag;
+
+		// Contacts with a static body sleep with the other body.
+		if (m_type != e_staticType)
+		{
+			WakeGraph();
+		}
+	}
+}
+
 inline void b2Body::PutToSleep()
 {
 	m_flags |= e_sleepFlag;
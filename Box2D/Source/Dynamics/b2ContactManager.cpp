@@ -27,6 +27,8 @@ void* b2ContactManager::PairAdded(void* proxyUserData1, void* proxyUserData2)
 	b2Shape* shape1 = (b2Shape*)proxyUserData1;
 	b2Shape* shape2 = (b2Shape*)proxyUserData2;
 
+	++m_world->m_profile.pairsAdded;
+
 	b2Body* body1 = shape1->GetBody();
 	b2Body* body2 = shape2->GetBody();
 
@@ -73,6 +75,11 @@ void* b2ContactManager::PairAdded(void* proxyUserData1, void* proxyUserData2)
 	}
 	m_world->m_contactList = c;
 
+	// New contacts start awake and are evaluated at least once, so a
+	// contact that falls asleep always keeps a valid manifold.
+	c->m_flags |= b2Contact::e_refreshFlag;
+	AddAwake(c);
+
 	// Connect to island graph.
 
 	// Connect to body 1
@@ -110,6 +117,8 @@ void b2ContactManager::PairRemoved(void* proxyUserData1, void* proxyUserData2, v
 	B2_NOT_USED(proxyUserData1);
 	B2_NOT_USED(proxyUserData2);
 
+	++m_world->m_profile.pairsRemoved;
+
 	if (pairUserData == NULL)
 	{
 		return;
@@ -180,6 +189,13 @@ void b2ContactManager::Destroy(b2Contact* c)
 		m_world->m_contactList = c->m_next;
 	}
 
+	RemoveAwake(c);
+
+	if (c->m_island)
+	{
+		m_world->m_islandManager.UnlinkContact(c);
+	}
+
 	b2Body* body1 = shape1->GetBody();
 	b2Body* body2 = shape2->GetBody();
 
@@ -220,21 +236,78 @@ void b2ContactManager::Destroy(b2Contact* c)
 	--m_world->m_contactCount;
 }
 
+void b2ContactManager::AddAwake(b2Contact* c)
+{
+	if (c->m_flags & b2Contact::e_awakeFlag)
+	{
+		return;
+	}
+
+	c->m_flags |= b2Contact::e_awakeFlag;
+	c->m_awakePrev = NULL;
+	c->m_awakeNext = m_world->m_awakeContactList;
+	if (m_world->m_awakeContactList != NULL)
+	{
+		m_world->m_awakeContactList->m_awakePrev = c;
+	}
+	m_world->m_awakeContactList = c;
+	++m_world->m_awakeContactCount;
+}
+
+void b2ContactManager::RemoveAwake(b2Contact* c)
+{
+	if ((c->m_flags & b2Contact::e_awakeFlag) == 0)
+	{
+		return;
+	}
+
+	if (c->m_awakePrev)
+	{
+		c->m_awakePrev->m_awakeNext = c->m_awakeNext;
+	}
+
+	if (c->m_awakeNext)
+	{
+		c->m_awakeNext->m_awakePrev = c->m_awakePrev;
+	}
+
+	if (c == m_world->m_awakeContactList)
+	{
+		m_world->m_awakeContactList = c->m_awakeNext;
+	}
+
+	// Sleeping contacts are skipped by the island and TOI passes, so
+	// drop their per-step flags here instead of clearing them every step.
+	c->m_flags &= ~(b2Contact::e_awakeFlag | b2Contact::e_islandFlag | b2Contact::e_toiFlag);
+	--m_world->m_awakeContactCount;
+}
+
 // This is the top level collision call for the time step. Here
 // all the narrow phase collision is processed for the world
-// contact list.
+// awake contact list. Contacts whose bodies are all asleep or static
+// cannot change, so they are unlinked until one of the bodies wakes up.
 void b2ContactManager::Collide()
 {
-	// Update awake contacts.
-	for (b2Contact* c = m_world->m_contactList; c; c = c->GetNext())
+	b2Contact* c = m_world->m_awakeContactList;
+	while (c)
 	{
+		b2Contact* next = c->m_awakeNext;
+
 		b2Body* body1 = c->GetShape1()->GetBody();
 		b2Body* body2 = c->GetShape2()->GetBody();
-		if (body1->IsSleeping() && body2->IsSleeping())
+		bool asleep1 = body1->IsSleeping() || body1->IsStatic();
+		bool asleep2 = body2->IsSleeping() || body2->IsStatic();
+		if (asleep1 && asleep2 && (c->m_flags & b2Contact::e_refreshFlag) == 0)
+		{
+			RemoveAwake(c);
+		}
+		else
 		{
-			continue;
+			c->m_flags &= ~b2Contact::e_refreshFlag;
+			c->Update(m_world->m_contactListener);
+			++m_world->m_profile.contactsUpdated;
 		}
 
-		c->Update(m_world->m_contactListener);
+		c = next;
 	}
 }
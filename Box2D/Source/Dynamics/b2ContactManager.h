@@ -40,6 +40,10 @@ public:
 
 	void Destroy(b2Contact* c);
 
+	// Link a contact into or out of the world's awake contact list.
+	void AddAwake(b2Contact* c);
+	void RemoveAwake(b2Contact* c);
+
 	void Collide();
 
 	b2World* m_world;
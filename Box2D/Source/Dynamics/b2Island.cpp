@@ -135,6 +135,13 @@ b2Island::~b2Island()
 	m_allocator->Free(m_bodies);
 }
 
+void b2Island::Add(b2Body* body)
+{
+	b2Assert(m_bodyCount < m_bodyCapacity);
+	body->m_islandIndex = m_bodyCount;
+	m_bodies[m_bodyCount++] = body;
+}
+
 void b2Island::Solve(const b2TimeStep& step, const b2Vec2& gravity, bool correctPositions, bool allowSleep)
 {
 	// Integrate velocities and apply damping.
@@ -197,7 +204,7 @@ void b2Island::Solve(const b2TimeStep& step, const b2Vec2& gravity, bool correct
 
 	}
 
-	b2ContactSolver contactSolver(step, m_contacts, m_contactCount, m_allocator);
+	b2ContactSolver contactSolver(step, m_bodies, m_bodyCount, m_contacts, m_contactCount, m_allocator);
 
 	// Initialize velocity constraints.
 	contactSolver.InitVelocityConstraints(step);
@@ -331,7 +338,7 @@ void b2Island::Solve(const b2TimeStep& step, const b2Vec2& gravity, bool correct
 
 void b2Island::SolveTOI(const b2TimeStep& subStep)
 {
-	b2ContactSolver contactSolver(subStep, m_contacts, m_contactCount, m_allocator);
+	b2ContactSolver contactSolver(subStep, m_bodies, m_bodyCount, m_contacts, m_contactCount, m_allocator);
 
 	// No warm starting needed for TOI events.
 
@@ -387,10 +394,12 @@ void b2Island::Report(b2ContactConstraint* constraints)
 		return;
 	}
 
+	// There is one constraint per manifold.
+	b2ContactConstraint* cc = constraints;
+
 	for (int32 i = 0; i < m_contactCount; ++i)
 	{
 		b2Contact* c = m_contacts[i];
-		b2ContactConstraint* cc = constraints + i;
 		b2ContactResult cr;
 		cr.shape1 = c->GetShape1();
 		cr.shape2 = c->GetShape2();
@@ -404,17 +413,30 @@ void b2Island::Report(b2ContactConstraint* constraints)
 			for (int32 k = 0; k < manifold->pointCount; ++k)
 			{
 				b2ManifoldPoint* point = manifold->points + k;
-				b2ContactConstraintPoint* ccp = cc->points + k;
 				cr.position = b1->GetWorldPoint(point->localPoint1);
 
-				// TOI constraint results are not stored, so get
-				// the result from the constraint.
-				cr.normalImpulse = ccp->normalImpulse;
-				cr.tangentImpulse = ccp->tangentImpulse;
+				if (cc)
+				{
+					// TOI constraint results are not stored, so get
+					// the result from the constraint.
+					b2ContactConstraintPoint* ccp = cc->points + k;
+					cr.normalImpulse = ccp->normalImpulse;
+					cr.tangentImpulse = ccp->tangentImpulse;
+				}
+				else
+				{
+					cr.normalImpulse = point->normalImpulse;
+					cr.tangentImpulse = point->tangentImpulse;
+				}
 				cr.id = point->id;
 
 				m_listener->Result(&cr);
 			}
+
+			if (cc)
+			{
+				++cc;
+			}
 		}
 	}
 }
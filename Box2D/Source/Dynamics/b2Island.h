@@ -47,11 +47,7 @@ public:
 
 	void SolveTOI(const b2TimeStep& subStep);
 
-	void Add(b2Body* body)
-	{
-		b2Assert(m_bodyCount < m_bodyCapacity);
-		m_bodies[m_bodyCount++] = body;
-	}
+	void Add(b2Body* body);
 
 	void Add(b2Contact* contact)
 	{
@@ -65,6 +61,8 @@ public:
 		m_joints[m_jointCount++] = joint;
 	}
 
+	/// Report the solved contacts to the listener. Pass NULL to report
+	/// the impulses stored in the manifolds after Solve.
 	void Report(b2ContactConstraint* constraints);
 
 	b2StackAllocator* m_allocator;
@@ -0,0 +1,472 @@
+/*
+* Copyright (c) 2006-2007 Erin Catto http://www.gphysics.com
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "b2IslandManager.h"
+#include "b2World.h"
+#include "b2Body.h"
+#include "Contacts/b2Contact.h"
+#include "Joints/b2Joint.h"
+#include "../Collision/Shapes/b2Shape.h"
+
+void b2IslandManager::AddBody(b2Body* body)
+{
+	b2Assert(body->m_island == NULL && body->IsStatic() == false);
+
+	b2PersistentIsland* island = Create(body->IsSleeping() == false);
+	Add(island, body);
+}
+
+void b2IslandManager::RemoveBody(b2Body* body)
+{
+	b2PersistentIsland* island = body->m_island;
+	if (island == NULL)
+	{
+		return;
+	}
+
+	for (b2JointEdge* jn = body->m_jointList; jn; jn = jn->next)
+	{
+		UnlinkJoint(jn->joint);
+	}
+
+	for (b2ContactEdge* cn = body->m_contactList; cn; cn = cn->next)
+	{
+		if (cn->contact->m_island)
+		{
+			UnlinkContact(cn->contact);
+		}
+	}
+
+	if (body->m_islandPrev)
+	{
+		body->m_islandPrev->m_islandNext = body->m_islandNext;
+	}
+
+	if (body->m_islandNext)
+	{
+		body->m_islandNext->m_islandPrev = body->m_islandPrev;
+	}
+
+	if (body == island->bodyList)
+	{
+		island->bodyList = body->m_islandNext;
+	}
+
+	body->m_island = NULL;
+	body->m_islandPrev = NULL;
+	body->m_islandNext = NULL;
+	--island->bodyCount;
+
+	if (island->bodyCount == 0)
+	{
+		b2Assert(island->contactCount == 0 && island->jointCount == 0);
+		Destroy(island);
+	}
+	else
+	{
+		// The body may have been the only link between the others.
+		++island->removeCount;
+	}
+}
+
+void b2IslandManager::UpdateBody(b2Body* body)
+{
+	bool dynamic = body->IsStatic() == false;
+	if (dynamic == (body->m_island != NULL))
+	{
+		return;
+	}
+
+	// Joints attach to the islands of their dynamic bodies.
+	for (b2JointEdge* jn = body->m_jointList; jn; jn = jn->next)
+	{
+		UnlinkJoint(jn->joint);
+	}
+
+	if (dynamic)
+	{
+		AddBody(body);
+	}
+	else
+	{
+		RemoveBody(body);
+	}
+
+	for (b2JointEdge* jn = body->m_jointList; jn; jn = jn->next)
+	{
+		LinkJoint(jn->joint);
+	}
+}
+
+void b2IslandManager::LinkContact(b2Contact* c)
+{
+	b2Assert(c->m_island == NULL);
+
+	b2PersistentIsland* island1 = c->GetShape1()->GetBody()->m_island;
+	b2PersistentIsland* island2 = c->GetShape2()->GetBody()->m_island;
+	if (island1 == NULL && island2 == NULL)
+	{
+		return;
+	}
+
+	b2PersistentIsland* island = island1 ? island1 : island2;
+	if (island1 && island2 && island1 != island2)
+	{
+		island = Merge(island1, island2);
+	}
+
+	Add(island, c);
+}
+
+void b2IslandManager::UnlinkContact(b2Contact* c)
+{
+	b2PersistentIsland* island = c->m_island;
+	b2Assert(island != NULL);
+
+	if (c->m_islandPrev)
+	{
+		c->m_islandPrev->m_islandNext = c->m_islandNext;
+	}
+
+	if (c->m_islandNext)
+	{
+		c->m_islandNext->m_islandPrev = c->m_islandPrev;
+	}
+
+	if (c == island->contactList)
+	{
+		island->contactList = c->m_islandNext;
+	}
+
+	c->m_island = NULL;
+	c->m_islandPrev = NULL;
+	c->m_islandNext = NULL;
+	--island->contactCount;
+
+	// Constraints with a static body never connect two dynamic bodies.
+	if (c->GetShape1()->GetBody()->m_island && c->GetShape2()->GetBody()->m_island)
+	{
+		++island->removeCount;
+	}
+}
+
+void b2IslandManager::LinkJoint(b2Joint* j)
+{
+	b2Assert(j->m_island == NULL);
+
+	b2PersistentIsland* island1 = j->m_body1->m_island;
+	b2PersistentIsland* island2 = j->m_body2->m_island;
+	if (island1 == NULL && island2 == NULL)
+	{
+		return;
+	}
+
+	b2PersistentIsland* island = island1 ? island1 : island2;
+	if (island1 && island2 && island1 != island2)
+	{
+		island = Merge(island1, island2);
+	}
+
+	Add(island, j);
+}
+
+void b2IslandManager::UnlinkJoint(b2Joint* j)
+{
+	b2PersistentIsland* island = j->m_island;
+	if (island == NULL)
+	{
+		return;
+	}
+
+	if (j->m_islandPrev)
+	{
+		j->m_islandPrev->m_islandNext = j->m_islandNext;
+	}
+
+	if (j->m_islandNext)
+	{
+		j->m_islandNext->m_islandPrev = j->m_islandPrev;
+	}
+
+	if (j == island->jointList)
+	{
+		island->jointList = j->m_islandNext;
+	}
+
+	j->m_island = NULL;
+	j->m_islandPrev = NULL;
+	j->m_islandNext = NULL;
+	--island->jointCount;
+
+	if (j->m_body1->m_island && j->m_body2->m_island)
+	{
+		++island->removeCount;
+	}
+}
+
+void b2IslandManager::Wake(b2PersistentIsland* island)
+{
+	if (island->awake == false)
+	{
+		Remove(island);
+		island->awake = true;
+		Insert(island);
+	}
+}
+
+void b2IslandManager::Sleep(b2PersistentIsland* island)
+{
+	if (island->awake == true)
+	{
+		Remove(island);
+		island->awake = false;
+		Insert(island);
+	}
+}
+
+// Find the connected components with a depth first search (DFS) on the
+// island's constraints. Bodies, contacts and joints still labelled with
+// the old island have not been visited yet.
+void b2IslandManager::Split(b2PersistentIsland* island)
+{
+	b2StackAllocator* allocator = &m_world->m_stackAllocator;
+
+	int32 bodyCount = island->bodyCount;
+	b2Body** bodies = (b2Body**)allocator->Allocate(2 * bodyCount * sizeof(b2Body*));
+	b2Body** stack = bodies + bodyCount;
+
+	int32 i = 0;
+	for (b2Body* b = island->bodyList; b; b = b->m_islandNext)
+	{
+		bodies[i++] = b;
+	}
+	b2Assert(i == bodyCount);
+
+	for (i = 0; i < bodyCount; ++i)
+	{
+		b2Body* seed = bodies[i];
+		if (seed->m_island != island)
+		{
+			continue;
+		}
+
+		b2PersistentIsland* part = Create(island->awake);
+
+		int32 stackCount = 0;
+		stack[stackCount++] = seed;
+		Add(part, seed);
+
+		while (stackCount > 0)
+		{
+			b2Body* b = stack[--stackCount];
+
+			for (b2ContactEdge* cn = b->m_contactList; cn; cn = cn->next)
+			{
+				if (cn->contact->m_island != island)
+				{
+					continue;
+				}
+
+				Add(part, cn->contact);
+
+				// Static bodies have no island and are never visited.
+				b2Body* other = cn->other;
+				if (other->m_island != island)
+				{
+					continue;
+				}
+
+				b2Assert(stackCount < bodyCount);
+				stack[stackCount++] = other;
+				Add(part, other);
+			}
+
+			for (b2JointEdge* jn = b->m_jointList; jn; jn = jn->next)
+			{
+				if (jn->joint->m_island != island)
+				{
+					continue;
+				}
+
+				Add(part, jn->joint);
+
+				b2Body* other = jn->other;
+				if (other->m_island != island)
+				{
+					continue;
+				}
+
+				b2Assert(stackCount < bodyCount);
+				stack[stackCount++] = other;
+				Add(part, other);
+			}
+		}
+	}
+
+	allocator->Free(bodies);
+	Destroy(island);
+}
+
+b2PersistentIsland* b2IslandManager::Create(bool awake)
+{
+	void* mem = m_world->m_blockAllocator.Allocate(sizeof(b2PersistentIsland));
+	b2PersistentIsland* island = (b2PersistentIsland*)mem;
+	island->bodyList = NULL;
+	island->contactList = NULL;
+	island->jointList = NULL;
+	island->bodyCount = 0;
+	island->contactCount = 0;
+	island->jointCount = 0;
+	island->removeCount = 0;
+	island->awake = awake;
+	Insert(island);
+	++m_islandCount;
+	return island;
+}
+
+void b2IslandManager::Destroy(b2PersistentIsland* island)
+{
+	Remove(island);
+	--m_islandCount;
+	m_world->m_blockAllocator.Free(island, sizeof(b2PersistentIsland));
+}
+
+b2PersistentIsland* b2IslandManager::Merge(b2PersistentIsland* island1, b2PersistentIsland* island2)
+{
+	// Relabel the smaller island.
+	if (island1->bodyCount < island2->bodyCount)
+	{
+		b2Swap(island1, island2);
+	}
+
+	b2Body* b = island2->bodyList;
+	while (b)
+	{
+		b2Body* next = b->m_islandNext;
+		Add(island1, b);
+		b = next;
+	}
+
+	b2Contact* c = island2->contactList;
+	while (c)
+	{
+		b2Contact* next = c->m_islandNext;
+		Add(island1, c);
+		c = next;
+	}
+
+	b2Joint* j = island2->jointList;
+	while (j)
+	{
+		b2Joint* next = j->m_islandNext;
+		Add(island1, j);
+		j = next;
+	}
+
+	island1->removeCount += island2->removeCount;
+	if (island2->awake)
+	{
+		Wake(island1);
+	}
+
+	Destroy(island2);
+	return island1;
+}
+
+void b2IslandManager::Insert(b2PersistentIsland* island)
+{
+	b2PersistentIsland** list = island->awake ? &m_awakeList : &m_sleepingList;
+	island->prev = NULL;
+	island->next = *list;
+	if (*list)
+	{
+		(*list)->prev = island;
+	}
+	*list = island;
+
+	if (island->awake)
+	{
+		++m_awakeCount;
+	}
+}
+
+void b2IslandManager::Remove(b2PersistentIsland* island)
+{
+	if (island->prev)
+	{
+		island->prev->next = island->next;
+	}
+
+	if (island->next)
+	{
+		island->next->prev = island->prev;
+	}
+
+	if (island == m_awakeList)
+	{
+		m_awakeList = island->next;
+	}
+	else if (island == m_sleepingList)
+	{
+		m_sleepingList = island->next;
+	}
+
+	if (island->awake)
+	{
+		--m_awakeCount;
+	}
+}
+
+void b2IslandManager::Add(b2PersistentIsland* island, b2Body* body)
+{
+	body->m_island = island;
+	body->m_islandPrev = NULL;
+	body->m_islandNext = island->bodyList;
+	if (island->bodyList)
+	{
+		island->bodyList->m_islandPrev = body;
+	}
+	island->bodyList = body;
+	++island->bodyCount;
+}
+
+void b2IslandManager::Add(b2PersistentIsland* island, b2Contact* c)
+{
+	c->m_island = island;
+	c->m_islandPrev = NULL;
+	c->m_islandNext = island->contactList;
+	if (island->contactList)
+	{
+		island->contactList->m_islandPrev = c;
+	}
+	island->contactList = c;
+	++island->contactCount;
+}
+
+void b2IslandManager::Add(b2PersistentIsland* island, b2Joint* j)
+{
+	j->m_island = island;
+	j->m_islandPrev = NULL;
+	j->m_islandNext = island->jointList;
+	if (island->jointList)
+	{
+		island->jointList->m_islandPrev = j;
+	}
+	island->jointList = j;
+	++island->jointCount;
+}
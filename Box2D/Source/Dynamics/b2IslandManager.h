@@ -0,0 +1,104 @@
+/*
+* Copyright (c) 2006-2007 Erin Catto http://www.gphysics.com
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B2_ISLAND_MANAGER_H
+#define B2_ISLAND_MANAGER_H
+
+#include "../Common/b2Settings.h"
+
+class b2World;
+class b2Body;
+class b2Contact;
+class b2Joint;
+
+// A set of dynamic bodies connected by touching contacts and joints. Islands
+// persist across steps: new constraints merge islands right away, while
+// removed constraints only mark the island so it can be split lazily.
+struct b2PersistentIsland
+{
+	b2Body* bodyList;
+	b2Contact* contactList;
+	b2Joint* jointList;
+
+	int32 bodyCount;
+	int32 contactCount;
+	int32 jointCount;
+
+	// Constraints removed since the island was last split. If this is
+	// non-zero the island may really be several islands.
+	int32 removeCount;
+
+	bool awake;
+
+	// The world's awake or sleeping island list.
+	b2PersistentIsland* prev;
+	b2PersistentIsland* next;
+};
+
+// Delegate of b2World. Static bodies never belong to an island, so
+// constraints with a static body only attach to the other body's island.
+class b2IslandManager
+{
+public:
+	b2IslandManager() : m_world(NULL), m_awakeList(NULL), m_sleepingList(NULL), m_awakeCount(0), m_islandCount(0) {}
+
+	// Give a dynamic body its own island, or take it out of its island.
+	void AddBody(b2Body* body);
+	void RemoveBody(b2Body* body);
+
+	// Move a body in or out of the islands after its type changed.
+	void UpdateBody(b2Body* body);
+
+	// Contacts belong to an island while they are touching and solid.
+	void LinkContact(b2Contact* c);
+	void UnlinkContact(b2Contact* c);
+
+	void LinkJoint(b2Joint* j);
+	void UnlinkJoint(b2Joint* j);
+
+	// Move an island between the awake and the sleeping list.
+	void Wake(b2PersistentIsland* island);
+	void Sleep(b2PersistentIsland* island);
+
+	// Rebuild the connected components of an island with removed
+	// constraints. The island is destroyed.
+	void Split(b2PersistentIsland* island);
+
+	b2World* m_world;
+
+	b2PersistentIsland* m_awakeList;
+	b2PersistentIsland* m_sleepingList;
+	int32 m_awakeCount;
+	int32 m_islandCount;
+
+private:
+	b2PersistentIsland* Create(bool awake);
+	void Destroy(b2PersistentIsland* island);
+
+	// Move the smaller island into the larger one and return the result.
+	b2PersistentIsland* Merge(b2PersistentIsland* island1, b2PersistentIsland* island2);
+
+	void Insert(b2PersistentIsland* island);
+	void Remove(b2PersistentIsland* island);
+
+	void Add(b2PersistentIsland* island, b2Body* body);
+	void Add(b2PersistentIsland* island, b2Contact* c);
+	void Add(b2PersistentIsland* island, b2Joint* j);
+};
+
+#endif
@@ -19,13 +19,16 @@
 #include "b2World.h"
 #include "b2Body.h"
 #include "b2Island.h"
+#include "b2WorldState.h"
 #include "Joints/b2PulleyJoint.h"
 #include "Contacts/b2Contact.h"
 #include "Contacts/b2ContactSolver.h"
 #include "../Collision/b2Collision.h"
 #include "../Collision/Shapes/b2CircleShape.h"
 #include "../Collision/Shapes/b2PolygonShape.h"
+#include "../Collision/Shapes/b2ChainShape.h"
 #include <new>
+#include <string.h>
 
 b2World::b2World(const b2AABB& worldAABB, const b2Vec2& gravity, bool doSleep)
 {
@@ -35,17 +38,27 @@ b2World::b2World(const b2AABB& worldAABB, const b2Vec2& gravity, bool doSleep)
 	m_contactListener = NULL;
 	m_debugDraw = NULL;
 
+	m_workerPool = NULL;
+	m_workerAllocators = NULL;
+	m_workerCount = 0;
+
 	m_bodyList = NULL;
 	m_contactList = NULL;
+	m_awakeContactList = NULL;
 	m_jointList = NULL;
 
 	m_bodyCount = 0;
 	m_contactCount = 0;
+	m_awakeContactCount = 0;
 	m_jointCount = 0;
 
+	m_profiling = false;
+	memset(&m_profile, 0, sizeof(b2Profile));
+
 	m_positionCorrection = true;
 	m_warmStarting = true;
 	m_continuousPhysics = true;
+	m_contactSolver = e_scalarContactSolver;
 
 	m_allowSleep = doSleep;
 	m_gravity = gravity;
@@ -54,7 +67,12 @@ b2World::b2World(const b2AABB& worldAABB, const b2Vec2& gravity, bool doSleep)
 
 	m_inv_dt0 = 0.0f;
 
+	// Fill in the shared contact registers here rather than lazily from
+	// a step, which may be running on a worker thread.
+	b2Contact::InitializeRegisters();
+
 	m_contactManager.m_world = this;
+	m_islandManager.m_world = this;
 	void* mem = b2Alloc(sizeof(b2BroadPhase));
 	m_broadPhase = new (mem) b2BroadPhase(worldAABB, &m_contactManager);
 
@@ -64,9 +82,405 @@ b2World::b2World(const b2AABB& worldAABB, const b2Vec2& gravity, bool doSleep)
 
 b2World::~b2World()
 {
-	DestroyBody(m_groundBody);
+	DestroyContactsAndShapes();
+
 	m_broadPhase->~b2BroadPhase();
 	b2Free(m_broadPhase);
+
+	SetWorkerPool(NULL);
+}
+
+void b2World::Reset()
+{
+	b2Assert(m_lock == false);
+
+	DestroyContactsAndShapes();
+
+	b2AABB worldAABB = m_broadPhase->m_worldAABB;
+	m_broadPhase->~b2BroadPhase();
+	new (m_broadPhase) b2BroadPhase(worldAABB, &m_contactManager);
+
+	// Bodies, joints and islands hold no heap memory.
+	m_blockAllocator.Reset();
+
+	m_bodyList = NULL;
+	m_contactList = NULL;
+	m_awakeContactList = NULL;
+	m_jointList = NULL;
+
+	m_bodyCount = 0;
+	m_contactCount = 0;
+	m_awakeContactCount = 0;
+	m_jointCount = 0;
+
+	m_islandManager.m_awakeList = NULL;
+	m_islandManager.m_sleepingList = NULL;
+	m_islandManager.m_awakeCount = 0;
+	m_islandManager.m_islandCount = 0;
+
+	m_inv_dt0 = 0.0f;
+
+	b2BodyDef bd;
+	m_groundBody = CreateBody(&bd);
+}
+
+void b2World::GetMemoryStats(b2MemoryStats* stats) const
+{
+	stats->blockAllocation = m_blockAllocator.GetAllocation();
+	stats->maxBlockAllocation = m_blockAllocator.GetMaxAllocation();
+	stats->chunkCount = m_blockAllocator.GetChunkCount();
+
+	stats->stackCapacity = m_stackAllocator.GetCapacity();
+	stats->maxStackAllocation = m_stackAllocator.GetMaxAllocation();
+	stats->stackFallbackCount = m_stackAllocator.GetFallbackCount();
+
+	for (int32 i = 0; i < m_workerCount; ++i)
+	{
+		const b2StackAllocator* allocator = m_workerAllocators + i;
+		stats->stackCapacity += allocator->GetCapacity();
+		stats->maxStackAllocation = b2Max(stats->maxStackAllocation, allocator->GetMaxAllocation());
+		stats->stackFallbackCount += allocator->GetFallbackCount();
+	}
+}
+
+// Shapes are saved by their index in the body's shape list.
+static int32 b2GetShapeIndex(b2Shape* shape)
+{
+	int32 index = 0;
+	for (b2Shape* s = shape->GetBody()->GetShapeList(); s != shape; s = s->GetNext())
+	{
+		++index;
+	}
+	return index;
+}
+
+static b2Shape* b2GetShape(b2Body* body, int32 index)
+{
+	b2Shape* s = body->GetShapeList();
+	while (s && index > 0)
+	{
+		s = s->GetNext();
+		--index;
+	}
+	return s;
+}
+
+void b2World::SaveState(b2WorldState* state)
+{
+	b2Assert(m_lock == false);
+
+	int32 contactCount = 0;
+	int32 manifoldCount = 0;
+	for (b2Contact* c = m_contactList; c; c = c->m_next)
+	{
+		if (c->GetManifoldCount() > 0)
+		{
+			++contactCount;
+			manifoldCount += c->GetManifoldCount();
+		}
+	}
+
+	state->Reserve(m_bodyCount, m_jointCount, contactCount, manifoldCount);
+	state->m_inv_dt0 = m_inv_dt0;
+
+	// The island index is free between steps, so it numbers the bodies.
+	int32 i = 0;
+	for (b2Body* b = m_bodyList; b; b = b->m_next, ++i)
+	{
+		b->m_islandIndex = i;
+
+		b2BodyState* bs = state->m_bodies + i;
+		bs->xf = b->m_xf;
+		bs->sweep = b->m_sweep;
+		bs->linearVelocity = b->m_linearVelocity;
+		bs->angularVelocity = b->m_angularVelocity;
+		bs->force = b->m_force;
+		bs->torque = b->m_torque;
+		bs->sleepTime = b->m_sleepTime;
+		bs->sleeping = b->IsSleeping();
+		bs->frozen = b->IsFrozen();
+	}
+
+	i = 0;
+	for (b2Joint* j = m_jointList; j; j = j->m_next, ++i)
+	{
+		b2JointState* js = state->m_joints + i;
+		js->inv_dt = j->m_inv_dt;
+		int32 valueCount = j->SaveState(js->values);
+		b2Assert(valueCount <= b2_maxJointStateValues);
+		B2_NOT_USED(valueCount);
+	}
+
+	i = 0;
+	int32 manifoldStart = 0;
+	for (b2Contact* c = m_contactList; c; c = c->m_next)
+	{
+		int32 count = c->GetManifoldCount();
+		if (count == 0)
+		{
+			continue;
+		}
+
+		b2ContactState* cs = state->m_contacts + i++;
+		cs->body1 = c->m_shape1->GetBody()->m_islandIndex;
+		cs->shape1 = b2GetShapeIndex(c->m_shape1);
+		cs->body2 = c->m_shape2->GetBody()->m_islandIndex;
+		cs->shape2 = b2GetShapeIndex(c->m_shape2);
+		cs->manifoldStart = manifoldStart;
+		cs->manifoldCount = count;
+
+		memcpy(state->m_manifolds + manifoldStart, c->GetManifolds(), count * sizeof(b2Manifold));
+		const uint32* keys = c->GetManifoldKeys();
+		if (keys)
+		{
+			memcpy(state->m_keys + manifoldStart, keys, count * sizeof(uint32));
+		}
+		else
+		{
+			state->m_keys[manifoldStart] = 0;
+		}
+		manifoldStart += count;
+	}
+}
+
+bool b2World::RestoreState(const b2WorldState* state)
+{
+	b2Assert(m_lock == false);
+	if (m_lock == true)
+	{
+		return false;
+	}
+
+	if (state->m_bodyCount != m_bodyCount || state->m_jointCount != m_jointCount)
+	{
+		return false;
+	}
+
+	// A frozen body has no proxies left to put back.
+	int32 i = 0;
+	for (b2Body* b = m_bodyList; b; b = b->m_next, ++i)
+	{
+		if (b->IsFrozen() && state->m_bodies[i].frozen == false)
+		{
+			return false;
+		}
+	}
+
+	// Drop the current contact points silently. Contacts destroyed by the
+	// commit below then issue no callbacks. The island links are kept, so
+	// contacts that still touch keep their place in the solver order.
+	for (b2Contact* c = m_contactList; c; c = c->m_next)
+	{
+		c->SetManifolds(NULL, NULL, 0);
+	}
+
+	b2Body** bodies = (b2Body**)m_stackAllocator.Allocate(m_bodyCount * sizeof(b2Body*));
+
+	i = 0;
+	for (b2Body* b = m_bodyList; b; b = b->m_next, ++i)
+	{
+		bodies[i] = b;
+
+		const b2BodyState* bs = state->m_bodies + i;
+		b->m_xf = bs->xf;
+		b->m_sweep = bs->sweep;
+		b->m_linearVelocity = bs->linearVelocity;
+		b->m_angularVelocity = bs->angularVelocity;
+		b->m_force = bs->force;
+		b->m_torque = bs->torque;
+		b->m_sleepTime = bs->sleepTime;
+
+		if (bs->sleeping)
+		{
+			b->m_flags |= b2Body::e_sleepFlag;
+		}
+		else
+		{
+			b->m_flags &= ~b2Body::e_sleepFlag;
+		}
+
+		if (b->IsFrozen())
+		{
+			continue;
+		}
+
+		if (bs->frozen)
+		{
+			b->m_flags |= b2Body::e_frozenFlag;
+			for (b2Shape* s = b->m_shapeList; s; s = s->m_next)
+			{
+				s->DestroyProxy(m_broadPhase);
+			}
+		}
+		else
+		{
+			b->SynchronizeShapes();
+		}
+	}
+
+	m_broadPhase->Commit();
+
+	// Put the contact points back. Contacts the broad-phase no longer
+	// reports are rebuilt by the next step.
+	for (i = 0; i < state->m_contactCount; ++i)
+	{
+		const b2ContactState* cs = state->m_contacts + i;
+		b2Shape* shape1 = b2GetShape(bodies[cs->body1], cs->shape1);
+		b2Shape* shape2 = b2GetShape(bodies[cs->body2], cs->shape2);
+
+		for (b2ContactEdge* ce = bodies[cs->body1]->m_contactList; ce; ce = ce->next)
+		{
+			b2Contact* c = ce->contact;
+			if (c->m_shape1 != shape1 || c->m_shape2 != shape2)
+			{
+				continue;
+			}
+
+			c->SetManifolds(state->m_manifolds + cs->manifoldStart, state->m_keys + cs->manifoldStart, cs->manifoldCount);
+			if (c->m_island == NULL && c->IsSolid())
+			{
+				m_islandManager.LinkContact(c);
+			}
+			break;
+		}
+	}
+
+	m_stackAllocator.Free(bodies);
+
+	for (b2Contact* c = m_contactList; c; c = c->m_next)
+	{
+		if (c->m_island && c->GetManifoldCount() == 0)
+		{
+			m_islandManager.UnlinkContact(c);
+		}
+	}
+
+	i = 0;
+	for (b2Joint* j = m_jointList; j; j = j->m_next, ++i)
+	{
+		const b2JointState* js = state->m_joints + i;
+		j->m_inv_dt = js->inv_dt;
+		j->RestoreState(js->values);
+	}
+
+	// Islands that lost contacts are only split if their bodies don't agree
+	// on sleeping, the others are split lazily as usual. Then the islands
+	// are sorted by the sleep state of their bodies.
+	int32 islandCount = m_islandManager.m_islandCount;
+	b2PersistentIsland** islands = (b2PersistentIsland**)m_stackAllocator.Allocate(islandCount * sizeof(b2PersistentIsland*));
+
+	int32 count = 0;
+	for (b2PersistentIsland* island = m_islandManager.m_awakeList; island; island = island->next)
+	{
+		islands[count++] = island;
+	}
+	for (b2PersistentIsland* island = m_islandManager.m_sleepingList; island; island = island->next)
+	{
+		islands[count++] = island;
+	}
+	b2Assert(count == islandCount);
+
+	for (i = 0; i < count; ++i)
+	{
+		b2PersistentIsland* island = islands[i];
+		if (island->removeCount == 0)
+		{
+			continue;
+		}
+
+		bool sleeping = island->bodyList->IsSleeping();
+		for (b2Body* b = island->bodyList; b; b = b->m_islandNext)
+		{
+			if (b->IsSleeping() != sleeping)
+			{
+				m_islandManager.Split(island);
+				break;
+			}
+		}
+	}
+
+	m_stackAllocator.Free(islands);
+
+	islandCount = m_islandManager.m_islandCount;
+	islands = (b2PersistentIsland**)m_stackAllocator.Allocate(islandCount * sizeof(b2PersistentIsland*));
+
+	count = 0;
+	for (b2PersistentIsland* island = m_islandManager.m_awakeList; island; island = island->next)
+	{
+		islands[count++] = island;
+	}
+	for (b2PersistentIsland* island = m_islandManager.m_sleepingList; island; island = island->next)
+	{
+		islands[count++] = island;
+	}
+
+	for (i = 0; i < count; ++i)
+	{
+		b2PersistentIsland* island = islands[i];
+		bool awake = false;
+		for (b2Body* b = island->bodyList; b && awake == false; b = b->m_islandNext)
+		{
+			awake = b->IsSleeping() == false;
+		}
+
+		if (awake)
+		{
+			m_islandManager.Wake(island);
+		}
+		else
+		{
+			m_islandManager.Sleep(island);
+		}
+	}
+
+	m_stackAllocator.Free(islands);
+
+	// The next step culls the contacts of sleeping bodies again.
+	for (b2Body* b = m_bodyList; b; b = b->m_next)
+	{
+		if (b->IsStatic() == false)
+		{
+			b->WakeContacts(false);
+		}
+	}
+
+	m_inv_dt0 = state->m_inv_dt0;
+
+	return true;
+}
+
+void b2World::DestroyContactsAndShapes()
+{
+	// Memory from the block allocator is released in bulk, but contacts
+	// and shapes may own heap memory (e.g. chains), so destroy them here.
+	// Destroying a touching contact wakes its bodies, which must not walk
+	// the contacts that are already gone.
+	for (b2Body* b = m_bodyList; b; b = b->m_next)
+	{
+		b->m_contactList = NULL;
+	}
+
+	b2Contact* c = m_contactList;
+	while (c)
+	{
+		b2Contact* c0 = c;
+		c = c->m_next;
+		b2Contact::Destroy(c0, &m_blockAllocator);
+	}
+
+	for (b2Body* b = m_bodyList; b; b = b->m_next)
+	{
+		b2Shape* s = b->m_shapeList;
+		while (s)
+		{
+			b2Shape* s0 = s;
+			s = s->m_next;
+
+			// The broad-phase is torn down as a whole.
+			s0->m_proxyId = b2_nullProxy;
+			b2Shape::Destroy(s0, &m_blockAllocator);
+		}
+	}
 }
 
 void b2World::SetDestructionListener(b2DestructionListener* listener)
@@ -94,6 +508,44 @@ void b2World::SetDebugDraw(b2DebugDraw* debugDraw)
 	m_debugDraw = debugDraw;
 }
 
+void b2World::SetWorkerPool(b2WorkerPool* pool)
+{
+	b2Assert(m_lock == false);
+
+	// Keep the worker allocators, they have grown to fit.
+	if (pool == m_workerPool)
+	{
+		return;
+	}
+
+	for (int32 i = 0; i < m_workerCount; ++i)
+	{
+		m_workerAllocators[i].~b2StackAllocator();
+	}
+	b2Free(m_workerAllocators);
+	m_workerAllocators = NULL;
+	m_workerCount = 0;
+
+	m_workerPool = pool;
+
+	// Each worker gets its own stack allocator for the island it is solving.
+	int32 workerCount = pool ? pool->GetWorkerCount() : 0;
+	if (workerCount > 1)
+	{
+		m_workerAllocators = (b2StackAllocator*)b2Alloc(workerCount * sizeof(b2StackAllocator));
+		for (int32 i = 0; i < workerCount; ++i)
+		{
+			new (m_workerAllocators + i) b2StackAllocator;
+		}
+		m_workerCount = workerCount;
+	}
+}
+
+void b2World::SetContactSolver(b2ContactSolverType type)
+{
+	m_contactSolver = b2ContactSolver::GetSupportedType(type);
+}
+
 b2Body* b2World::CreateBody(const b2BodyDef* def)
 {
 	b2Assert(m_lock == false);
@@ -115,6 +567,11 @@ b2Body* b2World::CreateBody(const b2BodyDef* def)
 	m_bodyList = b;
 	++m_bodyCount;
 
+	if (b->IsStatic() == false)
+	{
+		m_islandManager.AddBody(b);
+	}
+
 	return b;
 }
 
@@ -159,6 +616,8 @@ void b2World::DestroyBody(b2Body* b)
 		b2Shape::Destroy(s0, &m_blockAllocator);
 	}
 
+	m_islandManager.RemoveBody(b);
+
 	// Remove world body list.
 	if (b->m_prev)
 	{
@@ -211,6 +670,9 @@ b2Joint* b2World::CreateJoint(const b2JointDef* def)
 	if (j->m_body2->m_jointList) j->m_body2->m_jointList->prev = &j->m_node2;
 	j->m_body2->m_jointList = &j->m_node2;
 
+	// Connect to the island graph.
+	m_islandManager.LinkJoint(j);
+
 	// If the joint prevents collisions, then reset collision filtering.
 	if (def->collideConnected == false)
 	{
@@ -248,6 +710,8 @@ void b2World::DestroyJoint(b2Joint* j)
 	}
 
 	// Disconnect from island graph.
+	m_islandManager.UnlinkJoint(j);
+
 	b2Body* body1 = j->m_body1;
 	b2Body* body2 = j->m_body2;
 
@@ -315,136 +779,134 @@ void b2World::Refilter(b2Shape* shape)
 	shape->RefilterProxy(m_broadPhase, shape->GetBody()->GetXForm());
 }
 
-// Find islands, integrate and solve constraints, solve position constraints
-void b2World::Solve(const b2TimeStep& step)
+// Collect the awake islands with a body to simulate. Islands whose bodies
+// were all put to sleep move to the sleeping list.
+int32 b2World::CollectIslands(b2PersistentIsland** islands)
 {
-	m_positionIterationCount = 0;
-
-	// Size the island for the worst case.
-	b2Island island(m_bodyCount, m_contactCount, m_jointCount, &m_stackAllocator, m_contactListener);
-
-	// Clear all the island flags.
-	for (b2Body* b = m_bodyList; b; b = b->m_next)
-	{
-		b->m_flags &= ~b2Body::e_islandFlag;
-	}
-	for (b2Contact* c = m_contactList; c; c = c->m_next)
-	{
-		c->m_flags &= ~b2Contact::e_islandFlag;
-	}
-	for (b2Joint* j = m_jointList; j; j = j->m_next)
+	int32 islandCount = 0;
+	b2PersistentIsland* island = m_islandManager.m_awakeList;
+	while (island)
 	{
-		j->m_islandFlag = false;
-	}
+		b2PersistentIsland* next = island->next;
 
-	// Build and simulate all awake islands.
-	int32 stackSize = m_bodyCount;
-	b2Body** stack = (b2Body**)m_stackAllocator.Allocate(stackSize * sizeof(b2Body*));
-	for (b2Body* seed = m_bodyList; seed; seed = seed->m_next)
-	{
-		if (seed->m_flags & (b2Body::e_islandFlag | b2Body::e_sleepFlag | b2Body::e_frozenFlag))
+		bool awake = false;
+		bool active = false;
+		for (b2Body* b = island->bodyList; b; b = b->m_islandNext)
 		{
-			continue;
+			if ((b->m_flags & b2Body::e_sleepFlag) == 0)
+			{
+				awake = true;
+				if ((b->m_flags & b2Body::e_frozenFlag) == 0)
+				{
+					active = true;
+					break;
+				}
+			}
 		}
 
-		if (seed->IsStatic())
+		if (awake == false)
 		{
-			continue;
+			m_islandManager.Sleep(island);
 		}
-
-		// Reset island and stack.
-		island.Clear();
-		int32 stackCount = 0;
-		stack[stackCount++] = seed;
-		seed->m_flags |= b2Body::e_islandFlag;
-
-		// Perform a depth first search (DFS) on the constraint graph.
-		while (stackCount > 0)
+		else if (active)
 		{
-			// Grab the next body off the stack and add it to the island.
-			b2Body* b = stack[--stackCount];
-			island.Add(b);
-
-			// Make sure the body is awake.
-			b->m_flags &= ~b2Body::e_sleepFlag;
-
-			// To keep islands as small as possible, we don't
-			// propagate islands across static bodies.
-			if (b->IsStatic())
-			{
-				continue;
-			}
+			islands[islandCount++] = island;
+		}
 
-			// Search all contacts connected to this body.
-			for (b2ContactEdge* cn = b->m_contactList; cn; cn = cn->next)
-			{
-				// Has this contact already been added to an island?
-				if (cn->contact->m_flags & (b2Contact::e_islandFlag | b2Contact::e_nonSolidFlag))
-				{
-					continue;
-				}
+		island = next;
+	}
 
-				// Is this contact touching?
-				if (cn->contact->GetManifoldCount() == 0)
-				{
-					continue;
-				}
+	return islandCount;
+}
 
-				island.Add(cn->contact);
-				cn->contact->m_flags |= b2Contact::e_islandFlag;
+// Append a persistent island to the solver island.
+void b2World::AddIsland(b2PersistentIsland* island, b2Island* solverIsland)
+{
+	for (b2Body* b = island->bodyList; b; b = b->m_islandNext)
+	{
+		// Make sure the body is awake.
+		b->Awaken();
+		solverIsland->Add(b);
+	}
 
-				b2Body* other = cn->other;
+	for (b2Contact* c = island->contactList; c; c = c->m_islandNext)
+	{
+		solverIsland->Add(c);
+	}
 
-				// Was the other body already added to this island?
-				if (other->m_flags & b2Body::e_islandFlag)
-				{
-					continue;
-				}
+	for (b2Joint* j = island->jointList; j; j = j->m_islandNext)
+	{
+		solverIsland->Add(j);
+	}
+}
 
-				b2Assert(stackCount < stackSize);
-				stack[stackCount++] = other;
-				other->m_flags |= b2Body::e_islandFlag;
-			}
+// The solver puts a whole island to sleep at once. Islands that lost
+// constraints are split once they, or a part of them, come to rest.
+void b2World::FinishIsland(b2PersistentIsland* island)
+{
+	bool sleeping = island->bodyList->IsSleeping();
+	if (sleeping)
+	{
+		m_islandManager.Sleep(island);
+	}
 
-			// Search all joints connect to this body.
-			for (b2JointEdge* jn = b->m_jointList; jn; jn = jn->next)
-			{
-				if (jn->joint->m_islandFlag == true)
-				{
-					continue;
-				}
+	if (island->removeCount == 0)
+	{
+		return;
+	}
 
-				island.Add(jn->joint);
-				jn->joint->m_islandFlag = true;
+	bool split = sleeping;
+	for (b2Body* b = island->bodyList; b && split == false; b = b->m_islandNext)
+	{
+		split = b->m_sleepTime >= b2_timeToSleep;
+	}
 
-				b2Body* other = jn->other;
-				if (other->m_flags & b2Body::e_islandFlag)
-				{
-					continue;
-				}
+	if (split)
+	{
+		m_islandManager.Split(island);
+	}
+}
 
-				b2Assert(stackCount < stackSize);
-				stack[stackCount++] = other;
-				other->m_flags |= b2Body::e_islandFlag;
-			}
-		}
+// Integrate and solve constraints of the awake islands. The islands are
+// kept up to date as contacts and joints come and go.
+void b2World::Solve(const b2TimeStep& step)
+{
+	m_positionIterationCount = 0;
 
-		island.Solve(step, m_gravity, m_positionCorrection, m_allowSleep);
-		m_positionIterationCount = b2Max(m_positionIterationCount, island.m_positionIterationCount);
+	// Islands fall asleep and split as they are solved, so work on a copy.
+	b2PersistentIsland** islands = (b2PersistentIsland**)m_stackAllocator.Allocate(m_islandManager.m_awakeCount * sizeof(b2PersistentIsland*));
+	int32 islandCount = CollectIslands(islands);
+	m_profile.islandsSolved = islandCount;
 
-		// Post solve cleanup.
-		for (int32 i = 0; i < island.m_bodyCount; ++i)
+	if (m_workerCount > 1)
+	{
+		SolveParallel(step, islands, islandCount);
+	}
+	else
+	{
+		for (int32 i = 0; i < islandCount; ++i)
 		{
-			// Allow static bodies to participate in other islands.
-			b2Body* b = island.m_bodies[i];
-			if (b->IsStatic())
+			b2PersistentIsland* pi = islands[i];
+
 			{
-				b->m_flags &= ~b2Body::e_islandFlag;
+				b2Island island(pi->bodyCount, pi->contactCount, pi->jointCount, &m_stackAllocator, m_contactListener);
+				AddIsland(pi, &island);
+
+				island.Solve(step, m_gravity, m_positionCorrection, m_allowSleep);
+				m_positionIterationCount = b2Max(m_positionIterationCount, island.m_positionIterationCount);
 			}
+
+			FinishIsland(pi);
 		}
 	}
 
-	m_stackAllocator.Free(stack);
+	m_stackAllocator.Free(islands);
+
+	b2Timer timer;
+	if (m_profiling)
+	{
+		timer.Reset();
+	}
 
 	// Synchronize shapes, check for out of range bodies.
 	for (b2Body* b = m_bodyList; b; b = b->GetNext())
@@ -474,6 +936,140 @@ void b2World::Solve(const b2TimeStep& step)
 	// Commit shape proxy movements to the broad-phase so that new contacts are created.
 	// Also, some contacts can be destroyed.
 	m_broadPhase->Commit();
+
+	if (m_profiling)
+	{
+		m_profile.broadphase = timer.GetMilliseconds();
+	}
+}
+
+// The islands of one step, stored back to back in a single b2Island.
+// Island i owns the ranges [bodyStarts[i], bodyStarts[i + 1]) and so on.
+struct b2IslandBatch
+{
+	b2Island* islands;
+	int32* bodyStarts;
+	int32* contactStarts;
+	int32* jointStarts;
+	int32* positionIterationCounts;
+
+	const b2TimeStep* step;
+	b2Vec2 gravity;
+	bool correctPositions;
+	bool allowSleep;
+
+	b2StackAllocator* allocators;
+};
+
+static void b2SolveIslandTask(void* context, int32 index, int32 worker)
+{
+	b2IslandBatch* batch = (b2IslandBatch*)context;
+	b2Island* islands = batch->islands;
+
+	int32 bodyStart = batch->bodyStarts[index];
+	int32 bodyEnd = batch->bodyStarts[index + 1];
+	int32 contactStart = batch->contactStarts[index];
+	int32 contactEnd = batch->contactStarts[index + 1];
+	int32 jointStart = batch->jointStarts[index];
+	int32 jointEnd = batch->jointStarts[index + 1];
+
+	// Listener reports are deferred to the calling thread.
+	b2Island island(bodyEnd - bodyStart, contactEnd - contactStart, jointEnd - jointStart,
+					batch->allocators + worker, NULL);
+
+	for (int32 i = bodyStart; i < bodyEnd; ++i)
+	{
+		island.Add(islands->m_bodies[i]);
+	}
+	for (int32 i = contactStart; i < contactEnd; ++i)
+	{
+		island.Add(islands->m_contacts[i]);
+	}
+	for (int32 i = jointStart; i < jointEnd; ++i)
+	{
+		island.Add(islands->m_joints[i]);
+	}
+
+	island.Solve(*batch->step, batch->gravity, batch->correctPositions, batch->allowSleep);
+	batch->positionIterationCounts[index] = island.m_positionIterationCount;
+}
+
+// Gather the awake islands first, then solve them on the worker pool.
+void b2World::SolveParallel(const b2TimeStep& step, b2PersistentIsland** islandList, int32 islandCount)
+{
+	int32 bodyCount = 0;
+	int32 contactCount = 0;
+	int32 jointCount = 0;
+	for (int32 i = 0; i < islandCount; ++i)
+	{
+		bodyCount += islandList[i]->bodyCount;
+		contactCount += islandList[i]->contactCount;
+		jointCount += islandList[i]->jointCount;
+	}
+
+	b2Island islands(bodyCount, contactCount, jointCount, &m_stackAllocator, NULL);
+
+	int32 startCount = islandCount + 1;
+	int32* starts = (int32*)m_stackAllocator.Allocate(4 * startCount * sizeof(int32));
+
+	b2IslandBatch batch;
+	batch.islands = &islands;
+	batch.bodyStarts = starts;
+	batch.contactStarts = starts + startCount;
+	batch.jointStarts = starts + 2 * startCount;
+	batch.positionIterationCounts = starts + 3 * startCount;
+	batch.step = &step;
+	batch.gravity = m_gravity;
+	batch.correctPositions = m_positionCorrection;
+	batch.allowSleep = m_allowSleep;
+	batch.allocators = m_workerAllocators;
+
+	for (int32 i = 0; i < islandCount; ++i)
+	{
+		batch.bodyStarts[i] = islands.m_bodyCount;
+		batch.contactStarts[i] = islands.m_contactCount;
+		batch.jointStarts[i] = islands.m_jointCount;
+		AddIsland(islandList[i], &islands);
+	}
+
+	batch.bodyStarts[islandCount] = islands.m_bodyCount;
+	batch.contactStarts[islandCount] = islands.m_contactCount;
+	batch.jointStarts[islandCount] = islands.m_jointCount;
+
+	if (islandCount > 1)
+	{
+		m_workerPool->Run(b2SolveIslandTask, &batch, islandCount);
+	}
+	else if (islandCount == 1)
+	{
+		b2StackAllocator* allocators = batch.allocators;
+		batch.allocators = &m_stackAllocator;
+		b2SolveIslandTask(&batch, 0, 0);
+		batch.allocators = allocators;
+	}
+
+	// Merge the results in island order, as the single threaded path would.
+	if (m_contactListener)
+	{
+		b2Island reporter(0, contactCount, 0, &m_stackAllocator, m_contactListener);
+		for (int32 i = 0; i < islandCount; ++i)
+		{
+			reporter.Clear();
+			for (int32 j = batch.contactStarts[i]; j < batch.contactStarts[i + 1]; ++j)
+			{
+				reporter.Add(islands.m_contacts[j]);
+			}
+			reporter.Report(NULL);
+		}
+	}
+
+	for (int32 i = 0; i < islandCount; ++i)
+	{
+		m_positionIterationCount = b2Max(m_positionIterationCount, batch.positionIterationCounts[i]);
+		FinishIsland(islandList[i]);
+	}
+
+	m_stackAllocator.Free(starts);
 }
 
 // Find TOI contacts and solve them.
@@ -490,7 +1086,7 @@ void b2World::SolveTOI(const b2TimeStep& step)
 		b->m_sweep.t0 = 0.0f;
 	}
 
-	for (b2Contact* c = m_contactList; c; c = c->m_next)
+	for (b2Contact* c = m_awakeContactList; c; c = c->m_awakeNext)
 	{
 		// Invalidate TOI
 		c->m_flags &= ~(b2Contact::e_toiFlag | b2Contact::e_islandFlag);
@@ -503,7 +1099,7 @@ void b2World::SolveTOI(const b2TimeStep& step)
 		b2Contact* minContact = NULL;
 		float32 minTOI = 1.0f;
 
-		for (b2Contact* c = m_contactList; c; c = c->m_next)
+		for (b2Contact* c = m_awakeContactList; c; c = c->m_awakeNext)
 		{
 			if (c->m_flags & (b2Contact::e_slowFlag | b2Contact::e_nonSolidFlag))
 			{
@@ -616,7 +1212,7 @@ void b2World::SolveTOI(const b2TimeStep& step)
 			island.Add(b);
 
 			// Make sure the body is awake.
-			b->m_flags &= ~b2Body::e_sleepFlag;
+			b->Awaken();
 
 			// To keep islands as small as possible, we don't
 			// propagate islands across static bodies.
@@ -676,8 +1272,10 @@ void b2World::SolveTOI(const b2TimeStep& step)
 		b2Assert(subStep.dt > B2_FLT_EPSILON);
 		subStep.inv_dt = 1.0f / subStep.dt;
 		subStep.maxIterations = step.maxIterations;
+		subStep.contactSolver = e_scalarContactSolver;
 
 		island.SolveTOI(subStep);
+		++m_profile.toiEvents;
 
 		// Post solve cleanup.
 		for (int32 i = 0; i < island.m_bodyCount; ++i)
@@ -750,20 +1348,57 @@ void b2World::Step(float32 dt, int32 iterations)
 
 	step.positionCorrection = m_positionCorrection;
 	step.warmStarting = m_warmStarting;
-	
+	step.contactSolver = m_contactSolver;
+
+	memset(&m_profile, 0, sizeof(b2Profile));
+
+	b2Timer stepTimer;
+	b2Timer timer;
+	if (m_profiling)
+	{
+		stepTimer.Reset();
+		timer.Reset();
+	}
+
 	// Update contacts.
 	m_contactManager.Collide();
+	if (m_profiling)
+	{
+		m_profile.collide = timer.GetMilliseconds();
+	}
 
 	// Integrate velocities, solve velocity constraints, and integrate positions.
 	if (step.dt > 0.0f)
 	{
+		if (m_profiling)
+		{
+			timer.Reset();
+		}
 		Solve(step);
+		m_profile.positionIterations = m_positionIterationCount;
+		if (m_profiling)
+		{
+			m_profile.solve = timer.GetMilliseconds();
+		}
 	}
 
 	// Handle TOI events.
 	if (m_continuousPhysics && step.dt > 0.0f)
 	{
+		if (m_profiling)
+		{
+			timer.Reset();
+		}
 		SolveTOI(step);
+		if (m_profiling)
+		{
+			m_profile.solveTOI = timer.GetMilliseconds();
+		}
+	}
+
+	if (m_profiling)
+	{
+		m_profile.step = stepTimer.GetMilliseconds();
 	}
 
 	// Draw debug information.
@@ -838,6 +1473,36 @@ void b2World::DrawShape(b2Shape* shape, const b2XForm& xf, const b2Color& color,
 			}
 		}
 		break;
+
+	case e_chainShape:
+		{
+			b2ChainShape* chain = (b2ChainShape*)shape;
+			int32 segmentCount = chain->GetSegmentCount();
+			const b2ChainSegment* segments = chain->GetSegments();
+
+			for (int32 i = 0; i < segmentCount; ++i)
+			{
+				const b2ChainSegment* segment = segments + i;
+				b2Vec2 vertices[4];
+
+				for (int32 j = 0; j < 4; ++j)
+				{
+					vertices[j] = b2Mul(xf, segment->vertices[j]);
+				}
+
+				m_debugDraw->DrawSolidPolygon(vertices, 4, color);
+
+				if (core)
+				{
+					for (int32 j = 0; j < 4; ++j)
+					{
+						vertices[j] = b2Mul(xf, segment->coreVertices[j]);
+					}
+					m_debugDraw->DrawPolygon(vertices, 4, coreColor);
+				}
+			}
+		}
+		break;
 	}
 }
 
@@ -930,35 +1595,36 @@ void b2World::DrawDebugData()
 	if (flags & b2DebugDraw::e_pairBit)
 	{
 		b2BroadPhase* bp = m_broadPhase;
-		b2Vec2 invQ;
-		invQ.Set(1.0f / bp->m_quantizationFactor.x, 1.0f / bp->m_quantizationFactor.y);
+		const b2PairManager& pm = bp->m_pairManager;
 		b2Color color(0.9f, 0.9f, 0.3f);
 
-		for (int32 i = 0; i < b2_tableCapacity; ++i)
+		for (b2Body* b = m_bodyList; b; b = b->GetNext())
 		{
-			uint16 index = bp->m_pairManager.m_hashTable[i];
-			while (index != b2_nullPair)
+			for (b2Shape* s = b->GetShapeList(); s; s = s->GetNext())
 			{
-				b2Pair* pair = bp->m_pairManager.m_pairs + index;
-				b2Proxy* p1 = bp->m_proxyPool + pair->proxyId1;
-				b2Proxy* p2 = bp->m_proxyPool + pair->proxyId2;
-
-				b2AABB b1, b2;
-				b1.lowerBound.x = bp->m_worldAABB.lowerBound.x + invQ.x * bp->m_bounds[0][p1->lowerBounds[0]].value;
-				b1.lowerBound.y = bp->m_worldAABB.lowerBound.y + invQ.y * bp->m_bounds[1][p1->lowerBounds[1]].value;
-				b1.upperBound.x = bp->m_worldAABB.lowerBound.x + invQ.x * bp->m_bounds[0][p1->upperBounds[0]].value;
-				b1.upperBound.y = bp->m_worldAABB.lowerBound.y + invQ.y * bp->m_bounds[1][p1->upperBounds[1]].value;
-				b2.lowerBound.x = bp->m_worldAABB.lowerBound.x + invQ.x * bp->m_bounds[0][p2->lowerBounds[0]].value;
-				b2.lowerBound.y = bp->m_worldAABB.lowerBound.y + invQ.y * bp->m_bounds[1][p2->lowerBounds[1]].value;
-				b2.upperBound.x = bp->m_worldAABB.lowerBound.x + invQ.x * bp->m_bounds[0][p2->upperBounds[0]].value;
-				b2.upperBound.y = bp->m_worldAABB.lowerBound.y + invQ.y * bp->m_bounds[1][p2->upperBounds[1]].value;
-
-				b2Vec2 x1 = 0.5f * (b1.lowerBound + b1.upperBound);
-				b2Vec2 x2 = 0.5f * (b2.lowerBound + b2.upperBound);
-
-				m_debugDraw->DrawSegment(x1, x2, color);
-
-				index = pair->next;
+				int32 proxyId = s->m_proxyId;
+				if (proxyId == b2_nullProxy)
+				{
+					continue;
+				}
+
+				// Visit each pair once, from its lower proxy id.
+				for (int32 index = pm.GetFirstPair(proxyId); index != b2_nullPair; index = pm.GetNext(index, proxyId))
+				{
+					const b2Pair* pair = pm.GetPair(index);
+					if (pair->proxyId1 != proxyId)
+					{
+						continue;
+					}
+
+					const b2AABB& b1 = bp->m_tree.GetFatAABB(pair->proxyId1);
+					const b2AABB& b2 = bp->m_tree.GetFatAABB(pair->proxyId2);
+
+					b2Vec2 x1 = 0.5f * (b1.lowerBound + b1.upperBound);
+					b2Vec2 x2 = 0.5f * (b2.lowerBound + b2.upperBound);
+
+					m_debugDraw->DrawSegment(x1, x2, color);
+				}
 			}
 		}
 	}
@@ -969,30 +1635,26 @@ void b2World::DrawDebugData()
 		b2Vec2 worldLower = bp->m_worldAABB.lowerBound;
 		b2Vec2 worldUpper = bp->m_worldAABB.upperBound;
 
-		b2Vec2 invQ;
-		invQ.Set(1.0f / bp->m_quantizationFactor.x, 1.0f / bp->m_quantizationFactor.y);
 		b2Color color(0.9f, 0.3f, 0.9f);
-		for (int32 i = 0; i < b2_maxProxies; ++i)
+		for (b2Body* b = m_bodyList; b; b = b->GetNext())
 		{
-			b2Proxy* p = bp->m_proxyPool + i;
-			if (p->IsValid() == false)
+			for (b2Shape* s = b->GetShapeList(); s; s = s->GetNext())
 			{
-				continue;
-			}
+				if (s->m_proxyId == b2_nullProxy)
+				{
+					continue;
+				}
 
-			b2AABB b;
-			b.lowerBound.x = worldLower.x + invQ.x * bp->m_bounds[0][p->lowerBounds[0]].value;
-			b.lowerBound.y = worldLower.y + invQ.y * bp->m_bounds[1][p->lowerBounds[1]].value;
-			b.upperBound.x = worldLower.x + invQ.x * bp->m_bounds[0][p->upperBounds[0]].value;
-			b.upperBound.y = worldLower.y + invQ.y * bp->m_bounds[1][p->upperBounds[1]].value;
+				const b2AABB& aabb = bp->m_tree.GetFatAABB(s->m_proxyId);
 
-			b2Vec2 vs[4];
-			vs[0].Set(b.lowerBound.x, b.lowerBound.y);
-			vs[1].Set(b.upperBound.x, b.lowerBound.y);
-			vs[2].Set(b.upperBound.x, b.upperBound.y);
-			vs[3].Set(b.lowerBound.x, b.upperBound.y);
+				b2Vec2 vs[4];
+				vs[0].Set(aabb.lowerBound.x, aabb.lowerBound.y);
+				vs[1].Set(aabb.upperBound.x, aabb.lowerBound.y);
+				vs[2].Set(aabb.upperBound.x, aabb.upperBound.y);
+				vs[3].Set(aabb.lowerBound.x, aabb.upperBound.y);
 
-			m_debugDraw->DrawPolygon(vs, 4, color);
+				m_debugDraw->DrawPolygon(vs, 4, color);
+			}
 		}
 
 		b2Vec2 vs[4];
@@ -1055,10 +1717,10 @@ void b2World::Validate()
 
 int32 b2World::GetProxyCount() const
 {
-	return m_broadPhase->m_proxyCount;
+	return m_broadPhase->GetProxyCount();
 }
 
 int32 b2World::GetPairCount() const
 {
-	return m_broadPhase->m_pairManager.m_pairCount;
+	return m_broadPhase->m_pairManager.GetPairCount();
 }
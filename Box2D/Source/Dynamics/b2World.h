@@ -22,7 +22,9 @@
 #include "../Common/b2Math.h"
 #include "../Common/b2BlockAllocator.h"
 #include "../Common/b2StackAllocator.h"
+#include "../Common/b2Timer.h"
 #include "b2ContactManager.h"
+#include "b2IslandManager.h"
 #include "b2WorldCallbacks.h"
 
 struct b2AABB;
@@ -34,6 +36,49 @@ class b2Joint;
 class b2Shape;
 class b2Contact;
 class b2BroadPhase;
+class b2Island;
+class b2WorldState;
+
+/// Contact solver back ends. The SIMD back ends pack contacts into lanes
+/// and solve 4 (SSE2) or 8 (AVX2) at a time. They are only available in
+/// float builds on x86; elsewhere the scalar solver is used.
+enum b2ContactSolverType
+{
+	e_scalarContactSolver,
+	e_sse2ContactSolver,
+	e_avx2ContactSolver,
+	e_simdContactSolver,	///< the widest back end the CPU supports
+};
+
+/// Memory statistics of a world, see b2World::GetMemoryStats. The stack
+/// figures include the worker allocators.
+struct b2MemoryStats
+{
+	int32 blockAllocation;		///< bytes in small object blocks
+	int32 maxBlockAllocation;	///< peak of blockAllocation
+	int32 chunkCount;			///< chunks owned by the small object allocator
+	int32 stackCapacity;		///< bytes reserved for per step allocations
+	int32 maxStackAllocation;	///< peak per step allocation
+	int32 stackFallbackCount;	///< per step allocations that did not fit
+};
+
+/// Per phase timings and counters of the last b2World::Step. The timings
+/// are in milliseconds and are only taken when profiling is enabled, see
+/// b2World::SetProfiling; the counters are always kept.
+struct b2Profile
+{
+	float32 step;			///< the whole step
+	float32 collide;		///< narrow phase
+	float32 solve;			///< island solving, including broadphase
+	float32 broadphase;		///< shape synchronization and pair commit
+	float32 solveTOI;		///< continuous collision
+	int32 pairsAdded;		///< broad-phase pairs created
+	int32 pairsRemoved;		///< broad-phase pairs destroyed
+	int32 contactsUpdated;	///< contacts run through the narrow phase
+	int32 islandsSolved;	///< islands solved in the discrete phase
+	int32 toiEvents;		///< time of impact sub-steps
+	int32 positionIterations;	///< position iterations of the slowest island
+};
 
 struct b2TimeStep
 {
@@ -43,6 +88,7 @@ struct b2TimeStep
 	int32 maxIterations;
 	bool warmStarting;
 	bool positionCorrection;
+	b2ContactSolverType contactSolver;
 };
 
 /// The world class manages all physics entities, dynamic simulation,
@@ -52,7 +98,8 @@ class b2World
 {
 public:
 	/// Construct a world object.
-	/// @param worldAABB a bounding box that completely encompasses all your shapes.
+	/// @param worldAABB a bounding box that should encompass all your shapes. The
+	/// broad-phase itself is unbounded; bodies that leave this box are frozen.
 	/// @param gravity the world gravity vector.
 	/// @param doSleep improve performance by not simulating inactive bodies.
 	b2World(const b2AABB& worldAABB, const b2Vec2& gravity, bool doSleep);
@@ -60,6 +107,26 @@ public:
 	/// Destruct the world. All physics entities are destroyed and all heap memory is released.
 	~b2World();
 
+	/// Destroy all physics entities and create a new ground body. The memory
+	/// is kept for reuse, as are the listeners and the solver settings.
+	/// No destruction callbacks are issued.
+	/// @warning This function is locked during callbacks.
+	void Reset();
+
+	/// Save the simulation state: body motion and sleep state, joint
+	/// impulses and contact points. The bodies, shapes and joints
+	/// themselves are not saved.
+	/// @warning This function is locked during callbacks.
+	void SaveState(b2WorldState* state);
+
+	/// Restore a state saved from this world, or from a world built the
+	/// same way. The body and joint lists must match those at the time of
+	/// the save. No callbacks are issued.
+	/// @return false if the lists don't match or a frozen body would have
+	/// to thaw; the world is unchanged then.
+	/// @warning This function is locked during callbacks.
+	bool RestoreState(const b2WorldState* state);
+
 	/// Register a destruction listener.
 	void SetDestructionListener(b2DestructionListener* listener);
 
@@ -73,6 +140,12 @@ public:
 	/// Register a contact event listener
 	void SetContactListener(b2ContactListener* listener);
 
+	/// Register a worker pool to solve independent islands in parallel.
+	/// The results are identical to solving on the calling thread. Pass
+	/// NULL to go back to single threaded solving.
+	/// @warning the pool must outlive the world or be unregistered first.
+	void SetWorkerPool(b2WorkerPool* pool);
+
 	/// Register a routine for debug drawing. The debug draw functions are called
 	/// inside the b2World::Step method, so make sure your renderer is ready to
 	/// consume draw commands when you call Step().
@@ -139,6 +212,13 @@ public:
 	/// Enable/disable continuous physics. For testing.
 	void SetContinuousPhysics(bool flag) { m_continuousPhysics = flag; }
 
+	/// Choose the contact solver back end. Back ends the CPU does not
+	/// support fall back to the next narrower one.
+	void SetContactSolver(b2ContactSolverType type);
+
+	/// Get the contact solver back end in use.
+	b2ContactSolverType GetContactSolver() const { return m_contactSolver; }
+
 	/// Perform validation of internal data structures.
 	void Validate();
 
@@ -157,15 +237,37 @@ public:
 	/// Get the number of contacts (each may have 0 or more contact points).
 	int32 GetContactCount() const;
 
+	/// Get the memory statistics of the allocators.
+	void GetMemoryStats(b2MemoryStats* stats) const;
+
+	/// Enable/disable the phase timings of the profile. When disabled
+	/// no clocks are read.
+	void SetProfiling(bool flag) { m_profiling = flag; }
+
+	/// Get the profile of the last step.
+	const b2Profile& GetProfile() const { return m_profile; }
+
+	/// Get the number of awake contacts. These are the contacts the last
+	/// step visited; contacts between sleeping or static bodies are skipped.
+	int32 GetAwakeContactCount() const;
+
 	/// Change the global gravity vector.
 	void SetGravity(const b2Vec2& gravity);
 
 private:
 
 	friend class b2Body;
+	friend class b2Contact;
 	friend class b2ContactManager;
+	friend class b2IslandManager;
+
+	void DestroyContactsAndShapes();
 
 	void Solve(const b2TimeStep& step);
+	void SolveParallel(const b2TimeStep& step, b2PersistentIsland** islands, int32 islandCount);
+	int32 CollectIslands(b2PersistentIsland** islands);
+	void AddIsland(b2PersistentIsland* island, b2Island* solverIsland);
+	void FinishIsland(b2PersistentIsland* island);
 	void SolveTOI(const b2TimeStep& step);
 
 	void DrawJoint(b2Joint* joint);
@@ -179,15 +281,18 @@ private:
 
 	b2BroadPhase* m_broadPhase;
 	b2ContactManager m_contactManager;
+	b2IslandManager m_islandManager;
 
 	b2Body* m_bodyList;
 	b2Joint* m_jointList;
 
 	// Do not access
 	b2Contact* m_contactList;
+	b2Contact* m_awakeContactList;
 
 	int32 m_bodyCount;
 	int32 m_contactCount;
+	int32 m_awakeContactCount;
 	int32 m_jointCount;
 
 	b2Vec2 m_gravity;
@@ -201,10 +306,17 @@ private:
 	b2ContactListener* m_contactListener;
 	b2DebugDraw* m_debugDraw;
 
+	b2WorkerPool* m_workerPool;
+	b2StackAllocator* m_workerAllocators;
+	int32 m_workerCount;
+
 	float32 m_inv_dt0;
 
 	int32 m_positionIterationCount;
 
+	b2Profile m_profile;
+	bool m_profiling;
+
 	// This is for debugging the solver.
 	bool m_positionCorrection;
 
@@ -213,6 +325,8 @@ private:
 
 	// This is for debugging the solver.
 	bool m_continuousPhysics;
+
+	b2ContactSolverType m_contactSolver;
 };
 
 inline b2Body* b2World::GetGroundBody()
@@ -245,6 +359,11 @@ inline int32 b2World::GetContactCount() const
 	return m_contactCount;
 }
 
+inline int32 b2World::GetAwakeContactCount() const
+{
+	return m_awakeContactCount;
+}
+
 inline void b2World::SetGravity(const b2Vec2& gravity)
 {
 	m_gravity = gravity;
@@ -106,6 +106,26 @@ public:
 	virtual void Result(const b2ContactResult* point) { B2_NOT_USED(point); }
 };
 
+/// A task run by a b2WorkerPool. The worker index identifies the thread
+/// running the task and is in the range [0, GetWorkerCount()).
+typedef void b2WorkerTask(void* context, int32 index, int32 worker);
+
+/// Implement and register this class with a b2World to solve independent
+/// islands in parallel. The world only calls Run from inside Step.
+class b2WorkerPool
+{
+public:
+	virtual ~b2WorkerPool() {}
+
+	/// The number of threads that may run tasks at once, including the caller.
+	virtual int32 GetWorkerCount() const = 0;
+
+	/// Call task(context, i, worker) for every i in [0, count), possibly
+	/// in parallel, and return once all calls have finished. Two calls
+	/// running at the same time must not share a worker index.
+	virtual void Run(b2WorkerTask* task, void* context, int32 count) = 0;
+};
+
 /// Color for debug drawing. Each value has the range [0,1].
 struct b2Color
 {
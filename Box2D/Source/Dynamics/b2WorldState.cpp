@@ -0,0 +1,95 @@
+/*
+* Copyright (c) 2006-2007 Erin Catto http://www.gphysics.com
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "b2WorldState.h"
+
+template <typename T>
+static void b2Reserve(T*& data, int32& capacity, int32 count)
+{
+	if (count <= capacity)
+	{
+		return;
+	}
+
+	// The old contents are always overwritten, so don't copy them.
+	if (capacity > 0)
+	{
+		b2Free(data);
+	}
+	data = (T*)b2Alloc(count * sizeof(T));
+	capacity = count;
+}
+
+template <typename T>
+static void b2Release(T* data, int32 capacity)
+{
+	if (capacity > 0)
+	{
+		b2Free(data);
+	}
+}
+
+b2WorldState::b2WorldState()
+{
+	m_bodies = NULL;
+	m_joints = NULL;
+	m_contacts = NULL;
+	m_manifolds = NULL;
+	m_keys = NULL;
+
+	m_bodyCount = m_bodyCapacity = 0;
+	m_jointCount = m_jointCapacity = 0;
+	m_contactCount = m_contactCapacity = 0;
+	m_manifoldCount = m_manifoldCapacity = 0;
+
+	m_inv_dt0 = 0.0f;
+}
+
+b2WorldState::~b2WorldState()
+{
+	b2Release(m_bodies, m_bodyCapacity);
+	b2Release(m_joints, m_jointCapacity);
+	b2Release(m_contacts, m_contactCapacity);
+	b2Release(m_manifolds, m_manifoldCapacity);
+	b2Release(m_keys, m_manifoldCapacity);
+}
+
+void b2WorldState::Reserve(int32 bodyCount, int32 jointCount, int32 contactCount, int32 manifoldCount)
+{
+	b2Reserve(m_bodies, m_bodyCapacity, bodyCount);
+	b2Reserve(m_joints, m_jointCapacity, jointCount);
+	b2Reserve(m_contacts, m_contactCapacity, contactCount);
+
+	int32 keyCapacity = m_manifoldCapacity;
+	b2Reserve(m_manifolds, m_manifoldCapacity, manifoldCount);
+	b2Reserve(m_keys, keyCapacity, manifoldCount);
+
+	m_bodyCount = bodyCount;
+	m_jointCount = jointCount;
+	m_contactCount = contactCount;
+	m_manifoldCount = manifoldCount;
+}
+
+int32 b2WorldState::GetSize() const
+{
+	return sizeof(b2WorldState)
+		+ m_bodyCapacity * sizeof(b2BodyState)
+		+ m_jointCapacity * sizeof(b2JointState)
+		+ m_contactCapacity * sizeof(b2ContactState)
+		+ m_manifoldCapacity * (sizeof(b2Manifold) + sizeof(uint32));
+}
@@ -0,0 +1,90 @@
+/*
+* Copyright (c) 2006-2007 Erin Catto http://www.gphysics.com
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B2_WORLD_STATE_H
+#define B2_WORLD_STATE_H
+
+#include "../Common/b2Math.h"
+#include "../Collision/b2Collision.h"
+
+/// The motion of a body at the time of a snapshot.
+struct b2BodyState
+{
+	b2XForm xf;
+	b2Sweep sweep;
+	b2Vec2 linearVelocity;
+	float32 angularVelocity;
+	b2Vec2 force;
+	float32 torque;
+	float32 sleepTime;
+	bool sleeping;
+	bool frozen;
+};
+
+/// The warm starting state of a joint.
+struct b2JointState
+{
+	float32 inv_dt;
+	float32 values[b2_maxJointStateValues];
+};
+
+/// The manifolds of a contact. Shapes are identified by the index of their
+/// body in the world's body list and their index in the body's shape list.
+struct b2ContactState
+{
+	int32 body1, shape1;
+	int32 body2, shape2;
+	int32 manifoldStart;
+	int32 manifoldCount;
+};
+
+/// A snapshot of the simulation state of a world: body motion and sleep
+/// state, joint impulses and contact manifolds, see b2World::SaveState.
+/// The buffers are kept between saves, so a state can be reused cheaply.
+class b2WorldState
+{
+public:
+	b2WorldState();
+	~b2WorldState();
+
+	/// Get the memory held by the state in bytes.
+	int32 GetSize() const;
+
+private:
+	friend class b2World;
+
+	b2WorldState(const b2WorldState&);
+	b2WorldState& operator=(const b2WorldState&);
+
+	void Reserve(int32 bodyCount, int32 jointCount, int32 contactCount, int32 manifoldCount);
+
+	b2BodyState* m_bodies;
+	b2JointState* m_joints;
+	b2ContactState* m_contacts;
+	b2Manifold* m_manifolds;
+	uint32* m_keys;
+
+	int32 m_bodyCount, m_bodyCapacity;
+	int32 m_jointCount, m_jointCapacity;
+	int32 m_contactCount, m_contactCapacity;
+	int32 m_manifoldCount, m_manifoldCapacity;
+
+	float32 m_inv_dt0;
+};
+
+#endif
@@ -19,6 +19,7 @@
 #include "Config.h"
 #include "Canvas.h"
 #include "Path.h"
+#include "Region.h"
 
 #include <SDL/SDL.h>
 #include <SDL/SDL_image.h>
@@ -753,6 +754,33 @@ void Window::update( const Rect& r )
   }
 }
 
+void Window::update( const Region& r )
+{
+  if ( r.size() == 1 ) {
+    update( r[0] );
+    return;
+  }
+  SDL_Rect rects[DIRTY_MAX_RECTS];
+  int n = 0;
+  for ( int i=0; i<r.size() && n<DIRTY_MAX_RECTS; i++ ) {
+    int x1 = Max( 0, r[i].tl.x );
+    int y1 = Max( 0, r[i].tl.y );
+    int x2 = Min( width()-1, r[i].br.x );
+    int y2 = Min( height()-1, r[i].br.y );
+    if ( x2 > x1 && y2 > y1 ) {
+      // clipped to the surface, so within SDL_Rect's 16 bit fields
+      SDL_Rect& s = rects[n++];
+      s.x = static_cast<Sint16>( x1 );
+      s.y = static_cast<Sint16>( y1 );
+      s.w = static_cast<Uint16>( x2-x1 );
+      s.h = static_cast<Uint16>( y2-y1 );
+    }
+  }
+  if ( n > 0 ) {
+    SDL_UpdateRects( SURFACE(this), n, rects );
+  }
+}
+
 void Window::raise()
 {
   SDL_SysWMinfo sys;
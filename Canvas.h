@@ -19,6 +19,7 @@
 
 #include "Common.h"
 class Path;
+class Region;
 
 class Canvas
 {
@@ -60,6 +61,7 @@ class Window : public Canvas
  public:
   Window( int w, int h, const char* title=NULL, const char* winclass=NULL, bool fullscreen=false );
   void update( const Rect& r );
+  void update( const Region& r );
   void raise();
   void setSubName( const char *sub );
  protected:
@@ -23,6 +23,12 @@ const Rect BOUNDS_RECT( -WORLD_WIDTH/4, -WORLD_HEIGHT,
 			WORLD_WIDTH*5/4, WORLD_HEIGHT );
 int SCREEN_WIDTH = WORLD_WIDTH;
 int SCREEN_HEIGHT = WORLD_HEIGHT;
+int SOLVER_THREADS = 1;
+int LEVEL_CACHE_BYTES = 1024*1024;
+bool SOLVER_SIMD = false;
+bool PROFILE_PHYSICS = false;
+bool DETERMINISTIC = false;
+bool PHYSICS_THREAD = false;
 
 const int brushColours[] = {
   0xb80000, //red
@@ -30,7 +30,8 @@
 #define GRAVITY_FUDGEf 5.0f
 #define CLOSED_SHAPE_THREHOLDf 0.4f
 #define SIMPLIFY_THRESHOLDf 1.0f //PIXELs //(1.0/PIXELS_PER_METREf)
-#define MULTI_VERTEX_LIMIT 64
+#define MULTI_VERTEX_LIMIT 128
+#define MERGE_TOLERANCEf 2.0f //PIXELs
 
 #define ITERATION_RATE    60 //fps
 #define SOLVER_ITERATIONS 8
@@ -53,6 +54,8 @@
 #endif
 
 #define ITERATION_TIMESTEPf  (1.0f / (float)ITERATION_RATE)
+// ticks run per frame to catch up before simulation time slips
+#define MAX_CATCHUP_TICKS    (ITERATION_RATE/MIN_RENDER_RATE)
 
 #define HIDE_STEPS (AVG_RENDER_RATE*4)
 
@@ -92,12 +95,37 @@
 #define VIDEO_FPS 20
 #define VIDEO_MAX_LEN 20  //seconds
 
+#define SIMULATE_MAX_LEN 120  //seconds
+
+#define LOAD_BENCH_REPEAT 100 //times -loadbench parses each level
+
+#define ZIP_CACHE_SIZE 4 //collections kept open and mapped
+#define ZIP_INFLATE_CHUNK (16*1024) //inflate buffer growth, bytes
+
+#define STATE_HASH_TICKS 30 //ticks between logged world state hashes
+
+#define REWIND_TICKS     60 //ticks between rewind snapshots
+#define REWIND_SNAPSHOTS 32 //snapshots kept for rewinding
+
+#define DIRTY_MERGE_FACTORf 1.5f //merge dirty rects whose union is at most
+                                 //this much bigger than the rects
+#define DIRTY_MAX_RECTS     16   //rects repainted separately per frame
+
+#define INDEX_CELL_SHIFT 5    //stroke index cells are 32 PIXELs square
+#define INDEX_BUCKETS    1024 //hash buckets of stroke index cells
+
 
 
 extern Rect FULLSCREEN_RECT;
 extern const Rect BOUNDS_RECT;
 extern int SCREEN_WIDTH;
 extern int SCREEN_HEIGHT;
+extern int SOLVER_THREADS;
+extern int LEVEL_CACHE_BYTES; //decompressed levels kept by Levels
+extern bool SOLVER_SIMD;
+extern bool PROFILE_PHYSICS;
+extern bool DETERMINISTIC;
+extern bool PHYSICS_THREAD;
 extern const int brushColours[];
 extern const int NUM_BRUSHES;
 #define RED_BRUSH       0
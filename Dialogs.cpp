@@ -170,9 +170,9 @@ public:
       fprintf(stderr,"creating thumb\n");
       Canvas temp( SCREEN_WIDTH, SCREEN_HEIGHT );
       Scene scene( true );
-      unsigned char buf[64*1024];
       int level = m_levels->collectionLevel(c,i);
-      int size = m_levels->load( level, buf, sizeof(buf) );
+      int size;
+      const unsigned char* buf = m_levels->load( level, &size );
       if ( size && scene.load( buf, size ) ) {
 	scene.draw( temp, FULLSCREEN_RECT );
 	m_thumbs[i]->text( m_levels->levelName(level) );
@@ -200,6 +200,7 @@ public:
 //       //Event closeEvent(Event::CLOSE);
 //       //m_parent->dispatchEvent(closeEvent);
 //       return true;
+    default: break;
     }
     return MenuPage::onEvent(ev);
   }
@@ -561,6 +562,7 @@ public:
       }
       updateTicks();
       return true;
+    default: break;
     }
     return MenuDialog::onEvent(ev);
   }
@@ -53,6 +53,7 @@ struct Event
     PAUSE,
     PLAY,
     REPLAY,
+    REWIND,
     SAVE,
     SEND,
     TEXT
@@ -42,8 +42,6 @@
 
 using namespace std;
 
-unsigned char levelbuf[64*1024];
-
 
 #define JOINT_IND_PATH "282,39 280,38 282,38 285,39 300,39 301,60 303,66 302,64 301,63 300,48 297,41 296,42 294,43 293,45 291,46 289,48 287,49 286,52 284,53 283,58 281,62 280,66 282,78 284,82 287,84 290,85 294,88 297,88 299,89 302,90 308,90 311,89 314,89 320,85 321,83 323,83 324,81 327,78 328,75 327,63 326,58 325,55 323,54 321,51 320,49 319,48 316,46 314,44 312,43 314,43"
 
@@ -62,6 +60,8 @@ class Game : public GameControl, public Container
   Os               *m_os;
   bool              m_isCompleted;
   Path              m_jointCandidates;
+  Region            m_jointDirt;  // candidates that came or went
+  int               m_jointSpin;  // of the candidate indicators
   Path              m_jointInd;
 public:
   Game( Levels* levels, int width, int height ) 
@@ -73,6 +73,7 @@ public:
     m_isCompleted(false),
     m_options( NULL ),
     m_os( Os::get() ),
+    m_jointSpin(0),
     m_jointInd(JOINT_IND_PATH)
   {
     setEventMap(Os::get()->getEventMap(GAME_MAP));
@@ -103,8 +104,9 @@ public:
       m_scene.start( true );
       ok = true;
     } else if ( level >= 0 && level < m_levels->numLevels() ) {
-      int size = m_levels->load( level, levelbuf, sizeof(levelbuf) );
-      if ( size && m_scene.load( levelbuf, size ) ) {
+      int size;
+      const unsigned char* buf = m_levels->load( level, &size );
+      if ( size && m_scene.load( buf, size ) ) {
 	m_scene.start( m_scene.getLog()->size() > 0 );
 	ok = true;
       }
@@ -185,6 +187,16 @@ public:
     }
   }
 
+  const b2Profile* profile()
+  {
+    return m_scene.profile();
+  }
+
+  void interpolate( float alpha )
+  {
+    m_scene.setInterpolation( alpha );
+  }
+
   void clickMode(int cm)
   {
     if (cm != m_clickMode) {
@@ -278,29 +290,25 @@ public:
     return Container::isDirty() || !dirtyArea().isEmpty();
   }
 
-  virtual Rect dirtyArea() 
+  virtual Region dirtyArea() 
   {
-    //todo include dirt  for old joint candidates
     m_jointCandidates.empty();
     if ( m_refresh  ) {
-      if ( m_createStroke ) {
-	//this messes up dirty calc so do _after_ dirty area eval.
-	m_scene.getJointCandidates( m_createStroke, m_jointCandidates );
-      }
+      //this messes up dirty calc so do _after_ dirty area eval.
+      m_scene.trackJointCandidates( m_createStroke, m_jointCandidates );
       return FULLSCREEN_RECT;
     } else {
-      Rect r = m_scene.dirtyArea();
-      if ( m_createStroke ) {
-	//this messes up dirty calc so do _after_ dirty area eval.
-	m_scene.getJointCandidates( m_createStroke, m_jointCandidates );
-	if ( m_jointCandidates.size() ) {
-	  Rect jr = m_jointCandidates.bbox();
-	  jr.grow( 8 );
-	  r.expand( jr );
-	}
+      Region r = m_scene.dirtyArea();
+      //this messes up dirty calc so do _after_ dirty area eval.
+      m_jointDirt.add( m_scene.trackJointCandidates( m_createStroke,
+						     m_jointCandidates ) );
+      r.add( m_jointDirt );
+      for ( int i=0; i<m_jointCandidates.size(); i++ ) {
+	// the indicators spin, so the live ones are redrawn anyway
+	r.add( Rect( m_jointCandidates[i], m_jointCandidates[i] ) );
       }
       r.grow(8);
-      r.expand(Container::dirtyArea());
+      r.add(Container::dirtyArea());
       return r;
     }
   }
@@ -316,6 +324,10 @@ public:
   virtual void onTick( int tick ) 
   {
     m_scene.step( isPaused() );
+    if ( m_jointCandidates.size() ) {
+      // spin by the tick, the same in every area drawn in a frame
+      m_jointSpin++;
+    }
 
     if ( m_isCompleted && m_completedDialog && m_edit ) {
       remove( m_completedDialog );
@@ -360,11 +372,11 @@ public:
 
   virtual void draw( Canvas& screen, const Rect& area )
   {
-    static int drawCount = 0 ;
     m_refresh = false;
+    m_jointDirt.clear();
     m_scene.draw( screen, area );
     if ( m_jointCandidates.size() ) {
-      float32 rot = (float32)(drawCount&127) / 128.0f;
+      float32 rot = (float32)(m_jointSpin&127) / 128.0f;
       for ( int i=0; i<m_jointCandidates.size(); i++ ) {
 	Path joint = m_jointInd;
 	joint.translate( -joint.bbox().centroid() );
@@ -372,7 +384,6 @@ public:
 	joint.translate( m_jointCandidates[i] + joint.bbox().centroid() );
 	screen.drawPath( joint, 0x606060 );
       }
-      drawCount++;
     }
     if ( m_fade ) {
       screen.fade( area );
@@ -494,6 +505,13 @@ public:
     case Event::REPLAY:
       gotoLevel( ev.x, true );
       break;
+    case Event::REWIND:
+      // not while a stroke is being drawn or dragged
+      if ( !m_createStroke && !m_moveStroke ) {
+	m_scene.seek( m_scene.tick() - ITERATION_RATE );
+	m_refresh = true;
+      }
+      break;
     case Event::PLAY:
       gotoLevel( ev.x );
       break;
@@ -21,6 +21,7 @@
 
 class Widget;
 class Canvas;
+struct b2Profile;
 
 struct GameStats
 {
@@ -61,6 +62,9 @@ struct GameControl
   virtual bool load( const char* file ) {};
   virtual void gotoLevel( int l, bool replay=false ) =0;
   virtual void clickMode(int cm) =0;
+  virtual const b2Profile* profile() { return NULL; }
+  // draw the scene alpha of a tick behind the physics
+  virtual void interpolate( float /*alpha*/ ) {}
   Levels& levels() { return *m_levels; }
   const GameStats& stats() { return m_stats; }
   bool  m_quit;
@@ -15,7 +15,9 @@
  */
 
 #include <cstring>
+#include <cstdlib>
 #include <sys/types.h>
+#include <sys/stat.h>
 #include <dirent.h>
 
 #include "Levels.h"
@@ -79,19 +81,29 @@ std::string nameFromPath(const std::string& path)
 }
 
 Levels::Levels( int numFiles, const char** names )
-  : m_numLevels(0)
+  : m_numLevels(0),
+    m_cacheBytes(0),
+    m_cacheBudget(LEVEL_CACHE_BYTES),
+    m_cacheHits(0),
+    m_cacheMisses(0)
 {
   for ( int d=0;d<numFiles;d++ ) {
     addPath( names[d] );
   }
 }
 
+Levels::~Levels()
+{
+  trimCache( 0 );
+}
+
 bool Levels::addPath( const char* path )
 {
   int len = strlen( path );
   if ( strcasecmp( path+len-4, ".npz" )==0 ) {
     scanCollection( string(path), rankFromPath(path) );
   } else if ( strcasecmp( path+len-4, ".nph" )==0 
+	      || strcasecmp( path+len-4, ".npb" )==0
 	      || strcasecmp( path+len-4, ".npd" )==0) {
     addLevel( path, rankFromPath(path) );
   } else {
@@ -174,11 +186,11 @@ Levels::Collection* Levels::getCollection( const std::string& file )
 bool Levels::scanCollection( const std::string& file, int rank )
 {
   try {
-    ZipFile zf(file);
+    ZipFile* zf = ZipFile::get(file);
     Collection *collection = getCollection(file);
-    //printf("found collection %s with %d levels\n",file.c_str(),zf.numEntries());
-    for ( int i=0; i<zf.numEntries(); i++ ) {
-      addLevel( collection, file, rankFromPath(zf.entryName(i),rank), i );
+    //printf("found collection %s with %d levels\n",file.c_str(),zf->numEntries());
+    for ( int i=0; i<zf->numEntries(); i++ ) {
+      addLevel( collection, file, rankFromPath(zf->entryName(i),rank), i );
     }
   } catch (...) {
     fprintf(stderr,"invalid collection %s\n",file.c_str());
@@ -192,42 +204,124 @@ int Levels::numLevels()
 }
 
 
-int Levels::load( int i, unsigned char* buf, int bufLen )
+const unsigned char* Levels::load( int i, int* len )
 {
-  int l = 0;
+  *len = 0;
 
   LevelDesc *lev = findLevel(i);
   if (lev) {
+    struct stat st;
+    if ( stat( lev->file.c_str(), &st ) != 0 ) {
+      st.st_mtime = 0;
+      st.st_size = 0;
+    }
+    for ( int c=m_cache.size()-1; c>=0; c-- ) {
+      CachedLevel* cl = m_cache[c];
+      if ( cl->index == lev->index && cl->file == lev->file ) {
+	m_cache.erase( c );
+	if ( cl->mtime == st.st_mtime && cl->size == st.st_size ) {
+	  m_cache.append( cl );
+	  m_cacheHits++;
+	  *len = cl->len;
+	  return cl->data;
+	}
+	// the file has changed under us
+	m_cacheBytes -= cl->len;
+	free( cl->data );
+	delete cl;
+	break;
+      }
+    }
+
     if ( lev->index >= 0 ) {
-      ZipFile zf( lev->file.c_str() );
-      if ( lev->index < zf.numEntries() ) {
-	
-	unsigned char* d = zf.extract( lev->index, &l);
-	if ( d && l <= bufLen ) {
-	  memcpy( buf, d, l );
+      ZipFile* zf = ZipFile::get( lev->file );
+      if ( lev->index < zf->numEntries() ) {
+	int l = 0;
+	unsigned char* d = zf->extract( lev->index, &l );
+	if ( d ) {
+	  *len = l;
+	  if ( zf->stored( lev->index ) ) {
+	    return d; // already costs nothing
+	  }
+	  m_cacheMisses++;
+	  return cacheLevel( lev, st, d, l );
 	}
       }
     } else {
-      FILE *f = fopen( lev->file.c_str(), "rt" );
+      FILE *f = fopen( lev->file.c_str(), "rb" );
       if ( f ) {
-	l = fread( buf, 1, bufLen, f );
+	fseek( f, 0, SEEK_END );
+	long size = ftell( f );
+	fseek( f, 0, SEEK_SET );
+	if ( size > 0 ) {
+	  if ( m_buf.size() < size ) {
+	    m_buf.resize( size );
+	  }
+	  *len = fread( &m_buf[0], 1, size, f );
+	}
 	fclose(f);
+	if ( *len ) {
+	  m_cacheMisses++;
+	  return cacheLevel( lev, st, &m_buf[0], *len );
+	}
       }
     }
-    return l;
+    return NULL;
   }
 
   throw "invalid level index";  
 }
 
+const unsigned char* Levels::cacheLevel( LevelDesc* lev, const struct stat& st,
+					 const unsigned char* d, int len )
+{
+  if ( len > m_cacheBudget ) {
+    return d;
+  }
+  unsigned char* copy = (unsigned char*)malloc( len );
+  if ( !copy ) {
+    return d;
+  }
+  memcpy( copy, d, len );
+  trimCache( m_cacheBudget - len );
+
+  CachedLevel* cl = new CachedLevel;
+  cl->file  = lev->file;
+  cl->index = lev->index;
+  cl->mtime = st.st_mtime;
+  cl->size  = st.st_size;
+  cl->data  = copy;
+  cl->len   = len;
+  m_cache.append( cl );
+  m_cacheBytes += len;
+  return copy;
+}
+
+void Levels::trimCache( int budget )
+{
+  while ( m_cache.size() > 0 && m_cacheBytes > budget ) {
+    CachedLevel* cl = m_cache[0];
+    m_cache.erase( 0 );
+    m_cacheBytes -= cl->len;
+    free( cl->data );
+    delete cl;
+  }
+}
+
+void Levels::setCacheBudget( int bytes )
+{
+  m_cacheBudget = bytes < 0 ? 0 : bytes;
+  trimCache( m_cacheBudget );
+}
+
 std::string Levels::levelName( int i, bool pretty )
 {
   std::string s = "end";
   LevelDesc *lev = findLevel(i);
   if (lev) {
     if ( lev->index >= 0 ) {
-      ZipFile zf( lev->file.c_str() );
-      s = zf.entryName( lev->index );
+      ZipFile* zf = ZipFile::get( lev->file );
+      s = zf->entryName( lev->index );
     } else {
       s = lev->file;
     }
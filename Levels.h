@@ -19,16 +19,30 @@
 
 #include <cstdio>
 #include <sstream>
+#include <time.h>
+#include <sys/stat.h>
 #include "Array.h"
 
 class Levels
 {
  public:
   Levels( int numDirs=0, const char** dirs=NULL );
+  ~Levels();
   bool addPath( const char* path );
   bool addLevel( const std::string& file, int rank=-1, int index=-1 );
   int  numLevels();
-  int load( int i, unsigned char* buf, int bufLen );
+  // The bytes of level i and their number in len, however many there
+  // are. Levels stored uncompressed in a collection come straight from
+  // the mapped file, the rest from a buffer reused by the next load,
+  // so the view only lasts until the next call on these Levels.
+  // Levels read or inflated are kept in a cache of recently loaded
+  // ones while they fit its budget, so loading them again is free.
+  const unsigned char* load( int i, int* len );
+  // Bytes the level cache may hold, evicting the least recently used
+  // levels to fit; 0 turns it off.
+  void setCacheBudget( int bytes );
+  int  cacheHits()   { return m_cacheHits; }
+  int  cacheMisses() { return m_cacheMisses; }
   std::string levelName( int i, bool pretty=true );
   int findLevel( const char *file );
 
@@ -67,8 +81,29 @@ class Levels
   Collection* getCollection( const std::string& file );
   bool scanCollection( const std::string& file, int rank );
 
+  // a level's bytes as last loaded from its file as of mtime, when
+  // the file was size bytes long; mtimes only count whole seconds
+  struct CachedLevel
+  {
+    std::string    file;
+    int            index;
+    time_t         mtime;
+    off_t          size;
+    unsigned char* data;
+    int            len;
+  };
+  const unsigned char* cacheLevel( LevelDesc* lev, const struct stat& st,
+				   const unsigned char* d, int len );
+  void trimCache( int budget );
+
   int m_numLevels;
   Array<Collection*> m_collections;
+  Array<unsigned char> m_buf; // for levels in files of their own
+  Array<CachedLevel*> m_cache; // least recently used first
+  int m_cacheBytes;
+  int m_cacheBudget;
+  int m_cacheHits;
+  int m_cacheMisses;
 };
 
 #endif //LEVELS_H
@@ -15,8 +15,14 @@
  */
 
 #include <cstring>
+#include <cstdlib>
+#include <climits>
 #include "Path.h"
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 
 static float32 calcDistanceToLine( const Vec2& pt,
 				 const Vec2& l1, const Vec2& l2,
@@ -54,7 +60,7 @@ float32 Segment::distanceTo( const Vec2& p )
 
 Path::Path() : Array<Vec2>() {}
 
-Path::Path( int n, Vec2* p ) : Array<Vec2>(n, p) {}
+Path::Path( int n, const Vec2* p ) : Array<Vec2>(n, p) {}
 
 Path::Path( const char *s )
 {
@@ -66,6 +72,129 @@ Path::Path( const char *s )
   }
 }
 
+static inline bool isSpace( char c )
+{
+  return c==' ' || c=='\t' || c=='\n' || c=='\r' || c=='\v' || c=='\f';
+}
+
+static inline bool isAlpha( char c )
+{
+  return (c>='a' && c<='z') || (c>='A' && c<='Z');
+}
+
+// The (int) of a float, clamped where the cast would be undefined.
+static int clampToInt( float32 f )
+{
+  if ( f >= 2147483648.0f ) {
+    return INT_MAX;
+  } else if ( f > -2147483648.0f ) {
+    return (int)f;
+  }
+  return INT_MIN; // and NaN
+}
+
+// Scan a number that scanInt does not know, such as 1e3, with strtof.
+// Level files are not terminated, so the token is copied out first.
+static bool scanFloat( const char*& s, const char* end, int& v )
+{
+  char buf[64];
+  int n = 0;
+  while ( s+n<end && n<(int)sizeof(buf)-1
+	  && ( isAlpha(s[n]) || (s[n]>='0' && s[n]<='9')
+	       || s[n]=='.' || s[n]=='-' || s[n]=='+' ) ) {
+    buf[n] = s[n];
+    n++;
+  }
+  buf[n] = '\0';
+  char* stop;
+  float32 f = strtof( buf, &stop );
+  if ( stop == buf ) {
+    return false;
+  }
+  v = clampToInt( f );
+  s += stop-buf;
+  return true;
+}
+
+// Scan a decimal number at s, no further than end, and move s past it.
+// Only the whole part is kept, truncated towards zero and clamped as
+// the (int) of a %f would be. Anything but plain digits and a point,
+// an exponent say, is left to scanFloat.
+static bool scanInt( const char*& s, const char* end, int& v )
+{
+  const char* p = s;
+  bool neg = false;
+  if ( p<end && (*p=='-' || *p=='+') ) {
+    neg = (*p=='-');
+    p++;
+  }
+  const char* digits = p;
+  int n = 0;
+  bool clamped = false;
+  while ( p<end && *p>='0' && *p<='9' ) {
+    int d = *p-'0';
+    if ( n > (INT_MAX-d)/10 ) {
+      clamped = true;
+    } else {
+      n = n*10 + d;
+    }
+    p++;
+  }
+  bool whole = p > digits;
+  if ( p<end && *p=='.' ) {
+    const char* frac = ++p;
+    while ( p<end && *p>='0' && *p<='9' ) {
+      p++;
+    }
+    whole = whole || p > frac;
+  }
+  if ( p<end && isAlpha(*p) ) {
+    return scanFloat( s, end, v );
+  }
+  if ( !whole ) {
+    return false;
+  }
+  if ( clamped ) {
+    v = neg ? INT_MIN : INT_MAX;
+  } else {
+    v = neg ? -n : n;
+  }
+  s = p;
+  return true;
+}
+
+void Path::parse( const char* s, const char* end )
+{
+  // every point has a comma, and see below for the extra one
+  int n = 1;
+  for ( const char* p=s; p<end; p++ ) {
+    if ( *p==',' ) n++;
+  }
+  empty();
+  if ( n > 0 ) {
+    capacity( n );
+  }
+  while ( s < end ) {
+    const char* p = s;
+    int x, y;
+    while ( p<end && isSpace(*p) ) p++;
+    if ( !scanInt( p, end, x ) || p==end || *p!=',' ) {
+      break;
+    }
+    p++;
+    while ( p<end && isSpace(*p) ) p++;
+    if ( !scanInt( p, end, y ) ) {
+      break;
+    }
+    append( Vec2(x,y) );
+    // step on from where the point started, like Path(const char*):
+    // a list starting with a blank repeats its first point, and levels
+    // depend on that to keep their shapes
+    while ( s<end && *s!=' ' && *s!='\t' ) s++;
+    while ( s<end && (*s==' ' || *s=='\t') ) s++;
+  }
+}
+
 void Path::makeRelative() 
 {
   for (int i=size()-1; i>=0; i--) 
@@ -96,6 +225,140 @@ Path& Path::rotate(const b2Mat22& rot)
   return *this;
 }
 
+// A rotation and whole pixel translation applied to a point at a time,
+// or on SSE2 to a pair packed as x0,y0,x1,y1. The products are summed
+// in the same order as rotate() so both give the same pixels.
+struct PointXform
+{
+  PointXform( const b2XForm& xf )
+    : j1(xf.R.col1.x), k1(xf.R.col1.y), j2(xf.R.col2.x), k2(xf.R.col2.y),
+      pos( (int)xf.position.x, (int)xf.position.y )
+  {
+#ifdef __SSE2__
+    a = _mm_setr_ps( j1, k2, j1, k2 );
+    b = _mm_setr_ps( j2, k1, j2, k1 );
+    t = _mm_setr_epi32( pos.x, pos.y, pos.x, pos.y );
+#endif
+  }
+
+  Vec2 apply( const Vec2& p ) const
+  {
+    return Vec2( (int)(j1 * p.x + j2 * p.y) + pos.x,
+		 (int)(k1 * p.x + k2 * p.y) + pos.y );
+  }
+
+#ifdef __SSE2__
+  __m128i apply( __m128i p ) const
+  {
+    __m128 f = _mm_cvtepi32_ps( p );
+    __m128 s = _mm_shuffle_ps( f, f, _MM_SHUFFLE(2,3,0,1) );
+    __m128 r = _mm_add_ps( _mm_mul_ps( a, f ), _mm_mul_ps( b, s ) );
+    return _mm_add_epi32( _mm_cvttps_epi32( r ), t );
+  }
+  __m128 a, b;
+  __m128i t;
+#endif
+
+  float32 j1, k1, j2, k2;
+  Vec2 pos;
+};
+
+#ifdef __SSE2__
+// SSE2 has no 32 bit integer min and max
+static inline __m128i minInts( __m128i a, __m128i b )
+{
+  __m128i lt = _mm_cmplt_epi32( a, b );
+  return _mm_or_si128( _mm_and_si128( lt, a ), _mm_andnot_si128( lt, b ) );
+}
+
+static inline __m128i maxInts( __m128i a, __m128i b )
+{
+  __m128i gt = _mm_cmpgt_epi32( a, b );
+  return _mm_or_si128( _mm_and_si128( gt, a ), _mm_andnot_si128( gt, b ) );
+}
+
+// fold the two points of lo and hi into box
+static inline void expandBox( Rect& box, __m128i lo, __m128i hi )
+{
+  lo = minInts( lo, _mm_shuffle_epi32( lo, _MM_SHUFFLE(1,0,3,2) ) );
+  hi = maxInts( hi, _mm_shuffle_epi32( hi, _MM_SHUFFLE(1,0,3,2) ) );
+  int l[4], h[4];
+  _mm_storeu_si128( (__m128i*)l, lo );
+  _mm_storeu_si128( (__m128i*)h, hi );
+  box.expand( Vec2( l[0], l[1] ) );
+  box.expand( Vec2( h[0], h[1] ) );
+}
+#endif
+
+// Put n points through xf into out, and when screen is given through
+// that as well into sout, growing the boxes to cover them.
+template <bool SCREEN>
+static void transformPoints( const Vec2* src, int n, const PointXform& xf,
+			     Vec2* out, Rect& box,
+			     const PointXform* screen, Vec2* sout, Rect* sbox )
+{
+  int i = 0;
+#ifdef __SSE2__
+  if ( n >= 2 ) {
+    __m128i lo = _mm_set1_epi32( INT_MAX ), hi = _mm_set1_epi32( INT_MIN );
+    __m128i slo = lo, shi = hi;
+    for ( ; i+2 <= n; i += 2 ) {
+      __m128i p = xf.apply( _mm_loadu_si128( (const __m128i*)(src+i) ) );
+      _mm_storeu_si128( (__m128i*)(out+i), p );
+      lo = minInts( lo, p );
+      hi = maxInts( hi, p );
+      if ( SCREEN ) {
+	__m128i s = screen->apply( p );
+	_mm_storeu_si128( (__m128i*)(sout+i), s );
+	slo = minInts( slo, s );
+	shi = maxInts( shi, s );
+      }
+    }
+    expandBox( box, lo, hi );
+    if ( SCREEN ) {
+      expandBox( *sbox, slo, shi );
+    }
+  }
+#endif
+  for ( ; i < n; i++ ) {
+    out[i] = xf.apply( src[i] );
+    box.expand( out[i] );
+    if ( SCREEN ) {
+      sout[i] = screen->apply( out[i] );
+      sbox->expand( sout[i] );
+    }
+  }
+}
+
+Rect Path::transform(const Path& src, const b2XForm& xf)
+{
+  resize( src.size() );
+  if ( size()==0 ) {
+    return Rect(true);
+  }
+  Rect box( Vec2(INT_MAX,INT_MAX), Vec2(INT_MIN,INT_MIN) );
+  transformPoints<false>( &src.at(0), size(), PointXform( xf ),
+			  &at(0), box, NULL, NULL, NULL );
+  return box;
+}
+
+Rect Path::transform(const Path& src, const b2XForm& xf,
+		     const b2XForm& screen, Path& sout, Rect& sbox)
+{
+  resize( src.size() );
+  sout.resize( src.size() );
+  if ( size()==0 ) {
+    sbox = Rect(true);
+    return Rect(true);
+  }
+  PointXform sxf( screen );
+  Rect box( Vec2(INT_MAX,INT_MAX), Vec2(INT_MIN,INT_MIN) );
+  sbox = box;
+  transformPoints<true>( &src.at(0), size(), PointXform( xf ),
+			 &at(0), box, &sxf, &sout.at(0), &sbox );
+  return box;
+}
+
 Path& Path::scale(float32 factor)
 {
   for (int i=0;i<size();i++) {
@@ -131,6 +394,39 @@ void Path::simplify( float32 threshold )
   }
 }
 
+void Path::merge( float32 tolerance )
+{
+  if ( size() < 3 ) {
+    return;
+  }
+
+  // Greedily grow each run of segments for as long as every point in
+  // the run stays within tolerance of the chord across it.
+  bool keepflags[size()];
+  memset( &keepflags[0], 0, sizeof(keepflags) );
+  keepflags[0] = keepflags[size()-1] = true;
+
+  int first = 0;
+  for ( int last=2; last<size(); last++ ) {
+    Segment s( at(first), at(last) );
+    for ( int i=first+1; i<last; i++ ) {
+      if ( s.distanceTo( at(i) ) > tolerance ) {
+	first = last-1;
+	keepflags[first] = true;
+	break;
+      }
+    }
+  }
+
+  int k=0;
+  for ( int i=0; i<size(); i++ ) {
+    if ( keepflags[i] ) {
+      at(k++) = at(i);
+    }
+  }
+  trim( size() - k );
+}
+
 void Path::simplifySub( int first, int last, float32 threshold, bool* keepflags )
 {
   float32 furthestDist = threshold;
@@ -36,13 +36,24 @@ class Path : public Array<Vec2>
 {
 public:
   Path();
-  Path( int n, Vec2* p );
+  Path( int n, const Vec2* p );
   Path( const char *ptlist );
 
+  // Set this path to the "x,y x,y ..." list from s up to end, sized
+  // for it up front, without copying the text.
+  void parse( const char* s, const char* end );
+
   void makeRelative();
   Path& translate(const Vec2& xlate);
   Path& rotate(const b2Mat22& rot);
   Path& scale(float32 factor);
+  // Set this path to src rotated and translated by xf, truncating each
+  // rotated point the way rotate() does, and return its bounding box.
+  Rect transform(const Path& src, const b2XForm& xf);
+  // As above, and in the same pass put the new points through screen
+  // into sout, with sbox set to the bounding box of sout.
+  Rect transform(const Path& src, const b2XForm& xf,
+		 const b2XForm& screen, Path& sout, Rect& sbox);
 
   inline Vec2& origin() { return at(0); }
 
@@ -96,6 +107,7 @@ public:
   inline Vec2& endpt(unsigned char end) { return end?last():first(); }
 
   void simplify( float32 threshold );
+  void merge( float32 tolerance );
   Rect bbox() const;
 
  private:
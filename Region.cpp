@@ -0,0 +1,116 @@
+/*
+ * This file is part of NumptyPhysics
+ * Copyright (C) 2008 Tim Edmonds
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ */
+
+#include "Region.h"
+#include "Config.h"
+
+
+static int rectArea( const Rect& r )
+{
+  return r.width() * r.height();
+}
+
+static Rect rectUnion( const Rect& a, const Rect& b )
+{
+  Rect u = a;
+  u.tl = Min( u.tl, b.tl );
+  u.br = Max( u.br, b.br );
+  return u;
+}
+
+void Region::add( const Rect& r )
+{
+  if ( r.isEmpty() ) {
+    return;
+  }
+  Rect a = r;
+  bool merged = true;
+  while ( merged ) {
+    merged = false;
+    for ( int i=m_rects.size()-1; i>=0; i-- ) {
+      const Rect& b = m_rects[i];
+      Rect u = rectUnion( a, b );
+      if ( a.intersects( b )
+	   || rectArea( u ) <= DIRTY_MERGE_FACTORf * (rectArea(a)+rectArea(b)) ) {
+	a = u;
+	m_rects.erase( i );
+	merged = true;
+      }
+    }
+    if ( !merged && m_rects.size() >= DIRTY_MAX_RECTS ) {
+      // too many, take in whichever grows least
+      int best = 0;
+      int bestGrowth = 0;
+      for ( int i=0; i<m_rects.size(); i++ ) {
+	int growth = rectArea( rectUnion( a, m_rects[i] ) ) - rectArea( m_rects[i] );
+	if ( i==0 || growth < bestGrowth ) {
+	  best = i;
+	  bestGrowth = growth;
+	}
+      }
+      a = rectUnion( a, m_rects[best] );
+      m_rects.erase( best );
+      merged = true;
+    }
+  }
+  m_rects.append( a );
+}
+
+void Region::add( const Region& r )
+{
+  for ( int i=0; i<r.size(); i++ ) {
+    add( r[i] );
+  }
+}
+
+void Region::grow( int by )
+{
+  Array<Rect> rects = m_rects;
+  m_rects.empty();
+  for ( int i=0; i<rects.size(); i++ ) {
+    Rect r = rects[i];
+    r.grow( by );
+    add( r );
+  }
+}
+
+bool Region::intersects( const Rect& r ) const
+{
+  for ( int i=0; i<m_rects.size(); i++ ) {
+    if ( m_rects[i].intersects( r ) ) {
+      return true;
+    }
+  }
+  return false;
+}
+
+Rect Region::bbox() const
+{
+  Rect r( false );
+  for ( int i=0; i<m_rects.size(); i++ ) {
+    r.expand( m_rects[i] );
+  }
+  return r;
+}
+
+int Region::area() const
+{
+  int a = 0;
+  for ( int i=0; i<m_rects.size(); i++ ) {
+    a += rectArea( m_rects[i] );
+  }
+  return a;
+}
@@ -0,0 +1,49 @@
+/*
+ * This file is part of NumptyPhysics
+ * Copyright (C) 2008 Tim Edmonds
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ */
+
+#ifndef REGION_H
+#define REGION_H
+
+#include "Common.h"
+#include "Array.h"
+
+
+// A set of disjoint rects to repaint. Rects that touch, or that are
+// nearly as cheap to repaint together as apart, are merged as they
+// are added, so a few small areas far apart stay separate.
+class Region
+{
+public:
+  Region() {}
+  Region( const Rect& r ) { add( r ); }
+
+  void add( const Rect& r );
+  void add( const Region& r );
+  void grow( int by );
+  void clear() { m_rects.empty(); }
+  bool isEmpty() const { return m_rects.size() == 0; }
+  int size() const { return m_rects.size(); }
+  const Rect& operator[]( int i ) const { return m_rects[i]; }
+  bool intersects( const Rect& r ) const;
+  Rect bbox() const;
+  // pixels covered
+  int area() const;
+
+private:
+  Array<Rect> m_rects;
+};
+
+#endif //REGION_H
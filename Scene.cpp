@@ -18,9 +18,13 @@
 #include "Config.h"
 #include "Scene.h"
 #include "Accelerometer.h"
+#include "Worker.h"
 
+#include <cstring>
+#include <iterator>
 #include <sstream>
 #include <fstream>
+#include <fenv.h>
 
 
 Transform::Transform( float32 scale, float32 rotation, const Vec2& translation )
@@ -81,8 +85,155 @@ struct Joint
   unsigned char end; //of joiner
 };
 
+// A compiled level (.npb) is a run of native 32 bit words: a header,
+// the title, author and background, the gravity, then each stroke
+// with its raw and shape paths as they are after Stroke::process, the
+// joints made when the level was first activated, and the log.
+// Strokes too small for a body keep their raw path as the level had
+// it and an empty shape path, and are processed when loaded.
+// Strings are a length and their bytes, padded to a whole word.
+static const int32 COMPILED_MAGIC = 0x3142504e; // "NPB1"
+static const int32 COMPILED_VERSION = 2;
+
+class CompiledWriter
+{
+public:
+  void word( int32 w )
+  {
+    m_out.append( (const char*)&w, sizeof(w) );
+  }
+  void real( float32 f )
+  {
+    m_out.append( (const char*)&f, sizeof(f) );
+  }
+  void string( const std::string& s )
+  {
+    word( s.size() );
+    m_out.append( s );
+    m_out.append( (4 - s.size()%4) % 4, '\0' );
+  }
+  void path( const Path& p )
+  {
+    word( p.size() );
+    if ( p.size() ) {
+      m_out.append( (const char*)&p.at(0), p.size()*sizeof(Vec2) );
+    }
+  }
+  const std::string& bytes() { return m_out; }
+private:
+  std::string m_out;
+};
+
+// Reads a compiled level where it lies, going bad rather than past
+// the end of it.
+class CompiledReader
+{
+public:
+  CompiledReader( const unsigned char* buf, int size )
+    : m_p( buf ), m_end( buf+size ), m_ok( true ) {}
+  bool ok() { return m_ok; }
+  int32 word()
+  {
+    int32 w = 0;
+    if ( take( sizeof(w) ) ) {
+      memcpy( &w, m_p-sizeof(w), sizeof(w) );
+    }
+    return w;
+  }
+  float32 real()
+  {
+    float32 f = 0.0f;
+    if ( take( sizeof(f) ) ) {
+      memcpy( &f, m_p-sizeof(f), sizeof(f) );
+    }
+    return f;
+  }
+  std::string string()
+  {
+    int n = word();
+    const char* s = (const char*)m_p;
+    if ( n < 0 || !take( n + (4 - n%4) % 4 ) ) {
+      return std::string();
+    }
+    return std::string( s, n );
+  }
+  // the points of a path, left where they are
+  const Vec2* path( int& n )
+  {
+    n = word();
+    const Vec2* p = (const Vec2*)m_p;
+    if ( n < 0 || n > (m_end-m_p)/(int)sizeof(Vec2)
+	 || !take( n*sizeof(Vec2) ) ) {
+      n = 0;
+    }
+    return p;
+  }
+private:
+  bool take( int n )
+  {
+    if ( m_ok && n <= m_end-m_p ) {
+      m_p += n;
+    } else {
+      m_ok = false;
+    }
+    return m_ok;
+  }
+  const unsigned char* m_p;
+  const unsigned char* m_end;
+  bool m_ok;
+};
+
+// Finds strokes near a point or path without walking every stroke.
+// World space is cut into a uniform grid of cells, hashed into a
+// fixed table of buckets so strokes flung off the world still index,
+// and each bucket lists the stroke segments crossing its cells.
+// Strokes reindex themselves when their world path is transformed.
+class StrokeIndex
+{
+public:
+  StrokeIndex();
+  // start indexing s, it keeps its place in scene order if it
+  // has been indexed before
+  void add( Stroke* s );
+  void remove( Stroke* s );
+  // s has changed, reindex it before the next query
+  void touch( Stroke* s );
+  // index s by its current world path
+  void insert( Stroke* s );
+  // strokes with a segment within radius of the path, in scene order
+  void query( const Path& path, int radius, Array<Stroke*>& found );
+  // the stroke nearest to pt, if nearer than max, as
+  // Stroke::distanceTo measures it
+  Stroke* nearest( const Vec2& pt, float32 max );
+  // keep track of the strokes that move or go
+  void watch( bool on );
+  // strokes reindexed since the last call, and strokes removed
+  // since then, which may have been freed already
+  void takeMoved( Array<Stroke*>& moved, Array<Stroke*>& removed );
+
+private:
+  struct Entry
+  {
+    Stroke *stroke;
+    int     segment;
+  };
+  void refresh();
+  void unlink( Stroke* s );
+  void cells( const Rect& r, Array<int>& buckets );
+
+  Array<Entry>   m_buckets[INDEX_BUCKETS];
+  Array<Stroke*> m_stale;
+  Array<int>     m_cells;  // scratch list of buckets
+  int            m_order;
+  int            m_stamp;
+  bool           m_watching;
+  Array<Stroke*> m_moved;
+  Array<Stroke*> m_removed;
+};
+
 class Stroke
 {
+  friend class StrokeIndex;
 public:
 
 private:
@@ -97,18 +248,18 @@ private:
     }
   };
 
-  struct BoxDef : public b2PolygonDef
+  struct ChainDef : public b2ChainDef
   {
-    void init( const Vec2& p1, const Vec2& p2, int attr )
+    void init( const Path& path, int attr )
     {
-      b2Vec2 barOrigin = p1;
-      b2Vec2 bar = p2 - p1;
-      bar *= 1.0f/PIXELS_PER_METREf;
-      barOrigin *= 1.0f/PIXELS_PER_METREf;;
-      SetAsBox( bar.Length()/2.0f, 0.1f,
-		0.5f*bar + barOrigin, vec2Angle( bar ));
-      //      SetAsBox( bar.Length()/2.0f+b2_toiSlop, b2_toiSlop*2.0f,
-      //	0.5f*bar + barOrigin, vec2Angle( bar ));
+      int n = path.numPoints();
+      for ( int i=0; i<n; i++ ) {
+	points[i] = path.point(i);
+	points[i] *= 1.0f/PIXELS_PER_METREf;
+      }
+      vertices = points;
+      vertexCount = n;
+      radius = 0.1f;
       friction = 0.3f;
       if ( attr & ATTRIB_GROUND ) {
 	density = 0.0f;
@@ -122,6 +273,7 @@ private:
       }
       restitution = 0.2f;
     }
+    b2Vec2 points[MULTI_VERTEX_LIMIT];
   };
 
 public:
@@ -132,18 +284,21 @@ public:
     m_attributes = 0;
     m_origin = m_rawPath.point(0);
     m_rawPath.translate( -m_origin );
+    m_worldBbox = Rect( m_origin, m_origin );
+    unindexed();
     reset();
   }  
 
-  Stroke( const std::string& str ) 
+  // a level's "S<attributes><colour>: x,y x,y ..." line, from s to end
+  Stroke( const char* s, const char* end )
   {
     int col = 0;
     m_colour = brushColours[DEFAULT_BRUSH];
     m_attributes = 0;
     m_origin = Vec2(400,240);
+    unindexed();
     reset();
-    const char *s = str.c_str();
-    while ( *s && *s!=':' && *s!='\n' ) {
+    while ( s<end && *s!=':' && *s!='\n' ) {
       switch ( *s ) {
       case 't': setAttribute( ATTRIB_TOKEN ); break;	
       case 'g': setAttribute( ATTRIB_GOAL ); break;	
@@ -161,8 +316,8 @@ public:
     if ( col >= 0 && col < NUM_BRUSHES ) {
       m_colour = brushColours[col];
     }
-    if ( *s++ == ':' ) {
-      m_rawPath = Path(s);
+    if ( s<end && *s++ == ':' ) {
+      m_rawPath.parse( s, end );
     }
     if ( m_rawPath.size() < 2 ) {
       throw "invalid stroke def";
@@ -170,9 +325,59 @@ public:
     //fprintf(stderr,"created stroke with %d points\n",m_rawPath.size());
     m_origin = m_rawPath.point(0);
     m_rawPath.translate( -m_origin );
+    m_worldBbox = Rect( m_origin, m_origin );
     setAttribute( ATTRIB_DUMMY );
   }
 
+  // a stroke of a compiled level, its paths already processed
+  Stroke( CompiledReader& in )
+  {
+    m_attributes = in.word();
+    m_colour = in.word();
+    m_origin.x = in.word();
+    m_origin.y = in.word();
+    int n;
+    const Vec2* p = in.path( n );
+    m_rawPath = Path( n, p );
+    m_worldBbox = Rect( m_origin, m_origin );
+    unindexed();
+    reset();
+    p = in.path( n );
+    m_shapePath = Path( n, p );
+    m_processed = n > 0;
+    // the shape path goes straight to ChainDef, so bound it here
+    if ( !in.ok() || m_rawPath.size() < 2
+	 || ( n > 0 && ( n < 2 || n > MULTI_VERTEX_LIMIT ) ) ) {
+      throw "invalid stroke def";
+    }
+  }
+
+  // our record in a compiled level, taken once the paths are processed
+  void compile( CompiledWriter& out )
+  {
+    out.word( m_attributes );
+    out.word( m_colour );
+    out.word( m_origin.x );
+    out.word( m_origin.y );
+    if ( m_shapePath.numPoints() < 2 ) {
+      // a dot: process will make it a single point again
+      Path dot( m_rawPath );
+      dot.append( m_rawPath.point(0) );
+      out.path( dot );
+      out.path( Path() );
+    } else {
+      out.path( m_rawPath );
+      out.path( m_shapePath );
+    }
+  }
+
+  ~Stroke()
+  {
+    if ( m_index ) {
+      m_index->remove( this );
+    }
+  }
+
   void reset( b2World* world=NULL )
   {
     if (m_body && world) {
@@ -184,8 +389,12 @@ public:
     m_drawnBbox.br = m_origin;
     m_jointed[0] = m_jointed[1] = false;
     m_shapePath = m_rawPath;
+    m_processed = false;
     m_hide = 0;
     m_drawn = false;
+    m_alpha = 1.0f;
+    m_static = false;
+    moved();
   }
 
   std::string asString()
@@ -234,8 +443,14 @@ public:
 
   void createBodies( b2World& world )
   {
-    process();
+    if ( m_processed ) {
+      m_processed = false; // a compiled level did it for us
+    } else {
+      process();
+    }
+    moved();
     if ( hasAttribute( ATTRIB_DECOR ) ){
+      m_static = true;
       return; //decorators have no physical embodiment
     }
     int n = m_shapePath.numPoints();
@@ -248,28 +463,36 @@ public:
 	bodyDef.isSleeping = true;
       }
       m_body = world.CreateBody( &bodyDef );
-      for ( int i=1; i<n; i++ ) {
-	BoxDef boxDef;
-	boxDef.init( m_shapePath.point(i-1),
-		     m_shapePath.point(i),
-		     m_attributes );
-	m_body->CreateShape( &boxDef );
-      }
+      ChainDef chainDef;
+      chainDef.init( m_shapePath, m_attributes );
+      m_body->CreateShape( &chainDef );
       m_body->SetMassFromShapes();
-
+      updatePose( true );
+      m_static = hasAttribute( ATTRIB_GROUND );
     }
     transform();
   }
 
+  // whether our endpoints may be jointed to other
+  bool canJoin( Stroke* other )
+  {
+    // cannot joint goals or tokens to other things
+    // and no point jointing ground endpts
+    return (m_attributes&ATTRIB_CLASSBITS)
+      == (other->m_attributes&ATTRIB_CLASSBITS)
+      && !hasAttribute(ATTRIB_GROUND)
+      && !hasAttribute(ATTRIB_UNJOINABLE)
+      && !other->hasAttribute(ATTRIB_UNJOINABLE);
+  }
+
+  bool jointed( unsigned char end )
+  {
+    return m_jointed[end];
+  }
+
   void determineJoints( Stroke* other, Array<Joint>& joints )
   {
-    if ( (m_attributes&ATTRIB_CLASSBITS)
-	 != (other->m_attributes&ATTRIB_CLASSBITS)
-	 || hasAttribute(ATTRIB_GROUND)
-	 || hasAttribute(ATTRIB_UNJOINABLE)
-	 || other->hasAttribute(ATTRIB_UNJOINABLE)) {
-      // cannot joint goals or tokens to other things
-      // and no point jointing ground endpts
+    if ( !canJoin( other ) ) {
       return;
     } 
 
@@ -292,6 +515,7 @@ public:
       JointDef j( m_body, other->m_body, p );
       world->CreateJoint( &j );
       m_jointed[end] = true;
+      moved(); // no longer a joint candidate
     }
   }
 
@@ -357,6 +581,7 @@ public:
     } else {
       m_rawPath.append( p );
       m_drawn = false;
+      moved();
     }
   }
 
@@ -367,13 +592,53 @@ public:
       b2Vec2 pw = p;
       pw *= 1.0f/PIXELS_PER_METREf;
       m_body->SetXForm( pw, m_body->GetAngle() );
+      updatePose( true );
     }
     m_origin = p;
     m_drawn = false;
+    moved();
   }
 
   b2Body* body() { return m_body; }
 
+  // Take the body's pose after a step. Strokes are transformed from
+  // this copy, never from the body, which may be stepping on the
+  // physics thread. A jump also skips the interpolation.
+  void updatePose( bool jump=false )
+  {
+    if ( m_body ) {
+      const b2Vec2& pos = m_body->GetPosition();
+      float32 angle = m_body->GetAngle();
+      if ( angle != m_angle || !(pos == m_pos) ) {
+	m_pos = pos;
+	m_angle = angle;
+	moved();
+      }
+      if ( jump ) {
+	savePose();
+      }
+    }
+  }
+
+  // remember the pose before a step, the screen path is drawn between
+  // it and the pose after the step
+  void savePose()
+  {
+    m_prevPos = m_pos;
+    m_prevAngle = m_angle;
+  }
+
+  // fraction of the way from the previous to the current pose to draw.
+  // Moving strokes take their new paths here, once a frame, rather than
+  // from whichever call first needs them.
+  void interpolate( float32 alpha )
+  {
+    m_alpha = alpha;
+    if ( m_body && !m_hide && transform() ) {
+      m_drawn = false;
+    }
+  }
+
   float32 distanceTo( const Vec2& pt )
   {
     float32 best = 100000.0;
@@ -402,7 +667,13 @@ public:
 
   Rect worldBbox() 
   {
-    return m_xformedPath.bbox();
+    return m_worldBbox;
+  }
+
+  const Path& worldPath()
+  {
+    transform();
+    return m_xformedPath;
   }
 
   bool isDirty()
@@ -420,6 +691,7 @@ public:
 	m_body->SetXForm( b2Vec2(0.0f,SCREEN_HEIGHT*2.0f), 0.0f );
 	m_body->SetLinearVelocity( b2Vec2(0.0f,0.0f) );
 	m_body->SetAngularVelocity( 0.0f );
+	updatePose( true );
       }
     }
   }
@@ -429,6 +701,13 @@ public:
     return m_hide >= HIDE_STEPS;
   }
 
+  // ground and decor strokes in place never move, so the scene draws
+  // them once into its static layer
+  bool isStatic()
+  {
+    return m_static && m_hide==0;
+  }
+
   int numPoints()
   {
     return m_rawPath.numPoints();
@@ -439,12 +718,52 @@ public:
     return m_xformedPath.endpt(end);
   }
 
-private:
-  static float32 vec2Angle( b2Vec2 v ) 
+  // the parts of a stroke that change during play, the body is
+  // snapshotted with the world
+  struct State
+  {
+    Path  rawPath;
+    Path  screenPath; // for strokes that are being hidden
+    Rect  screenBbox;
+    Vec2  origin;
+    int   attributes;
+    int   hide;
+    bool  jointed[2];
+    bool  hasBody;
+    bool  isStatic;
+  };
+
+  void save( State& st )
   {
-    return b2Atan2(v.y, v.x);
-  } 
+    st.rawPath = m_rawPath;
+    st.screenPath = m_screenPath;
+    st.screenBbox = m_screenBbox;
+    st.origin = m_origin;
+    st.attributes = m_attributes;
+    st.hide = m_hide;
+    st.jointed[0] = m_jointed[0];
+    st.jointed[1] = m_jointed[1];
+    st.hasBody = m_body != NULL;
+    st.isStatic = m_static;
+  }
 
+  void restore( const State& st )
+  {
+    m_rawPath = st.rawPath;
+    m_screenPath = st.screenPath;
+    m_screenBbox = st.screenBbox;
+    m_origin = st.origin;
+    m_attributes = st.attributes;
+    m_hide = st.hide;
+    m_jointed[0] = st.jointed[0];
+    m_jointed[1] = st.jointed[1];
+    m_static = st.isStatic;
+    m_xformAngle = 7.0f; // force a new transform
+    m_drawn = false;
+    moved();
+  }
+
+private:
   void process()
   {
     float32 thresh = SIMPLIFY_THRESHOLDf;
@@ -456,6 +775,9 @@ private:
       thresh += SIMPLIFY_THRESHOLDf;
       m_shapePath.simplify( thresh );
     }
+    // the physical shape can be coarser than the drawn one: fold
+    // nearly straight runs into single chain segments.
+    m_shapePath.merge( MERGE_TOLERANCEf );
   }
 
   bool transform()
@@ -476,50 +798,408 @@ private:
       if ( hasAttribute( ATTRIB_DECOR ) ) {
 	return false; // decor never moves
       } else if ( hasAttribute( ATTRIB_GROUND )	   
-		  && m_xformAngle == m_body->GetAngle() ) {
+		  && m_xformAngle == m_angle ) {
 	return false; // ground strokes never move.
-      } else if ( m_xformAngle != m_body->GetAngle() 
-	   ||  ! (m_xformPos == m_body->GetPosition()) ) {
+      }
+      bool moved = false;
+      if ( m_xformAngle != m_angle 
+	   ||  ! (m_xformPos == m_pos) ) {
 	//printf("transform stroke - rot or pos\n");
-	b2Mat22 rot( m_body->GetAngle() );
-	b2Vec2 orig = PIXELS_PER_METREf * m_body->GetPosition();
-	m_xformedPath = m_rawPath;
-	m_xformedPath.rotate( rot );
-	m_xformedPath.translate( Vec2(orig) );
-	m_xformAngle = m_body->GetAngle();
-	m_xformPos = m_body->GetPosition();
-	worldToScreen.transform( m_xformedPath, m_screenPath );
-	m_screenBbox = m_screenPath.bbox();      
-      } else {
+	m_xformAngle = m_angle;
+	m_xformPos = m_pos;
+	moved = true;
+      }
+      // the world path follows the physics, the screen path lags it by
+      // a fraction of a step
+      float32 angle = m_prevAngle + m_alpha * (m_xformAngle - m_prevAngle);
+      b2Vec2 pos = m_prevPos + m_alpha * (m_xformPos - m_prevPos);
+      if ( !moved && m_screenAngle == angle && m_screenPos == pos ) {
 	//printf("transform none\n");
 	return false;
       }
+      b2XForm screen = worldToScreen.xform();
+      if ( angle == m_xformAngle && pos == m_xformPos ) {
+	// world and screen points in the one pass
+	m_worldBbox = m_xformedPath.transform( m_rawPath, pose( m_xformAngle, m_xformPos ),
+					       screen, m_screenPath, m_screenBbox );
+      } else {
+	if ( moved ) {
+	  m_worldBbox = m_xformedPath.transform( m_rawPath, pose( m_xformAngle, m_xformPos ) );
+	}
+	m_lerpPath.transform( m_rawPath, pose( angle, pos ),
+			      screen, m_screenPath, m_screenBbox );
+      }
+      if ( moved ) {
+	reindex();
+      }
+      m_screenAngle = angle;
+      m_screenPos = pos;
     } else {
       //printf("transform no body\n");
-      m_xformedPath = m_rawPath;
-      m_xformedPath.translate( m_origin );
-      worldToScreen.transform( m_xformedPath, m_screenPath );
-      m_screenBbox = m_screenPath.bbox();      
+      b2XForm at;
+      at.SetIdentity();
+      at.position = m_origin;
+      m_worldBbox = m_xformedPath.transform( m_rawPath, at, worldToScreen.xform(),
+					     m_screenPath, m_screenBbox );
+      if ( !m_indexed ) {
+	reindex();
+      }
       return !hasAttribute(ATTRIB_DECOR);
     }
     return true;
   }
 
+  // a body pose in pixels, truncated as the paths have always been
+  static b2XForm pose( float32 angle, const b2Vec2& pos )
+  {
+    Vec2 orig( PIXELS_PER_METREf * pos );
+    return b2XForm( orig, b2Mat22( angle ) );
+  }
+
+  void unindexed()
+  {
+    m_index = NULL;
+    m_order = -1;
+    m_stamp = 0;
+    m_stale = false;
+    m_indexed = false;
+  }
+
+  // the world path needs indexing again
+  void moved()
+  {
+    if ( m_index ) {
+      m_index->touch( this );
+    }
+  }
+
+  void reindex()
+  {
+    if ( m_index ) {
+      m_index->insert( this );
+    }
+  }
+
   Path      m_rawPath;
   int       m_colour;
   int       m_attributes;
   Vec2      m_origin;
   Path      m_shapePath;
+  bool      m_processed;  // shape path ready for the next createBodies
   Path      m_xformedPath;
   Path      m_screenPath;
+  Path      m_lerpPath;
   float32   m_xformAngle;
   b2Vec2    m_xformPos;
+  float32   m_angle;
+  b2Vec2    m_pos;
+  float32   m_prevAngle;
+  b2Vec2    m_prevPos;
+  float32   m_screenAngle;
+  b2Vec2    m_screenPos;
+  float32   m_alpha;
+  Rect      m_worldBbox;
   Rect      m_screenBbox;
   Rect      m_drawnBbox;
   bool      m_drawn;
   b2Body*   m_body;
   bool      m_jointed[2];
   int       m_hide;
+  bool      m_static;
+  StrokeIndex *m_index;
+  Array<int>   m_buckets; // that hold our segments
+  int       m_order;      // in the scene
+  int       m_stamp;      // of the last query to find us
+  bool      m_stale;      // queued for reindexing
+  bool      m_indexed;    // buckets match the world path
+};
+
+
+StrokeIndex::StrokeIndex()
+  : m_order( 0 ),
+    m_stamp( 0 ),
+    m_watching( false )
+{}
+
+void StrokeIndex::add( Stroke* s )
+{
+  if ( s->m_index != this ) {
+    s->m_index = this;
+    if ( s->m_order < 0 ) {
+      s->m_order = m_order++;
+    }
+    s->m_indexed = false;
+    touch( s );
+  }
+}
+
+void StrokeIndex::remove( Stroke* s )
+{
+  if ( s->m_index == this ) {
+    unlink( s );
+    if ( s->m_stale ) {
+      m_stale.erase( m_stale.indexOf( s ) );
+      s->m_stale = false;
+    }
+    s->m_index = NULL;
+    if ( m_watching ) {
+      for ( int i=m_moved.indexOf( s ); i>=0; i=m_moved.indexOf( s ) ) {
+	m_moved.erase( i );
+      }
+      m_removed.append( s );
+    }
+  }
+}
+
+void StrokeIndex::touch( Stroke* s )
+{
+  s->m_indexed = false;
+  if ( !s->m_stale ) {
+    s->m_stale = true;
+    m_stale.append( s );
+  }
+}
+
+void StrokeIndex::insert( Stroke* s )
+{
+  unlink( s );
+  const Path& path = s->m_xformedPath;
+  Array<int>& buckets = m_cells;
+  for ( int i=1; i<path.numPoints(); i++ ) {
+    Rect r( Min( path.point(i-1), path.point(i) ),
+	    Max( path.point(i-1), path.point(i) ) );
+    buckets.empty();
+    cells( r, buckets );
+    for ( int b=0; b<buckets.size(); b++ ) {
+      Entry e;
+      e.stroke = s;
+      e.segment = i;
+      m_buckets[buckets[b]].append( e );
+      int n = s->m_buckets.size();
+      if ( n==0 || s->m_buckets[n-1] != buckets[b] ) {
+	s->m_buckets.append( buckets[b] );
+      }
+    }
+  }
+  s->m_indexed = true;
+  if ( m_watching ) {
+    m_moved.append( s );
+  }
+}
+
+void StrokeIndex::unlink( Stroke* s )
+{
+  for ( int i=0; i<s->m_buckets.size(); i++ ) {
+    Array<Entry>& bucket = m_buckets[s->m_buckets[i]];
+    for ( int j=bucket.size()-1; j>=0; j-- ) {
+      if ( bucket[j].stroke == s ) {
+	bucket[j] = bucket[bucket.size()-1];
+	bucket.trim( 1 );
+      }
+    }
+  }
+  s->m_buckets.empty();
+}
+
+// Strokes only move between queries by being touched, so reindexing
+// the touched ones brings the whole index up to date.
+void StrokeIndex::refresh()
+{
+  for ( int i=0; i<m_stale.size(); i++ ) {
+    Stroke* s = m_stale[i];
+    s->m_stale = false;
+    if ( !s->m_indexed ) {
+      s->transform();
+    }
+    if ( !s->m_indexed ) {
+      insert( s ); // the path was transformed before it was touched
+    }
+  }
+  m_stale.empty();
+}
+
+// The buckets of the cells overlapping r, or of every cell if there
+// are more of those than buckets.
+void StrokeIndex::cells( const Rect& r, Array<int>& buckets )
+{
+  int x0 = r.tl.x >> INDEX_CELL_SHIFT, x1 = r.br.x >> INDEX_CELL_SHIFT;
+  int y0 = r.tl.y >> INDEX_CELL_SHIFT, y1 = r.br.y >> INDEX_CELL_SHIFT;
+  if ( x1-x0 >= INDEX_BUCKETS || y1-y0 >= INDEX_BUCKETS
+       || (x1-x0+1)*(y1-y0+1) > INDEX_BUCKETS ) {
+    for ( int b=0; b<INDEX_BUCKETS; b++ ) {
+      buckets.append( b );
+    }
+    return;
+  }
+  for ( int y=y0; y<=y1; y++ ) {
+    for ( int x=x0; x<=x1; x++ ) {
+      uint32 h = (uint32)x * 73856093u ^ (uint32)y * 19349663u;
+      buckets.append( h % INDEX_BUCKETS );
+    }
+  }
+}
+
+void StrokeIndex::query( const Path& path, int radius, Array<Stroke*>& found )
+{
+  refresh();
+  m_stamp++;
+  Array<int>& buckets = m_cells;
+  for ( int i=0; i<path.numPoints(); i++ ) {
+    const Vec2& p = path.point( i>0 ? i-1 : 0 );
+    Rect r( Min( p, path.point(i) ), Max( p, path.point(i) ) );
+    r.tl -= Vec2( radius, radius );
+    r.br += Vec2( radius, radius );
+    buckets.empty();
+    cells( r, buckets );
+    for ( int b=0; b<buckets.size(); b++ ) {
+      Array<Entry>& bucket = m_buckets[buckets[b]];
+      for ( int j=0; j<bucket.size(); j++ ) {
+	Stroke* s = bucket[j].stroke;
+	if ( s->m_stamp != m_stamp ) {
+	  s->m_stamp = m_stamp;
+	  found.append( s );
+	}
+      }
+    }
+  }
+  // back into scene order, there are only ever a few
+  for ( int i=1; i<found.size(); i++ ) {
+    Stroke* s = found[i];
+    int j = i;
+    for ( ; j>0 && found[j-1]->m_order > s->m_order; j-- ) {
+      found[j] = found[j-1];
+    }
+    found[j] = s;
+  }
+}
+
+Stroke* StrokeIndex::nearest( const Vec2& pt, float32 max )
+{
+  refresh();
+  int radius = max < (float32)(1<<20) ? (int)ceilf( max ) : (1<<20);
+  Array<int>& buckets = m_cells;
+  buckets.empty();
+  cells( Rect( pt - Vec2(radius,radius), pt + Vec2(radius,radius) ),
+	 buckets );
+  Stroke* best = NULL;
+  for ( int b=0; b<buckets.size(); b++ ) {
+    Array<Entry>& bucket = m_buckets[buckets[b]];
+    for ( int j=0; j<bucket.size(); j++ ) {
+      Stroke* s = bucket[j].stroke;
+      const Path& path = s->m_xformedPath;
+      int i = bucket[j].segment;
+      float32 d = Segment( path.point(i-1), path.point(i) ).distanceTo( pt );
+      // ties go to the first stroke in the scene
+      if ( d < max || ( d == max && best && s->m_order < best->m_order ) ) {
+	max = d;
+	best = s;
+      }
+    }
+  }
+  return best;
+}
+
+void StrokeIndex::watch( bool on )
+{
+  m_watching = on;
+  m_moved.empty();
+  m_removed.empty();
+}
+
+void StrokeIndex::takeMoved( Array<Stroke*>& moved, Array<Stroke*>& removed )
+{
+  refresh();
+  m_stamp++;
+  for ( int i=0; i<m_moved.size(); i++ ) {
+    Stroke* s = m_moved[i];
+    if ( s->m_stamp != m_stamp ) {
+      s->m_stamp = m_stamp;
+      moved.append( s );
+    }
+  }
+  removed = m_removed;
+  m_moved.empty();
+  m_removed.empty();
+}
+
+
+// The joint candidates of the stroke being drawn. Drawing only ever
+// adds points to its end, so an update tests the new points and the
+// strokes that moved since the last one.
+struct JointTracker
+{
+  JointTracker() : stroke( NULL ), checked( 0 ) {}
+
+  void add( const Joint& j )
+  {
+    for ( int i=0; i<joints.size(); i++ ) {
+      if ( joints[i].joiner == j.joiner && joints[i].joinee == j.joinee
+	   && joints[i].end == j.end ) {
+	return;
+      }
+    }
+    joints.append( j );
+  }
+
+  void drop( Stroke* s )
+  {
+    for ( int i=joints.size()-1; i>=0; i-- ) {
+      if ( joints[i].joiner == s || joints[i].joinee == s ) {
+	joints.erase( i );
+      }
+    }
+  }
+
+  void dropEnd( unsigned char end )
+  {
+    for ( int i=joints.size()-1; i>=0; i-- ) {
+      if ( joints[i].joiner == stroke && joints[i].end == end ) {
+	joints.erase( i );
+      }
+    }
+  }
+
+  Stroke       *stroke;
+  int           checked;  // points of the stroke tested so far
+  Rect          bbox;     // of those points
+  Array<Joint>  joints;
+  Path          shown;    // candidate points handed out last time
+  // scratch space, kept to save allocating it every frame
+  Array<Stroke*> moved, removed, near;
+  Path          area;
+};
+
+
+// Everything needed to put a scene back to an earlier tick. Snapshots
+// are recycled by the rewind ring, so they keep their buffers.
+struct SceneSnapshot
+{
+  struct JointState
+  {
+    Stroke *stroke1;
+    Stroke *stroke2;
+    b2RevoluteJointDef def;
+  };
+
+  ~SceneSnapshot()
+  {
+    for ( int i=0; i<states.size(); i++ ) {
+      delete states[i];
+    }
+  }
+
+  int                   tick;
+  Array<Stroke*>        strokes;
+  Array<Stroke::State*> states;  // one per stroke, plus spares
+  Array<Stroke*>        bodies;  // in world order, NULL for the ground
+  Array<JointState>     joints;  // in world order
+  b2WorldState          world;
+  ScriptRecorder        recorder;
+  ScriptPlayer          player;
+  int                   logSize;
+  uint32                stateHash;
+  b2Vec2                gravity;
+  b2Vec2                currentGravity;
 };
 
 
@@ -530,8 +1210,17 @@ Scene::Scene( bool noWorld )
     m_gravity(0.0f, 0.0f),
     m_dynamicGravity(false),
     m_accelerometer(Os::get()->getAccelerometer()),
-    m_dirtyArea(false)
+    m_headless(false),
+    m_stateHash(0),
+    m_tick(0),
+    m_staticLayer(NULL),
+    m_staticDirty(true),
+    m_stepping(false),
+    m_jointsCompiled(false),
+    m_index(new StrokeIndex),
+    m_tracker(new JointTracker)
 {
+  memset( &m_profile, 0, sizeof(m_profile) );
   if ( !noWorld ) {
     resetWorld();
   }
@@ -543,20 +1232,48 @@ Scene::~Scene()
   if ( m_world ) {
     delete m_world;
   }
+  delete m_index;
+  delete m_tracker;
+  delete m_staticLayer;
+}
+
+void Scene::addStroke( Stroke* s )
+{
+  m_strokes.append( s );
+  m_index->add( s );
 }
 
 void Scene::resetWorld()
 {
   const b2Vec2 gravity(0.0f, GRAVITY_ACCELf*PIXELS_PER_METREf/GRAVITY_FUDGEf);
-  delete m_world;
-
-  b2AABB worldAABB;
-  worldAABB.lowerBound.Set(-100.0f, -100.0f);
-  worldAABB.upperBound.Set(100.0f, 100.0f);
+  m_gravity = m_currentGravity = gravity;
+  if ( m_world ) {
+    // recycle the world's memory rather than handing it back to the system
+    m_world->Reset();
+    m_world->SetGravity( gravity );
+  } else {
+    b2AABB worldAABB;
+    worldAABB.lowerBound.Set(-100.0f, -100.0f);
+    worldAABB.upperBound.Set(100.0f, 100.0f);
     
-  bool doSleep = true;
-  m_world = new b2World(worldAABB, gravity, doSleep);
+    bool doSleep = true;
+    m_world = new b2World(worldAABB, gravity, doSleep);
+  }
   m_world->SetContactListener( this );
+  if ( DETERMINISTIC ) {
+    // the SIMD back end depends on the cpu, so keep to the scalar
+    // solver on the calling thread
+    return;
+  }
+  if ( SOLVER_SIMD ) {
+    m_world->SetContactSolver( e_simdContactSolver );
+  }
+  if ( SOLVER_THREADS > 1 ) {
+    if ( !g_workerPool ) {
+      g_workerPool = new WorkerPool( SOLVER_THREADS );
+    }
+    m_world->SetWorkerPool( g_workerPool );
+  }
 }
 
 Stroke* Scene::newStroke( const Path& p, int colour, int attribs ) {
@@ -568,7 +1285,7 @@ Stroke* Scene::newStroke( const Path& p, int colour, int attribs ) {
   case 1: s->setAttribute( ATTRIB_GOAL ); break;
   default: s->setColour( brushColours[colour] ); break;
   }
-  m_strokes.append( s );
+  addStroke( s );
   m_recorder.newStroke( p, colour, attribs );
   return s;
 }
@@ -576,9 +1293,12 @@ Stroke* Scene::newStroke( const Path& p, int colour, int attribs ) {
 bool Scene::deleteStroke( Stroke *s ) {
   if ( s ) {
     int i = m_strokes.indexOf(s);
-    if ( i >= m_protect ) {
+    if ( i >= m_protect && defer( SceneCommand::OP_DELETE, s ) ) {
+      return true;
+    } else if ( i >= m_protect ) {
 	reset(s);
 	m_strokes.erase( i );
+	m_index->remove( s );
 	m_deletedStrokes.append( s );
 	m_recorder.deleteStroke( i );
 	return true;
@@ -601,7 +1321,7 @@ void Scene::extendStroke( Stroke* s, const Vec2& pt )
 
 void Scene::moveStroke( Stroke* s, const Vec2& origin )
 {
-  if ( s ) {
+  if ( s && !defer( SceneCommand::OP_MOVE, s, origin ) ) {
     int i = m_strokes.indexOf(s);
     if ( i >= m_protect ) {
       s->origin( origin );
@@ -613,17 +1333,23 @@ void Scene::moveStroke( Stroke* s, const Vec2& origin )
 
 bool Scene::activateStroke( Stroke *s )
 {
-  activate(s);
+  if ( defer( SceneCommand::OP_ACTIVATE, s ) ) {
+    return s->numPoints() > 1;
+  }
+  bool ok = activate(s);
   m_recorder.activateStroke( m_strokes.indexOf(s) );
+  return ok;
 }
 
 void Scene::getJointCandidates( Stroke* s, Path& pts )
 {
   Array<Joint> joints;
-  for ( int j=m_strokes.size()-1; j>=0; j-- ) {      
-    if ( s != m_strokes[j] ) {
-      s->determineJoints( m_strokes[j], joints );
-      m_strokes[j]->determineJoints( s, joints );
+  Array<Stroke*> near;
+  m_index->query( s->worldPath(), (int)ceilf(JOINT_TOLERANCE), near );
+  for ( int j=near.size()-1; j>=0; j-- ) {      
+    if ( s != near[j] ) {
+      s->determineJoints( near[j], joints );
+      near[j]->determineJoints( s, joints );
     }
   }
   for ( int j=joints.size()-1; j>=0; j-- ) {
@@ -631,6 +1357,99 @@ void Scene::getJointCandidates( Stroke* s, Path& pts )
   }
 }
 
+Region Scene::trackJointCandidates( Stroke* s, Path& pts )
+{
+  JointTracker& t = *m_tracker;
+  Region changed;
+  if ( s != t.stroke ) {
+    t.stroke = s;
+    t.checked = 0;
+    t.joints.empty();
+    m_index->watch( s != NULL );
+  }
+
+  if ( s ) {
+    const int tolerance = (int)ceilf( JOINT_TOLERANCE );
+    t.moved.empty();
+    t.removed.empty();
+    m_index->takeMoved( t.moved, t.removed );
+    for ( int i=0; i<t.removed.size(); i++ ) {
+      t.drop( t.removed[i] );
+    }
+    // strokes that moved are tested against the whole stroke again
+    Rect reach = t.bbox;
+    reach.grow( tolerance );
+    for ( int i=0; t.checked && i<t.moved.size(); i++ ) {
+      Stroke* o = t.moved[i];
+      if ( o != s ) {
+	t.drop( o );
+	if ( reach.intersects( o->worldBbox() ) ) {
+	  s->determineJoints( o, t.joints );
+	  o->determineJoints( s, t.joints );
+	}
+      }
+    }
+
+    // then the new points: other strokes' ends near the new segments,
+    // and our ends near other strokes
+    const Path& path = s->worldPath();
+    int n = path.numPoints();
+    for ( int i=t.checked; i<n; i++ ) {
+      if ( i==0 ) {
+	t.bbox = Rect( path.point(0), path.point(0) );
+	continue;
+      }
+      Segment seg( path.point(i-1), path.point(i) );
+      t.bbox.expand( path.point(i) );
+      t.area.empty();
+      t.area.append( path.point(i-1) );
+      t.area.append( path.point(i) );
+      t.near.empty();
+      m_index->query( t.area, tolerance, t.near );
+      for ( int j=0; j<t.near.size(); j++ ) {
+	Stroke* o = t.near[j];
+	for ( unsigned char end=0; o!=s && end<2; end++ ) {
+	  if ( o->canJoin( s ) && !o->jointed( end )
+	       && seg.distanceTo( o->endpt( end ) ) <= JOINT_TOLERANCE ) {
+	    t.add( Joint( o, s, end ) );
+	  }
+	}
+      }
+    }
+    for ( unsigned char end=(t.checked ? 1 : 0); n > t.checked && end<2; end++ ) {
+      t.dropEnd( end );
+      t.area.empty();
+      t.area.append( s->endpt( end ) );
+      t.near.empty();
+      m_index->query( t.area, tolerance, t.near );
+      for ( int j=0; j<t.near.size(); j++ ) {
+	Stroke* o = t.near[j];
+	if ( o != s && s->canJoin( o ) && !s->jointed( end )
+	     && o->distanceTo( t.area[0] ) <= JOINT_TOLERANCE ) {
+	  t.add( Joint( s, o, end ) );
+	}
+      }
+    }
+    t.checked = n;
+  }
+
+  for ( int i=0; i<t.joints.size(); i++ ) {
+    pts.append( t.joints[i].joiner->endpt( t.joints[i].end ) );
+  }
+  for ( int i=0; i<pts.size(); i++ ) {
+    if ( t.shown.indexOf( pts[i] ) < 0 ) {
+      changed.add( Rect( pts[i], pts[i] ) );
+    }
+  }
+  for ( int i=0; i<t.shown.size(); i++ ) {
+    if ( pts.indexOf( t.shown[i] ) < 0 ) {
+      changed.add( Rect( t.shown[i], t.shown[i] ) );
+    }
+  }
+  t.shown = pts;
+  return changed;
+}
+
 bool Scene::activate( Stroke *s )
 {
   if ( s->numPoints() > 1 ) {
@@ -646,23 +1465,43 @@ void Scene::activateAll()
   for ( int i=0; i < m_strokes.size(); i++ ) {
     m_strokes[i]->createBodies( *m_world );
   }
-  for ( int i=0; i < m_strokes.size(); i++ ) {
-    createJoints( m_strokes[i] );
+  if ( m_jointsCompiled && m_strokes.size() == m_protect ) {
+    // a compiled level lists its joints in the order they were made
+    for ( int i=0; i < m_levelJoints.size(); i++ ) {
+      const LevelJoint& j = m_levelJoints[i];
+      if ( m_strokes[j.joiner]->body() && m_strokes[j.joinee]->body() ) {
+	m_strokes[j.joiner]->join( m_world, m_strokes[j.joinee], j.end );
+      }
+    }
+  } else {
+    m_levelJoints.empty();
+    for ( int i=0; i < m_strokes.size(); i++ ) {
+      createJoints( m_strokes[i], &m_levelJoints );
+    }
   }
+  m_jointsCompiled = false;
 }
 
-void Scene::createJoints( Stroke *s )
+void Scene::createJoints( Stroke *s, Array<LevelJoint>* made )
 {
   if ( s->body()==NULL ) {
     return;
   }
   Array<Joint> joints;
-  for ( int j=m_strokes.size()-1; j>=0; j-- ) {      
-    if ( s != m_strokes[j] && m_strokes[j]->body() ) {
+  Array<Stroke*> near;
+  m_index->query( s->worldPath(), (int)ceilf(JOINT_TOLERANCE), near );
+  for ( int j=near.size()-1; j>=0; j-- ) {      
+    if ( s != near[j] && near[j]->body() ) {
 	//printf("try join to %d\n",j);
-      s->determineJoints( m_strokes[j], joints );
-      m_strokes[j]->determineJoints( s, joints );
+      s->determineJoints( near[j], joints );
+      near[j]->determineJoints( s, joints );
       for ( int i=0; i<joints.size(); i++ ) {
+	if ( made && !joints[i].joiner->jointed( joints[i].end ) ) {
+	  LevelJoint j = { m_strokes.indexOf( joints[i].joiner ),
+			   m_strokes.indexOf( joints[i].joinee ),
+			   joints[i].end };
+	  made->append( j );
+	}
 	joints[i].joiner->join( m_world, joints[i].joinee, joints[i].end );
       }
       joints.empty();
@@ -672,47 +1511,356 @@ void Scene::createJoints( Stroke *s )
 
 void Scene::step( bool isPaused )
 {
+  finishStep();
+  for ( int i=0; i<m_strokes.size(); i++ ) {
+    m_strokes[i]->savePose();
+  }
   m_recorder.tick(isPaused);
   isPaused |= m_player.tick();
 
   if ( !isPaused ) {
-    if (m_accelerometer && m_dynamicGravity) {
+    // replays take their gravity from the log
+    if (m_accelerometer && m_dynamicGravity && !m_player.isRunning()) {
       float32 gx, gy, gz;
       if ( m_accelerometer->poll( gx, gy, gz ) ) {
-	
+	b2Vec2 g = m_currentGravity;
 	if (m_dynamicGravity || gx*gx+gy*gy > 1.2*1.2)  {
 	  //fprintf(stderr,"dynamic grav = %f,%f\n", gx, gy );
 	  const float32 factor = GRAVITY_ACCELf*PIXELS_PER_METREf/GRAVITY_FUDGEf;
-	  m_currentGravity = b2Vec2( m_gravity.x + gx*factor, 
-				     m_gravity.y + gy*factor );
-	  m_world->SetGravity( m_currentGravity );
+	  g = b2Vec2( m_gravity.x + gx*factor, m_gravity.y + gy*factor );
 	} else if (!(m_currentGravity == m_gravity)) {
-	  m_currentGravity += m_gravity;
-	  m_currentGravity *= 0.5;
-	  m_world->SetGravity( m_currentGravity );
+	  g += m_gravity;
+	  g *= 0.5;
+	}
+	if (!(g == m_currentGravity)) {
+	  // apply exactly what the log can reproduce
+	  int x = (int)floorf( g.x*ScriptEntry::GRAVITY_SCALE + 0.5f );
+	  int y = (int)floorf( g.y*ScriptEntry::GRAVITY_SCALE + 0.5f );
+	  applyGravity( b2Vec2( (float32)x/ScriptEntry::GRAVITY_SCALE,
+				(float32)y/ScriptEntry::GRAVITY_SCALE ) );
+	  m_recorder.gravity( x, y );
 	}
-	//TODO record gravity
       }
     }
 
-    m_world->Step( ITERATION_TIMESTEPf, SOLVER_ITERATIONS );
-    // clean up delete strokes
-    for ( int i=0; i< m_strokes.size(); i++ ) {
-      if ( m_strokes[i]->hasAttribute(ATTRIB_DELETED) ) {
-	m_strokes[i]->clearAttribute(ATTRIB_DELETED);
-	m_strokes[i]->hide();
-      }	   
-    }
-    // check for token respawn
-    for ( int i=0; i < m_strokes.size(); i++ ) {
-      if ( m_strokes[i]->hasAttribute( ATTRIB_TOKEN )
-	   && !BOUNDS_RECT.intersects( m_strokes[i]->worldBbox() ) ) {
-	reset( m_strokes[i] );
-	activate( m_strokes[i] );	  
+    m_stepping = true;
+    if ( PHYSICS_THREAD && !m_headless ) {
+      // step in the background, the rest waits for the next step or
+      // for anything else that needs the world
+      if ( !g_physicsThread ) {
+	g_physicsThread = new WorkerThread;
+      }
+      g_physicsThread->run( stepTask, this );
+    } else {
+      stepWorld();
+      finishStep();
+    }
+  }
+  calcDirtyArea();
+}
+
+void Scene::stepTask( void* scene )
+{
+  ((Scene*)scene)->stepWorld();
+}
+
+// Only the world is touched here, the strokes are left to finishStep.
+void Scene::stepWorld()
+{
+  if ( DETERMINISTIC ) {
+    // default rounding, no flush-to-zero
+    fesetenv( FE_DFL_ENV );
+  }
+  m_world->SetProfiling( PROFILE_PHYSICS );
+  m_world->Step( ITERATION_TIMESTEPf, SOLVER_ITERATIONS );
+}
+
+// Wait for the world step, then publish the new body poses, finish the
+// scene's side of the step and apply the edits held back meanwhile.
+void Scene::finishStep()
+{
+  if ( !m_stepping ) {
+    return;
+  }
+  if ( g_physicsThread && !m_headless ) {
+    g_physicsThread->wait();
+  }
+  m_stepping = false;
+  m_profile = m_world->GetProfile();
+
+  for ( int i=0; i<m_strokes.size(); i++ ) {
+    m_strokes[i]->updatePose();
+  }
+  for ( int i=0; i<m_goals.size(); i++ ) {
+    m_goals[i]->setAttribute(ATTRIB_DELETED);
+    m_recorder.goal(1);
+  }
+  m_goals.empty();
+
+  // clean up delete strokes
+  for ( int i=0; i< m_strokes.size(); i++ ) {
+    if ( m_strokes[i]->hasAttribute(ATTRIB_DELETED) ) {
+      m_strokes[i]->clearAttribute(ATTRIB_DELETED);
+      m_strokes[i]->hide();
+    }    
+  }
+  // check for token respawn
+  for ( int i=0; i < m_strokes.size(); i++ ) {
+    if ( m_strokes[i]->hasAttribute( ATTRIB_TOKEN )
+	 && !BOUNDS_RECT.intersects( m_strokes[i]->worldBbox() ) ) {
+      reset( m_strokes[i] );
+      activate( m_strokes[i] );         
+    }
+  }
+
+  if ( m_recorder.stateHashDue() || m_player.stateHashDue() ) {
+    uint32 hash = stateHash();
+    m_recorder.stateHash( hash );
+    m_player.checkStateHash( hash );
+  }
+
+  m_tick++;
+  if ( !m_headless && m_tick % REWIND_TICKS == 0 ) {
+    snapshot();
+  }
+
+  for ( int i=0; i<m_commands.size(); i++ ) {
+    const SceneCommand& c = m_commands[i];
+    switch ( c.op ) {
+    case SceneCommand::OP_MOVE:     moveStroke( c.stroke, c.pt ); break;
+    case SceneCommand::OP_DELETE:   deleteStroke( c.stroke );     break;
+    case SceneCommand::OP_ACTIVATE: activateStroke( c.stroke );   break;
+    }
+  }
+  m_commands.empty();
+}
+
+// Edits that touch the world wait while it is stepping.
+bool Scene::defer( SceneCommand::Op op, Stroke* s, const Vec2& pt )
+{
+  if ( m_stepping ) {
+    SceneCommand c;
+    c.op = op;
+    c.stroke = s;
+    c.pt = pt;
+    m_commands.append( c );
+    return true;
+  }
+  return false;
+}
+
+void Scene::snapshot()
+{
+  SceneSnapshot *snap;
+  if ( m_snapshots.size() >= REWIND_SNAPSHOTS ) {
+    snap = m_snapshots[0];
+    m_snapshots.erase(0);
+  } else {
+    snap = new SceneSnapshot;
+  }
+
+  snap->tick = m_tick;
+  snap->strokes = m_strokes;
+  while ( snap->states.size() < m_strokes.size() ) {
+    snap->states.append( new Stroke::State );
+  }
+  for ( int i=0; i<m_strokes.size(); i++ ) {
+    m_strokes[i]->save( *snap->states[i] );
+  }
+
+  snap->bodies.empty();
+  for ( b2Body* b = m_world->GetBodyList(); b; b = b->GetNext() ) {
+    snap->bodies.append( (Stroke*)b->GetUserData() );
+  }
+
+  // strokes only ever make revolute joints
+  snap->joints.empty();
+  for ( b2Joint* j = m_world->GetJointList(); j; j = j->GetNext() ) {
+    b2RevoluteJoint* rj = (b2RevoluteJoint*)j;
+    SceneSnapshot::JointState js;
+    js.stroke1 = (Stroke*)j->GetBody1()->GetUserData();
+    js.stroke2 = (Stroke*)j->GetBody2()->GetUserData();
+    js.def.localAnchor1 = rj->m_localAnchor1;
+    js.def.localAnchor2 = rj->m_localAnchor2;
+    js.def.referenceAngle = rj->m_referenceAngle;
+    js.def.enableLimit = rj->m_enableLimit;
+    js.def.lowerAngle = rj->m_lowerAngle;
+    js.def.upperAngle = rj->m_upperAngle;
+    js.def.enableMotor = rj->m_enableMotor;
+    js.def.motorSpeed = rj->m_motorSpeed;
+    js.def.maxMotorTorque = rj->m_maxMotorTorque;
+    snap->joints.append( js );
+  }
+
+  m_world->SaveState( &snap->world );
+  snap->recorder = m_recorder;
+  snap->player = m_player;
+  snap->logSize = m_log.size();
+  snap->stateHash = m_stateHash;
+  snap->gravity = m_gravity;
+  snap->currentGravity = m_currentGravity;
+
+  m_snapshots.append( snap );
+  releaseStrokes();
+}
+
+bool Scene::restore( SceneSnapshot* snap )
+{
+  // Restore in place if the same bodies and joints still exist,
+  // otherwise rebuild them from the snapshot first.
+  bool inPlace = snap->strokes.size() == m_strokes.size()
+    && snap->bodies.size() == m_world->GetBodyCount()
+    && snap->joints.size() == m_world->GetJointCount();
+  for ( int i=0; inPlace && i<m_strokes.size(); i++ ) {
+    inPlace = m_strokes[i] == snap->strokes[i]
+      && (m_strokes[i]->body()!=NULL) == snap->states[i]->hasBody;
+  }
+  m_staticDirty = true;
+  int n = 0;
+  for ( b2Body* b = m_world->GetBodyList(); inPlace && b; b = b->GetNext() ) {
+    inPlace = b->GetUserData() == snap->bodies[n++];
+  }
+  n = 0;
+  for ( b2Joint* j = m_world->GetJointList(); inPlace && j; j = j->GetNext() ) {
+    inPlace = j->GetBody1()->GetUserData() == snap->joints[n].stroke1
+      && j->GetBody2()->GetUserData() == snap->joints[n].stroke2;
+    n++;
+  }
+
+  bool ok = false;
+  if ( inPlace ) {
+    for ( int i=0; i<m_strokes.size(); i++ ) {
+      m_strokes[i]->restore( *snap->states[i] );
+    }
+    ok = m_world->RestoreState( &snap->world );
+  }
+
+  if ( !ok ) {
+    // strokes drawn since are dropped, deleted ones come back
+    for ( int i=0; i<m_strokes.size(); i++ ) {
+      m_strokes[i]->reset();
+      if ( snap->strokes.indexOf( m_strokes[i] ) < 0 ) {
+	m_index->remove( m_strokes[i] );
+	m_deletedStrokes.append( m_strokes[i] );
+      }
+    }
+    m_strokes = snap->strokes;
+    for ( int i=0; i<m_strokes.size(); i++ ) {
+      m_index->add( m_strokes[i] );
+      m_deletedStrokes.erase( m_deletedStrokes.indexOf( m_strokes[i] ) );
+      m_retiredStrokes.erase( m_retiredStrokes.indexOf( m_strokes[i] ) );
+      m_strokes[i]->reset();
+      m_strokes[i]->restore( *snap->states[i] );
+    }
+
+    // the world prepends, so create in reverse; the ground body
+    // comes with the world and is always last
+    resetWorld();
+    for ( int i=snap->bodies.size()-1; i>=0; i-- ) {
+      if ( snap->bodies[i] ) {
+	snap->bodies[i]->createBodies( *m_world );
       }
     }
+    for ( int i=snap->joints.size()-1; i>=0; i-- ) {
+      SceneSnapshot::JointState& js = snap->joints[i];
+      js.def.body1 = js.stroke1 ? js.stroke1->body() : m_world->GetGroundBody();
+      js.def.body2 = js.stroke2 ? js.stroke2->body() : m_world->GetGroundBody();
+      m_world->CreateJoint( &js.def );
+    }
+    ok = m_world->RestoreState( &snap->world );
+  }
+  for ( int i=0; i<m_strokes.size(); i++ ) {
+    m_strokes[i]->updatePose( true );
+  }
+
+  m_gravity = snap->gravity;
+  applyGravity( snap->currentGravity );
+  m_recorder = snap->recorder;
+  m_player = snap->player;
+  if ( m_log.size() > snap->logSize ) {
+    m_log.trim( m_log.size() - snap->logSize );
+  }
+  m_stateHash = snap->stateHash;
+  m_tick = snap->tick;
+
+  // later snapshots belong to a future that is gone now
+  while ( m_snapshots[m_snapshots.size()-1] != snap ) {
+    delete m_snapshots[m_snapshots.size()-1];
+    m_snapshots.erase( m_snapshots.size()-1 );
   }
+  releaseStrokes();
   calcDirtyArea();
+  return ok;
+}
+
+bool Scene::seek( int tick )
+{
+  finishStep();
+  if ( tick < 0 ) {
+    tick = 0;
+  }
+  if ( tick < m_tick ) {
+    int i = m_snapshots.size()-1;
+    while ( i >= 0 && m_snapshots[i]->tick > tick ) {
+      i--;
+    }
+    if ( i < 0 || !restore( m_snapshots[i] ) ) {
+      return false;
+    }
+  }
+  while ( m_tick < tick ) {
+    step();
+  }
+  return true;
+}
+
+bool Scene::snapshotted( Stroke* s )
+{
+  for ( int i=0; i<m_snapshots.size(); i++ ) {
+    if ( m_snapshots[i]->strokes.indexOf( s ) >= 0 ) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// deleted strokes live on while a snapshot can bring them back
+void Scene::releaseStrokes()
+{
+  for ( int i=m_retiredStrokes.size()-1; i>=0; i-- ) {
+    if ( !snapshotted( m_retiredStrokes[i] ) ) {
+      delete m_retiredStrokes[i];
+      m_retiredStrokes.erase( i );
+    }
+  }
+}
+
+void Scene::clearSnapshots()
+{
+  while ( m_snapshots.size() ) {
+    delete m_snapshots[0];
+    m_snapshots.erase(0);
+  }
+  while ( m_retiredStrokes.size() ) {
+    delete m_retiredStrokes[0];
+    m_retiredStrokes.erase(0);
+  }
+}
+
+// Fold the bit patterns of every body transform into the running hash
+// (FNV-1a), so a replay that strays once never matches again.
+uint32 Scene::stateHash()
+{
+  uint32 hash = m_stateHash ^ 2166136261u;
+  for ( b2Body* b = m_world->GetBodyList(); b; b = b->GetNext() ) {
+    float32 state[3] = { b->GetPosition().x, b->GetPosition().y, b->GetAngle() };
+    const unsigned char* bytes = (const unsigned char*)state;
+    for ( int i=0; i<(int)sizeof(state); i++ ) {
+      hash = (hash ^ bytes[i]) * 16777619u;
+    }
+  }
+  m_stateHash = hash;
+  return hash;
 }
 
 // b2ContactListener callback when a new contact is detected
@@ -728,8 +1876,8 @@ void Scene::Add(const b2ContactPoint* point)
     }
     if ( s1->hasAttribute(ATTRIB_TOKEN) 
 	   && s2->hasAttribute(ATTRIB_GOAL) ) {
-	s2->setAttribute(ATTRIB_DELETED);
-	m_recorder.goal(1);
+	// this may be the physics thread, finishStep marks the goal
+	m_goals.append( s2 );
     }
   }
 }
@@ -746,61 +1894,114 @@ bool Scene::isCompleted()
   return true;
 }
 
-Rect Scene::dirtyArea()
+void Scene::setInterpolation( float32 alpha )
+{
+  for ( int i=0; i<m_strokes.size(); i++ ) {
+    m_strokes[i]->interpolate( alpha );
+  }
+  calcDirtyArea();
+}
+
+const Region& Scene::dirtyArea()
 {
   return m_dirtyArea;
 }
 
 void Scene::calcDirtyArea()
 {
-  Rect r(false);
+  Region r;
+  int n = 0;
   for ( int i=0; i<m_strokes.size(); i++ ) {
-    if ( m_strokes[i]->isDirty() ) {
+    bool dirty = m_strokes[i]->isDirty();
+    if ( dirty ) {
       // acumulate new areas to draw
-      r.expand( m_strokes[i]->screenBbox() );
+      r.add( m_strokes[i]->screenBbox() );
       // plus prev areas to erase
-      r.expand( m_strokes[i]->lastDrawnBbox() );
+      r.add( m_strokes[i]->lastDrawnBbox() );
+    }
+    if ( m_strokes[i]->isStatic() ) {
+      // the static layer is redrawn when its strokes change
+      if ( dirty || n >= m_staticStrokes.size()
+	   || m_staticStrokes[n] != m_strokes[i] ) {
+	m_staticDirty = true;
+      }
+      n++;
     }
   }
-  for ( int i=0; i<m_deletedStrokes.size(); i++ ) {
-    // acumulate new areas to draw
-    r.expand( m_strokes[i]->lastDrawnBbox() );
+  if ( n != m_staticStrokes.size() ) {
+    m_staticDirty = true;
   }
-  if ( !r.isEmpty() ) {
-    // expand to allow for thick lines
-    r.grow(1);
+  for ( int i=0; i<m_deletedStrokes.size(); i++ ) {
+    // acumulate old areas to erase
+    r.add( m_deletedStrokes[i]->lastDrawnBbox() );
   }
-  //fprintf(stderr,"scene dirty %d,%d-%d,%d!\n",r.tl.x,r.tl.y,r.br.x,r.br.y);
+  // expand to allow for thick lines
+  r.grow(1);
   m_dirtyArea = r;
 }
+// Draw the background and the static strokes into a canvas of their
+// own, which the scene is then cleared to.
+void Scene::drawStaticLayer( Canvas& canvas )
+{
+  if ( m_staticLayer && ( m_staticLayer->width() != canvas.width()
+			  || m_staticLayer->height() != canvas.height() ) ) {
+    delete m_staticLayer;
+    m_staticLayer = NULL;
+  }
+  if ( !m_staticLayer ) {
+    m_staticLayer = new Canvas( canvas.width(), canvas.height() );
+  }
+  m_staticLayer->setBackground( m_bgImage );
+  m_staticLayer->setBackground( 0 );
+  m_staticLayer->clear();
+  m_staticStrokes.empty();
+  for ( int i=0; i<m_strokes.size(); i++ ) {
+    if ( m_strokes[i]->isStatic() ) {
+      m_strokes[i]->draw( *m_staticLayer );
+      m_staticStrokes.append( m_strokes[i] );
+    }
+  }
+  m_staticDirty = false;
+}
+
 void Scene::draw( Canvas& canvas, const Rect& area )
 {
-  if ( m_bgImage ) {
-    canvas.setBackground( m_bgImage );
-  } else {
-    canvas.setBackground( 0 );
+  if ( m_staticDirty || !m_staticLayer
+       || m_staticLayer->width() != canvas.width()
+       || m_staticLayer->height() != canvas.height() ) {
+    drawStaticLayer( canvas );
   }
+  canvas.setBackground( m_staticLayer );
   canvas.clear( area );
-  Rect clipArea = area;
-  clipArea.tl.x--;
-  clipArea.tl.y--;
-  clipArea.br.x++;
-  clipArea.br.y++;
+  // leave the canvas as we found it rather than with our layer
+  canvas.setBackground( m_bgImage );
+  canvas.setBackground( 0 );
   for ( int i=0; i<m_strokes.size(); i++ ) {
-    if ( area.intersects( m_strokes[i]->screenBbox() ) ) {
+    if ( !m_strokes[i]->isStatic()
+	 && area.intersects( m_strokes[i]->screenBbox() ) ) {
 	m_strokes[i]->draw( canvas );
     }
   }
   while ( m_deletedStrokes.size() ) {
-    delete m_deletedStrokes[0];
+    if ( snapshotted( m_deletedStrokes[0] ) ) {
+      m_retiredStrokes.append( m_deletedStrokes[0] );
+    } else {
+      delete m_deletedStrokes[0];
+    }
     m_deletedStrokes.erase(0);
   }
 }
 
 void Scene::reset( Stroke* s, bool purgeUnprotected )
 {
+  finishStep();
+  if ( s==NULL ) {
+    m_staticDirty = true;
+    m_jointsCompiled = false; // the paths are processed afresh
+  }
   while ( purgeUnprotected && m_strokes.size() > m_protect ) {
     m_strokes[m_strokes.size()-1]->reset(m_world);
+    m_index->remove( m_strokes[m_strokes.size()-1] );
     m_strokes.erase( m_strokes.size()-1 );
   }
   for ( int i=0; i<m_strokes.size(); i++ ) {
@@ -812,20 +2013,13 @@ void Scene::reset( Stroke* s, bool purgeUnprotected )
 
 Stroke* Scene::strokeAtPoint( const Vec2 pt, float32 max )
 {
-  Stroke* best = NULL;
-  for ( int i=0; i<m_strokes.size(); i++ ) {
-    float32 d = m_strokes[i]->distanceTo( pt );
-    //printf("stroke %d dist %f\n",i,d);
-    if ( d < max ) {
-	max = d;
-	best = m_strokes[i];
-    }
-  }
-  return best;
+  return m_index->nearest( pt, max );
 }
 
 void Scene::clear()
 {
+  finishStep();
+  clearSnapshots();
   reset();
   while ( m_strokes.size() ) {
     delete m_strokes[0];
@@ -844,12 +2038,21 @@ void Scene::clear()
 
 void Scene::setGravity( const b2Vec2& g )
 {
+  finishStep();
   m_gravity = m_currentGravity = g;
   if (m_world) {
     m_world->SetGravity( m_gravity );
   }
 }
 
+void Scene::applyGravity( const b2Vec2& g )
+{
+  m_currentGravity = g;
+  if (m_world) {
+    m_world->SetGravity( m_currentGravity );
+  }
+}
+
 void Scene::setGravity( const std::string& s )
 {
   for (int i=0; i<s.find(':'); i++) {
@@ -871,11 +2074,38 @@ void Scene::setGravity( const std::string& s )
   }
 }
 
-bool Scene::load( unsigned char *buf, int bufsize )
+// Parse the level in place, a line at a time.
+bool Scene::load( const unsigned char *buf, int bufsize )
 {
-  std::string s( (const char*)buf, bufsize );
-  std::stringstream in( s, std::ios::in );
-  return load( in );
+  clear();
+  resetWorld();
+  m_dynamicGravity = false;
+  if ( !m_headless ) {
+    if ( g_bgImage==NULL ) {
+      g_bgImage = new Image("paper.png");
+      g_bgImage->scale( SCREEN_WIDTH, SCREEN_HEIGHT );
+    }
+    m_bgImage = g_bgImage;
+  }
+  if ( bufsize >= 4 && memcmp( buf, &COMPILED_MAGIC, 4 )==0 ) {
+    CompiledReader in( buf, bufsize );
+    return loadCompiled( in );
+  }
+  const char* s = (const char*)buf;
+  const char* end = s + bufsize;
+  for (;;) {
+    const char* eol = (const char*)memchr( s, '\n', end-s );
+    parseLine( s, eol ? eol : end );
+    if ( eol==NULL ) {
+      break;
+    }
+    s = eol+1;
+  }
+  protect();
+  if ( !m_headless ) {
+    printf("loaded log=%d\n",m_log.size());
+  }
+  return true;
 }
 
 bool Scene::load( const std::string& file )
@@ -886,27 +2116,26 @@ bool Scene::load( const std::string& file )
 
 bool Scene::load( std::istream& in )
 {
-  clear();
-  resetWorld();
-  m_dynamicGravity = false;
-  if ( g_bgImage==NULL ) {
-    g_bgImage = new Image("paper.png");
-    g_bgImage->scale( SCREEN_WIDTH, SCREEN_HEIGHT );
-  }
-  m_bgImage = g_bgImage;
-  std::string line;
-  while ( !in.eof() ) {
-    getline( in, line );
-    parseLine( line );
-  }
-  protect();
-  printf("loaded log=%d\n",m_log.size());
-  return true;
+  std::string buf( (std::istreambuf_iterator<char>( in )),
+		   std::istreambuf_iterator<char>() );
+  return load( (const unsigned char*)buf.data(), buf.size() );
 }
 
 
 void Scene::start( bool replay )
 {
+  finishStep();
+  if ( replay ) {
+    // Proxy ids, and so the contact order, depend on the world's
+    // history: replay in a fresh world, like the recording.
+    b2Vec2 gravity = m_gravity;
+    reset();
+    resetWorld();
+    setGravity( gravity );
+  }
+  m_stateHash = 0;
+  m_tick = 0;
+  clearSnapshots();
   activateAll();
   if ( replay ) {
     m_recorder.stop();
@@ -915,19 +2144,29 @@ void Scene::start( bool replay )
     m_player.stop();
     m_recorder.start( &m_log );
   }
+  if ( !m_headless ) {
+    snapshot();
+  }
 }
 
 
-bool Scene::parseLine( const std::string& line )
+bool Scene::parseLine( const char* line, const char* end )
 {
+  if ( line==end ) {
+    return false;
+  }
+  // the text after the first colon, or the whole line without one
+  const char* value = (const char*)memchr( line, ':', end-line );
+  value = value ? value+1 : line;
   try {
     switch( line[0] ) {
-    case 'T': m_title = line.substr(line.find(':')+1);  return true;
-    case 'B': m_bg = line.substr(line.find(':')+1);     return true;
-    case 'A': m_author = line.substr(line.find(':')+1); return true;
-    case 'S': m_strokes.append( new Stroke(line) );     return true;
-    case 'G': setGravity(line);                         return true;
-    case 'E': m_log.append(line.substr(line.find(':')+1));return true;
+    case 'T': m_title.assign( value, end );             return true;
+    case 'B': m_bg.assign( value, end );                return true;
+    case 'A': m_author.assign( value, end );            return true;
+    case 'S': addStroke( new Stroke( line, end ) );     return true;
+    // one of these a level at most, or one a logged event
+    case 'G': setGravity( std::string( line, end ) );   return true;
+    case 'E': m_log.append( std::string( value, end ) ); return true;
     }
   } catch ( const char* e ) {
     printf("Stroke error: %s\n",e);
@@ -935,6 +2174,108 @@ bool Scene::parseLine( const std::string& line )
   return false;
 }
 
+// The level comes straight out of the buffer: paths are copied whole
+// and the strokes need no processing or joint search to activate.
+bool Scene::loadCompiled( CompiledReader& in )
+{
+  if ( in.word() != COMPILED_MAGIC || in.word() != COMPILED_VERSION ) {
+    printf("unknown compiled level version\n");
+    return false;
+  }
+  m_title = in.string();
+  m_author = in.string();
+  m_bg = in.string();
+  m_levelJoints.empty();
+  m_dynamicGravity = in.word() != 0;
+  float32 gx = in.real();
+  float32 gy = in.real();
+  setGravity( b2Vec2( gx, gy ) );
+  int n = in.word();
+  try {
+    for ( int i=0; i<n && in.ok(); i++ ) {
+      addStroke( new Stroke( in ) );
+    }
+  } catch ( const char* e ) {
+    printf("Stroke error: %s\n",e);
+    return false;
+  }
+  n = in.word();
+  for ( int i=0; i<n && in.ok(); i++ ) {
+    LevelJoint j;
+    j.joiner = in.word();
+    j.joinee = in.word();
+    j.end = in.word();
+    if ( j.joiner >= 0 && j.joiner < m_strokes.size()
+	 && j.joinee >= 0 && j.joinee < m_strokes.size()
+	 && ( j.end==0 || j.end==1 ) ) {
+      m_levelJoints.append( j );
+    }
+  }
+  n = in.word();
+  for ( int i=0; i<n && in.ok(); i++ ) {
+    int t = in.word();
+    ScriptEntry::Op op = (ScriptEntry::Op)in.word();
+    int stroke = in.word();
+    int arg1 = in.word();
+    int arg2 = in.word();
+    int x = in.word();
+    int y = in.word();
+    m_log.append( t, op, stroke, arg1, arg2, Vec2( x, y ) );
+  }
+  if ( !in.ok() ) {
+    printf("truncated compiled level\n");
+    return false;
+  }
+  m_jointsCompiled = true;
+  protect();
+  return true;
+}
+
+bool Scene::saveCompiled( const std::string& file )
+{
+  // the shape paths and joints only exist once the level is activated
+  finishStep();
+  activateAll();
+
+  CompiledWriter out;
+  out.word( COMPILED_MAGIC );
+  out.word( COMPILED_VERSION );
+  out.string( m_title );
+  out.string( m_author );
+  out.string( m_bg );
+  out.word( m_dynamicGravity );
+  out.real( m_gravity.x );
+  out.real( m_gravity.y );
+  out.word( m_strokes.size() );
+  for ( int i=0; i<m_strokes.size(); i++ ) {
+    m_strokes[i]->compile( out );
+  }
+  out.word( m_levelJoints.size() );
+  for ( int i=0; i<m_levelJoints.size(); i++ ) {
+    out.word( m_levelJoints[i].joiner );
+    out.word( m_levelJoints[i].joinee );
+    out.word( m_levelJoints[i].end );
+  }
+  out.word( m_log.size() );
+  for ( int i=0; i<m_log.size(); i++ ) {
+    const ScriptEntry& e = m_log[i];
+    out.word( e.t );
+    out.word( e.op );
+    out.word( e.stroke );
+    out.word( e.arg1 );
+    out.word( e.arg2 );
+    out.word( e.pt.x );
+    out.word( e.pt.y );
+  }
+
+  std::ofstream o( file.c_str(), std::ios::out | std::ios::binary );
+  if ( !o.is_open() ) {
+    return false;
+  }
+  o.write( out.bytes().data(), out.bytes().size() );
+  return o.good();
+}
+
 void Scene::protect( int n )
 {
   m_protect = (n==-1 ? m_strokes.size() : n );
@@ -967,4 +2308,6 @@ bool Scene::save( const std::string& file, bool saveLog )
 
 
 Image *Scene::g_bgImage = NULL;
+WorkerPool *Scene::g_workerPool = NULL;
+WorkerThread *Scene::g_physicsThread = NULL;
 
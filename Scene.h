@@ -17,6 +17,7 @@
 #include "Array.h"
 #include "Path.h"
 #include "Canvas.h"
+#include "Region.h"
 #include "Script.h"
 
 #include <string>
@@ -24,8 +25,28 @@
 
 
 class Stroke;
+class CompiledReader;
 class b2World;
 class Accelerometer;
+class WorkerPool;
+class WorkerThread;
+class StrokeIndex;
+struct JointTracker;
+struct SceneSnapshot;
+
+// A stroke edit that touches the world, held back while the world is
+// stepping on the physics thread.
+struct SceneCommand
+{
+  enum Op {
+    OP_MOVE,
+    OP_DELETE,
+    OP_ACTIVATE
+  };
+  Op      op;
+  Stroke *stroke;
+  Vec2    pt;
+};
 
 typedef enum {
   ATTRIB_DUMMY = 0,
@@ -54,6 +75,10 @@ public:
   void moveStroke( Stroke* s, const Vec2& origin );
   bool activateStroke( Stroke *s );
   void getJointCandidates( Stroke* s, Path& pts );
+  // the joint candidates of s, the stroke being drawn, kept up to date
+  // between calls; returns the area of candidates that came or went
+  // since the last call, calling with NULL stops tracking
+  Region trackJointCandidates( Stroke* s, Path& pts );
 
   int numStrokes() {
     return m_strokes.size();
@@ -64,8 +89,11 @@ public:
   }
 
   void step( bool isPaused=false );
+  // draw strokes alpha of the way from the pose before the last step
+  // to the current one
+  void setInterpolation( float32 alpha );
   bool isCompleted();
-  Rect dirtyArea();
+  const Region& dirtyArea();
   void draw( Canvas& canvas, const Rect& area );
   void reset( Stroke* s=NULL,  bool purgeUnprotected=false );
   Stroke* strokeAtPoint( const Vec2 pt, float32 max );
@@ -73,23 +101,56 @@ public:
 
   void setGravity( const b2Vec2& g );
   void setGravity( const std::string& s );
+  // change the current gravity, leaving the level's gravity untouched
+  void applyGravity( const b2Vec2& g );
 
-  bool load( unsigned char *buf, int bufsize );
+  bool load( const unsigned char *buf, int bufsize );
   bool load( const std::string& file );
   bool load( std::istream& in );
   void start( bool replay=false );
+  // physics steps since start
+  int tick() const { return m_tick; }
+  // go back to the latest snapshot at or before tick, then step forward
+  bool seek( int tick );
+  // headless scenes are only simulated, never drawn
+  void setHeadless( bool headless ) { m_headless = headless; }
   void protect( int n=-1 );
   bool save( const std::string& file, bool saveLog=false );
+  // write the level as loaded to a compiled .npb file, activating it
+  bool saveCompiled( const std::string& file );
 
   ScriptLog* getLog() { return &m_log; }
   const ScriptPlayer* replay() { return &m_player; }
+  const b2Profile* profile() const {
+    return m_world ? &m_profile : NULL;
+  }
 private:
   void resetWorld();
+  static void stepTask( void* scene );
+  void stepWorld();
+  void finishStep();
+  bool defer( SceneCommand::Op op, Stroke* s, const Vec2& pt=Vec2(0,0) );
+  void addStroke( Stroke* s );
   bool activate( Stroke *s );
   void activateAll();
-  void createJoints( Stroke *s );
-  bool parseLine( const std::string& line );
+  // a joint made when the level was activated, by stroke index
+  struct LevelJoint
+  {
+    int joiner;
+    int joinee;
+    int end;
+  };
+  void createJoints( Stroke *s, Array<LevelJoint>* made=NULL );
+  bool loadCompiled( CompiledReader& in );
+  bool parseLine( const char* line, const char* end );
   void calcDirtyArea();
+  void drawStaticLayer( Canvas& canvas );
+  uint32 stateHash();
+  void snapshot();
+  bool restore( SceneSnapshot* snap );
+  bool snapshotted( Stroke* s );
+  void releaseStrokes();
+  void clearSnapshots();
 
   // b2ContactListener callback when a new contact is detected
   virtual void Add(const b2ContactPoint* point) ;
@@ -104,12 +165,30 @@ private:
   ScriptPlayer    m_player;
   Image          *m_bgImage;
   static Image   *g_bgImage;
+  static WorkerPool *g_workerPool;
+  static WorkerThread *g_physicsThread;
   int             m_protect;
   b2Vec2          m_gravity;
   b2Vec2          m_currentGravity;
   bool            m_dynamicGravity;
   Accelerometer  *m_accelerometer;
-  Rect            m_dirtyArea;
+  Region          m_dirtyArea;
+  bool            m_headless;
+  uint32          m_stateHash;
+  int             m_tick;
+  Canvas         *m_staticLayer;         // background plus static strokes
+  Array<Stroke*>  m_staticStrokes;       // drawn into the static layer
+  bool            m_staticDirty;
+  Array<SceneSnapshot*> m_snapshots;     // rewind ring, oldest first
+  Array<Stroke*>  m_retiredStrokes;      // deleted, but in a snapshot
+  bool            m_stepping;            // the world step is unfinished
+  Array<SceneCommand> m_commands;        // held back until it finishes
+  Array<Stroke*>  m_goals;               // goals hit during the step
+  b2Profile       m_profile;
+  Array<LevelJoint> m_levelJoints;       // of the last activateAll
+  bool            m_jointsCompiled;      // m_levelJoints came with the level
+  StrokeIndex    *m_index;               // for finding strokes by position
+  JointTracker   *m_tracker;             // of the stroke being drawn
 };
 
 
@@ -132,6 +211,16 @@ public:
       vec = Vec2( b2Mul( m_rot, vec ) ) + m_pos;
     }
   }
+  // as a b2XForm for Path::transform
+  b2XForm xform() const {
+    b2XForm xf;
+    if ( m_bypass ) {
+      xf.SetIdentity();
+    } else {
+      xf = b2XForm( m_pos, m_rot );
+    }
+    return xf;
+  }
   inline void inverseTransform( Vec2& vec ) {
     if ( !m_bypass ) {
       vec = Vec2( b2Mul( m_invrot, vec-m_pos ) );
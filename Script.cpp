@@ -16,6 +16,7 @@
 #include "Script.h"
 #include "Path.h"
 #include "Scene.h"
+#include "Config.h"
 #include <sstream>
 #include <cstdio>
 
@@ -34,6 +35,8 @@ ScriptEntry::ScriptEntry( const std::string& str )
     case 'a': op = OP_ACTIVATE; break;
     case 'p': op = OP_PAUSE; break;
     case 'g': op = OP_GOAL; break;
+    case 'G': op = OP_GRAVITY; break;
+    case 'h': op = OP_HASH; break;
     default:
       fprintf(stderr,"bad script op\n");
     }
@@ -45,7 +48,7 @@ ScriptEntry::ScriptEntry( const std::string& str )
 
 std::string ScriptEntry::asString()
 {
-  static const char opcodes[] = "ndemapg";
+  static const char opcodes[] = "ndemapgGh";
   std::stringstream s;
   s << t << "," << opcodes[op] << ","
     << stroke << "," << arg1 << "," << arg2 << ","
@@ -150,6 +153,23 @@ void ScriptRecorder::goal( int goalNum )
     m_log->append( m_lastTick, ScriptEntry::OP_GOAL, goalNum );
 }
 
+void ScriptRecorder::gravity( int x, int y )
+{
+  if ( m_running )
+    m_log->append( m_lastTick, ScriptEntry::OP_GRAVITY, 0, x, y );
+}
+
+void ScriptRecorder::stateHash( uint32 hash )
+{
+  if ( m_running )
+    m_log->append( m_lastTick, ScriptEntry::OP_HASH, 0, (int)hash );
+}
+
+bool ScriptRecorder::stateHashDue() const
+{
+  return m_running && m_lastTick % STATE_HASH_TICKS == 0;
+}
+
 
 
 void ScriptPlayer::start( const ScriptLog* log, Scene* scene )
@@ -160,6 +180,9 @@ void ScriptPlayer::start( const ScriptLog* log, Scene* scene )
   m_index = 0;
   m_lastTick = 0;
   m_scene = scene;
+  m_hashTick = -1;
+  m_hash = 0;
+  m_divergedTick = -1;
   printf("start playback: %d events\n",m_log->size());
 }
 
@@ -202,6 +225,17 @@ bool ScriptPlayer::tick()
       case ScriptEntry::OP_PAUSE:
 	m_isPaused = (e.stroke != 0);
 	break;
+      case ScriptEntry::OP_GRAVITY:
+	m_scene->applyGravity( b2Vec2( (float32)e.arg1/ScriptEntry::GRAVITY_SCALE,
+				       (float32)e.arg2/ScriptEntry::GRAVITY_SCALE ) );
+	break;
+      case ScriptEntry::OP_HASH:
+	// checked once the scene has stepped this tick
+	m_hashTick = e.t;
+	m_hash = (uint32)e.arg1;
+	break;
+      default:
+	break;
       }
       m_index++;
     }
@@ -211,3 +245,16 @@ bool ScriptPlayer::tick()
 }
 
 
+
+bool ScriptPlayer::stateHashDue() const
+{
+  return m_playing && m_hashTick == m_lastTick;
+}
+
+void ScriptPlayer::checkStateHash( uint32 hash )
+{
+  if ( stateHashDue() && hash != m_hash && m_divergedTick < 0 ) {
+    m_divergedTick = m_lastTick;
+    fprintf(stderr,"replay diverged at tick %d\n",m_divergedTick);
+  }
+}
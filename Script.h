@@ -29,9 +29,14 @@ struct ScriptEntry {
     OP_MOVE,
     OP_ACTIVATE,
     OP_PAUSE,
-    OP_GOAL
+    OP_GOAL,
+    OP_GRAVITY,
+    OP_HASH
   };
 
+  // gravity is logged in thousandths, replays apply the rounded value
+  static const int GRAVITY_SCALE = 1000;
+
   int  t;
   Op   op;
   int  stroke;
@@ -42,7 +47,7 @@ struct ScriptEntry {
   ScriptEntry( int _t, Op _op, int _stroke,
 	     int _arg1, int _arg2, const Vec2& _pt ) 
   : t(_t), op(_op), stroke(_stroke),
-    arg1(_arg1), arg2(arg2), pt(_pt)
+    arg1(_arg1), arg2(_arg2), pt(_pt)
   {}
   ScriptEntry() {};
   ScriptEntry( const std::string& str );
@@ -74,6 +79,9 @@ public:
   void moveStroke( int index, const Vec2& pt );
   void activateStroke( int index );
   void goal( int goalNum );
+  void gravity( int x, int y );
+  void stateHash( uint32 hash );
+  bool stateHashDue() const;
 
   ScriptLog* getLog() { return m_log; }
 
@@ -93,6 +101,10 @@ public:
   bool isRunning() const;
   void stop();
   bool tick(); 
+  bool stateHashDue() const;
+  void checkStateHash( uint32 hash );
+  // first tick whose state hash differs from the log, or -1
+  int divergedTick() const { return m_divergedTick; }
 
 private:
   bool           m_playing;
@@ -101,6 +113,9 @@ private:
   Scene         *m_scene;
   int            m_index;
   int  		 m_lastTick;
+  int            m_hashTick;
+  uint32         m_hash;
+  int            m_divergedTick;
 };
 
 
@@ -591,6 +591,7 @@ bool Draggable::onPreEvent( Event& ev )
       return result;
     }
     break;
+  default: break;
   }
   return false;
 }
@@ -753,14 +754,14 @@ bool Container::isDirty()
   return false;
 }
 
-Rect Container::dirtyArea()
+Region Container::dirtyArea()
 {
   if (m_dirty) {
     return m_pos;
   }
-  Rect r(false);
+  Region r;
   for (int i=0; i<m_children.size(); ++i) {
-    r.expand(m_children[i]->dirtyArea());
+    r.add(m_children[i]->dirtyArea());
   }
   return r;
 }
@@ -19,6 +19,7 @@
 
 #include "Common.h"
 #include "Array.h"
+#include "Region.h"
 #include "Event.h"
 
 #include <string>
@@ -42,7 +43,7 @@ class Widget
   virtual void sizeTo( const Vec2& size );
   virtual const Rect& position() const { return m_pos; }
   virtual bool isDirty() {return m_dirty;}
-  virtual Rect dirtyArea() {return m_dirty?m_pos:Rect(false);};
+  virtual Region dirtyArea() {return m_dirty?Region(m_pos):Region();};
   virtual void onTick( int tick ) {}
   virtual void draw( Canvas& screen, const Rect& area );
   virtual bool processEvent( SDL_Event& ev );
@@ -190,7 +191,7 @@ class Container : public WidgetParent
   virtual std::string toString();
   virtual void move( const Vec2& by );
   virtual bool isDirty();
-  virtual Rect dirtyArea();
+  virtual Region dirtyArea();
   virtual void onTick( int tick );
   virtual void draw( Canvas& screen, const Rect& area );
   virtual bool processEvent( SDL_Event& ev );
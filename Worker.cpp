@@ -65,3 +65,189 @@ int WorkerBase::startThread(void* wbase)
   event.user.data2 = 0;
   SDL_PushEvent(&event);
 }
+
+
+struct WorkerStart
+{
+  WorkerPool* pool;
+  int         worker;
+};
+
+WorkerPool::WorkerPool( int threads )
+  : m_threadCount( threads > 1 ? threads-1 : 0 ),
+    m_threads( NULL ),
+    m_mutex( SDL_CreateMutex() ),
+    m_start( SDL_CreateCond() ),
+    m_finish( SDL_CreateCond() ),
+    m_quit( false ),
+    m_generation( 0 ),
+    m_busy( 0 ),
+    m_task( NULL ),
+    m_context( NULL ),
+    m_count( 0 ),
+    m_next( 0 )
+{
+  if ( m_threadCount > 0 ) {
+    m_threads = new SDL_Thread*[m_threadCount];
+    for ( int i=0; i<m_threadCount; i++ ) {
+      WorkerStart* start = new WorkerStart;
+      start->pool = this;
+      start->worker = i+1;
+      m_threads[i] = SDL_CreateThread( startThread, start );
+    }
+  }
+}
+
+WorkerPool::~WorkerPool()
+{
+  SDL_LockMutex( m_mutex );
+  m_quit = true;
+  SDL_CondBroadcast( m_start );
+  SDL_UnlockMutex( m_mutex );
+  for ( int i=0; i<m_threadCount; i++ ) {
+    SDL_WaitThread( m_threads[i], NULL );
+  }
+  delete [] m_threads;
+  SDL_DestroyCond( m_finish );
+  SDL_DestroyCond( m_start );
+  SDL_DestroyMutex( m_mutex );
+}
+
+int32 WorkerPool::GetWorkerCount() const
+{
+  return m_threadCount + 1;
+}
+
+void WorkerPool::Run( b2WorkerTask* task, void* context, int32 count )
+{
+  SDL_LockMutex( m_mutex );
+  m_task = task;
+  m_context = context;
+  m_count = count;
+  m_next = 0;
+  m_busy = m_threadCount;
+  m_generation++;
+  SDL_CondBroadcast( m_start );
+  SDL_UnlockMutex( m_mutex );
+
+  work( 0 );
+
+  SDL_LockMutex( m_mutex );
+  while ( m_busy > 0 ) {
+    SDL_CondWait( m_finish, m_mutex );
+  }
+  SDL_UnlockMutex( m_mutex );
+}
+
+// Take task indices until the batch is exhausted.
+void WorkerPool::work( int worker )
+{
+  while ( true ) {
+    SDL_LockMutex( m_mutex );
+    int index = m_next < m_count ? m_next++ : -1;
+    SDL_UnlockMutex( m_mutex );
+    if ( index < 0 ) {
+      break;
+    }
+    m_task( m_context, index, worker );
+  }
+}
+
+int WorkerPool::startThread( void* arg )
+{
+  WorkerStart* start = (WorkerStart*)arg;
+  WorkerPool* pool = start->pool;
+  int worker = start->worker;
+  delete start;
+
+  int generation = 0;
+  SDL_LockMutex( pool->m_mutex );
+  while ( true ) {
+    while ( !pool->m_quit && pool->m_generation == generation ) {
+      SDL_CondWait( pool->m_start, pool->m_mutex );
+    }
+    if ( pool->m_quit ) {
+      break;
+    }
+    generation = pool->m_generation;
+    SDL_UnlockMutex( pool->m_mutex );
+
+    pool->work( worker );
+
+    SDL_LockMutex( pool->m_mutex );
+    if ( --pool->m_busy == 0 ) {
+      SDL_CondSignal( pool->m_finish );
+    }
+  }
+  SDL_UnlockMutex( pool->m_mutex );
+  return 0;
+}
+
+
+WorkerThread::WorkerThread()
+  : m_mutex( SDL_CreateMutex() ),
+    m_cond( SDL_CreateCond() ),
+    m_quit( false ),
+    m_task( NULL ),
+    m_context( NULL )
+{
+  m_thread = SDL_CreateThread( startThread, this );
+}
+
+WorkerThread::~WorkerThread()
+{
+  SDL_LockMutex( m_mutex );
+  m_quit = true;
+  SDL_CondBroadcast( m_cond );
+  SDL_UnlockMutex( m_mutex );
+  SDL_WaitThread( m_thread, NULL );
+  SDL_DestroyCond( m_cond );
+  SDL_DestroyMutex( m_mutex );
+}
+
+void WorkerThread::run( Task* task, void* context )
+{
+  SDL_LockMutex( m_mutex );
+  while ( m_task ) {
+    SDL_CondWait( m_cond, m_mutex );
+  }
+  m_task = task;
+  m_context = context;
+  SDL_CondBroadcast( m_cond );
+  SDL_UnlockMutex( m_mutex );
+}
+
+void WorkerThread::wait()
+{
+  SDL_LockMutex( m_mutex );
+  while ( m_task ) {
+    SDL_CondWait( m_cond, m_mutex );
+  }
+  SDL_UnlockMutex( m_mutex );
+}
+
+int WorkerThread::startThread( void* arg )
+{
+  WorkerThread* thread = (WorkerThread*)arg;
+
+  SDL_LockMutex( thread->m_mutex );
+  while ( true ) {
+    while ( !thread->m_quit && !thread->m_task ) {
+      SDL_CondWait( thread->m_cond, thread->m_mutex );
+    }
+    if ( thread->m_quit ) {
+      break;
+    }
+    Task* task = thread->m_task;
+    void* context = thread->m_context;
+    SDL_UnlockMutex( thread->m_mutex );
+
+    task( context );
+
+    SDL_LockMutex( thread->m_mutex );
+    thread->m_task = NULL;
+    SDL_CondBroadcast( thread->m_cond );
+  }
+  SDL_UnlockMutex( thread->m_mutex );
+  return 0;
+}
@@ -19,6 +19,7 @@
 
 #include <SDL/SDL.h>
 #include <SDL/SDL_thread.h>
+#include "Box2D.h"
 
 class WorkerBase
 {
@@ -58,6 +59,57 @@ class WorkerF : public WorkerBase
 };
 
 
+// Fixed set of threads that run b2World island batches. The calling
+// thread takes part as worker 0.
+class WorkerPool : public b2WorkerPool
+{
+ public:
+  WorkerPool( int threads );
+  virtual ~WorkerPool();
+  virtual int32 GetWorkerCount() const;
+  virtual void Run( b2WorkerTask* task, void* context, int32 count );
+
+ private:
+  static int startThread( void* pool );
+  void work( int worker );
 
+  int           m_threadCount;
+  SDL_Thread  **m_threads;
+  SDL_mutex    *m_mutex;
+  SDL_cond     *m_start;
+  SDL_cond     *m_finish;
+  bool          m_quit;
+  int           m_generation;
+  int           m_busy;
+  b2WorkerTask *m_task;
+  void         *m_context;
+  int           m_count;
+  int           m_next;
+};
+
+// One persistent thread that runs tasks in the background, one at a
+// time, so the caller can carry on until it needs the result.
+class WorkerThread
+{
+ public:
+  typedef void Task( void* context );
+
+  WorkerThread();
+  ~WorkerThread();
+  // start a task once the previous one has finished
+  void run( Task* task, void* context );
+  // wait for the task in progress, if any
+  void wait();
+
+ private:
+  static int startThread( void* thread );
+
+  SDL_Thread  *m_thread;
+  SDL_mutex   *m_mutex;
+  SDL_cond    *m_cond;
+  bool         m_quit;
+  Task        *m_task;
+  void        *m_context;
+};
 
 #endif //WORKER_H
@@ -15,6 +15,7 @@
  */
 
 #include "ZipFile.h"
+#include "Config.h"
 #include <string>
 #include <cstring>
 #include <cstdio>
@@ -75,31 +76,49 @@ struct zip_eoc {
 	char zipecom[0];
 } __attribute__ ((packed));
 
-int uncompress_int(unsigned char *dest, int *destLen, 
-		   const unsigned char *source, int sourceLen)
+// Inflate into dest a piece at a time, starting with room for the
+// *destLen bytes the directory promises and growing dest whenever the
+// output outruns it, so no size is trusted or capped. dest is kept
+// for the next call, which needs no allocation unless it is bigger.
+static int uncompress_int(Array<unsigned char>& dest, int *destLen,
+			  const unsigned char *source, int sourceLen)
 {
   z_stream stream;
   int err;
   
   stream.next_in = (Bytef*)source;
   stream.avail_in = (uInt)sourceLen;
-  stream.next_out = dest;
-  stream.avail_out = (uInt)*destLen;
   
   stream.zalloc = (alloc_func)0;
   stream.zfree = (free_func)0;
+  stream.opaque = (voidpf)0;
   
   err = inflateInit2(&stream, -MAX_WBITS);
   if (err != Z_OK) return err;
-    
-  err = inflate(&stream, Z_FINISH);
-  if (err != Z_STREAM_END) {
-    inflateEnd(&stream);
-    if (err == Z_NEED_DICT || (err == Z_BUF_ERROR && stream.avail_in == 0))
-      return Z_DATA_ERROR;
-    return err;
+
+  int room = *destLen > 0 ? *destLen : ZIP_INFLATE_CHUNK;
+  if ( dest.size() < room ) {
+    dest.resize( room );
+  }
+  int out = 0;
+  for (;;) {
+    if ( out == dest.size() ) {
+      dest.resize( dest.size() + ZIP_INFLATE_CHUNK );
+    }
+    stream.next_out = &dest[out];
+    stream.avail_out = (uInt)(dest.size() - out);
+    err = inflate(&stream, Z_NO_FLUSH);
+    out = dest.size() - stream.avail_out;
+    if ( err == Z_STREAM_END ) {
+      break;
     }
-  *destLen = stream.total_out;
+    if ( (err != Z_OK && err != Z_BUF_ERROR) || stream.avail_out > 0 ) {
+      // an error, or no more input before the end of the stream
+      inflateEnd(&stream);
+      return err == Z_OK || err == Z_BUF_ERROR ? Z_DATA_ERROR : err;
+    }
+  }
+  *destLen = out;
   
   err = inflateEnd(&stream);
   return err;
@@ -107,74 +126,129 @@ int uncompress_int(unsigned char *dest, int *destLen,
 
 
 
+Array<ZipFile*> ZipFile::s_cache;
+
 ZipFile::ZipFile(const std::string& fn)
+  : m_path(fn)
 {
-  m_temp = NULL;
   m_fd=open(fn.c_str(), O_RDONLY);
   struct stat stat;
-  if (fstat(m_fd, &stat)==0 && S_ISREG(stat.st_mode)) {
+  if (fstat(m_fd, &stat)==0 && S_ISREG(stat.st_mode)
+      && stat.st_size >= (off_t)sizeof(zip_eoc)) {
+    m_mtime = stat.st_mtime;
     m_dataLen = stat.st_size;
     // TODO - win32
     m_data = (unsigned char*)mmap(NULL,m_dataLen,PROT_READ,MAP_PRIVATE, m_fd, 0);
-    if ( !m_data ) throw "mmap failed";
-    if ( *(int*)&m_data[0] != 0x04034b50 ) throw "bad zip magic";
+    if ( m_data == MAP_FAILED ) {
+      m_data = NULL;
+      close( m_fd );
+      throw "mmap failed";
+    }
+    if ( *(int*)&m_data[0] != 0x04034b50 ) {
+      munmap( m_data, m_dataLen );
+      close( m_fd );
+      throw "bad zip magic";
+    }
     m_eoc = (zip_eoc*)&m_data[m_dataLen-sizeof(zip_eoc)];
     m_firstcd = (zip_cd*)&m_data[m_eoc->zipeofst];
-    if ( m_eoc && m_firstcd ) {
-      m_entries = m_eoc->zipenum;
-    } else {
-      m_entries = 0;
-    }
+    index();
   } else {
+    if ( m_fd >= 0 ) close( m_fd );
     throw "invalid zip file";
   }
 }
 
+ZipFile* ZipFile::get(const std::string& fn)
+{
+  struct stat st;
+  bool exists = ::stat( fn.c_str(), &st )==0;
+  for ( int i=0; i<s_cache.size(); i++ ) {
+    ZipFile* zf = s_cache[i];
+    if ( zf->m_path == fn ) {
+      s_cache.erase( i );
+      if ( exists && st.st_mtime == zf->m_mtime
+	   && st.st_size == zf->m_dataLen ) {
+	s_cache.append( zf );
+	return zf;
+      }
+      delete zf; // changed on disk since
+      break;
+    }
+  }
+  ZipFile* zf = new ZipFile( fn );
+  if ( s_cache.size() >= ZIP_CACHE_SIZE ) {
+    delete s_cache[0];
+    s_cache.erase( 0 );
+  }
+  s_cache.append( zf );
+  return zf;
+}
+
+// Walk the central directory the once, so entries can be found by
+// number from then on.
+void ZipFile::index()
+{
+  m_entries = 0;
+  m_index.empty();
+  int n = m_eoc->zipenum;
+  unsigned int pos = m_eoc->zipeofst;
+  unsigned int end = m_dataLen - sizeof(zip_eoc);
+  m_index.capacity( n > 0 ? n : 1 );
+  for ( int i=0; i<n; i++ ) {
+    if ( pos + sizeof(zip_cd) > end ) break;
+    zip_cd* cd = (zip_cd*)&m_data[pos];
+    if ( cd->zipcensig != 0x02014b50
+	 || pos + sizeof(zip_cd) + cd->zipcfnl > end ) {
+      break;
+    }
+    Entry e;
+    e.name = cd->zipcfn;
+    e.nameLen = cd->zipcfnl;
+    e.offset = cd->zipofst;
+    e.method = cd->zipcmthd;
+    e.csize = cd->zipcsiz;
+    e.usize = cd->zipcunc;
+    e.crc = cd->zipccrc;
+    m_index.append( e );
+    pos += sizeof(zip_cd) + cd->zipcfnl + cd->zipcxtl + cd->zipccml;
+  }
+  m_entries = m_index.size();
+}
+
 
 ZipFile::~ZipFile()
 {
-  delete[] m_temp;
   if ( m_data ) munmap( m_data, m_dataLen );
-  if ( m_fd ) close( m_fd );
+  if ( m_fd >= 0 ) close( m_fd );
 }
 
 
 std::string ZipFile::entryName( int n )
 {
   if ( n < 0 || n >= m_entries ) return std::string();
-  zip_cd* cd = m_firstcd;
-  for ( int count=0; cd < (zip_cd*)m_eoc && count < n; count++ ) {
-    cd = (zip_cd*)(((char*)cd) + sizeof(zip_cd) + cd->zipcfnl + cd->zipcxtl + cd->zipccml);
-  }    
-  zip_lfh* lfh = (zip_lfh*)&m_data[cd->zipofst];
-
-  if ( lfh ) {
-    return std::string(lfh->zipname,lfh->zipfnln);
-  }
-  return std::string();
+  return std::string( m_index[n].name, m_index[n].nameLen );
 }
 
 unsigned char* ZipFile::extract( int n, int *l )
 {
   if ( n < 0 || n >= m_entries ) return NULL;
-  zip_cd* cd = m_firstcd;
-  for ( int count=0; cd < (zip_cd*)m_eoc && count < n; count++ ) {
-    cd = (zip_cd*)(((char*)cd) + sizeof(zip_cd) + cd->zipcfnl + cd->zipcxtl + cd->zipccml);
-  }    
-  zip_lfh* lfh = (zip_lfh*)&m_data[cd->zipofst];
-
-  if ( lfh ) {
-    *l = lfh->zipuncmp;
-    unsigned char* zdat = (unsigned char*)lfh + sizeof(*lfh) + lfh->zipfnln + lfh->zipxtraln;
-    switch (lfh->zipmthd) {
-    case 0: 
-      return zdat;
-    case 8:
-      delete[] m_temp;
-      m_temp = new unsigned char[*l];
-      if ( uncompress_int(m_temp, l, zdat, lfh->zipsize) == Z_OK) {
-	return m_temp;
-      }
+  const Entry& e = m_index[n];
+  if ( e.offset + sizeof(zip_lfh) > (unsigned int)m_dataLen ) return NULL;
+  // the local header's name and extra field may differ in length from
+  // the central directory's
+  zip_lfh* lfh = (zip_lfh*)&m_data[e.offset];
+  unsigned int data = e.offset + sizeof(*lfh) + lfh->zipfnln + lfh->zipxtraln;
+  if ( data > (unsigned int)m_dataLen || e.csize > m_dataLen - data ) {
+    return NULL;
+  }
+  unsigned char* zdat = &m_data[data];
+  *l = e.usize;
+  switch (e.method) {
+  case 0: 
+    return zdat;
+  case 8:
+    if ( uncompress_int(m_temp, l, zdat, e.csize) == Z_OK) {
+      return &m_temp[0];
     }
   }
   return NULL;
@@ -17,6 +17,8 @@
 #define ZIPFILE_H
 
 #include <string>
+#include <time.h>
+#include "Array.h"
 
 struct zip_eoc;
 struct zip_cd;
@@ -27,18 +29,44 @@ class ZipFile
 public:
   ZipFile(const std::string& fn);
   ~ZipFile();
+  // A shared, already open handle on fn. The most recently used ones
+  // are kept mapped, so a handle lasts until ZIP_CACHE_SIZE others
+  // have been asked for; do not keep it beyond the call at hand.
+  static ZipFile* get(const std::string& fn);
   int numEntries() { return m_entries; }
   std::string entryName( int n );
+  // The n'th entry and its length in l. Stored entries are returned
+  // where they lie in the mapped file, deflated ones inflated into a
+  // buffer of ours that the next extract reuses.
   unsigned char* extract( int n, int *l );
+  // whether extract hands entry n out of the mapped file as it lies
+  bool stored( int n ) { return n>=0 && n<m_entries && m_index[n].method==0; }
 
 private:
+  // an entry as the central directory describes it
+  struct Entry {
+    const char*  name;    // in the mapped file
+    int          nameLen;
+    unsigned int offset;  // of its local header
+    int          method;
+    unsigned int csize;
+    unsigned int usize;
+    unsigned int crc;
+  };
+  void index();
+
+  std::string m_path;
+  time_t m_mtime;
   int m_fd;
   int m_dataLen;
   unsigned char* m_data;
   zip_eoc* m_eoc;
   zip_cd*  m_firstcd; 
   int m_entries;
-  unsigned char*m_temp;
+  Array<Entry> m_index;
+  Array<unsigned char> m_temp; // inflated entries, reused
+
+  static Array<ZipFile*> s_cache; // least recently used first
 };
 
 